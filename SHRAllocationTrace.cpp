@@ -0,0 +1,103 @@
+#include "SHRAllocationTrace.h"
+
+SHRAllocationTraceRecorder::~SHRAllocationTraceRecorder()
+{
+	End();
+}
+
+bool SHRAllocationTraceRecorder::Begin(const std::string& path)
+{
+	End();
+
+	m_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_file.is_open()) return false;
+
+	SHRAllocationTraceHeader header = { SHR_ALLOCATION_TRACE_MAGIC, SHR_ALLOCATION_TRACE_VERSION, sizeof(SHRAllocationTraceEvent), 0 };
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	m_frame = 0;
+	m_eventCount = 0;
+	m_events.reserve(SHR_ALLOCATION_TRACE_FLUSH_COUNT);
+	return true;
+}
+
+void SHRAllocationTraceRecorder::End()
+{
+	if (!m_file.is_open()) return;
+
+	Flush();
+	m_file.close();
+}
+
+uint64_t SHRAllocationTraceRecorder::RecordAllocate(SHRAllocationTraceSystem system, uint32_t heapType, uint32_t dimension, uint64_t size, uint64_t alignment,
+	uint32_t heapFlags, uint32_t resourceFlags, uint32_t initState, bool served)
+{
+	if (!m_file.is_open()) return 0;
+
+	//ids keep counting across Begin calls, a block from an earlier trace never matches a later allocation
+	uint64_t id = m_nextId++;
+
+	SHRAllocationTraceEvent event = {};
+	event.type = static_cast<uint8_t>(SHRAllocationTraceEventType::Allocate);
+	event.system = static_cast<uint8_t>(system);
+	event.heapType = static_cast<uint8_t>(heapType);
+	event.dimension = static_cast<uint8_t>(dimension);
+	event.frame = m_frame;
+	event.id = id;
+	event.size = size;
+	event.alignment = alignment;
+	event.heapFlags = heapFlags;
+	event.resourceFlags = resourceFlags;
+	event.initState = initState;
+	event.served = served ? 1 : 0;
+	m_events.push_back(event);
+
+	m_eventCount++;
+	if (m_events.size() >= SHR_ALLOCATION_TRACE_FLUSH_COUNT) Flush();
+
+	return served ? id : 0;
+}
+
+void SHRAllocationTraceRecorder::RecordFree(uint64_t id)
+{
+	if (!m_file.is_open() || id == 0) return;
+
+	SHRAllocationTraceEvent event = {};
+	event.type = static_cast<uint8_t>(SHRAllocationTraceEventType::Free);
+	event.frame = m_frame;
+	event.id = id;
+	m_events.push_back(event);
+
+	m_eventCount++;
+	if (m_events.size() >= SHR_ALLOCATION_TRACE_FLUSH_COUNT) Flush();
+}
+
+void SHRAllocationTraceRecorder::Flush()
+{
+	if (m_events.empty()) return;
+
+	m_file.write(reinterpret_cast<const char*>(m_events.data()), m_events.size() * sizeof(SHRAllocationTraceEvent));
+	m_events.clear();
+}
+
+bool SHRLoadAllocationTrace(const std::string& path, std::vector<SHRAllocationTraceEvent>& events)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	SHRAllocationTraceHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != SHR_ALLOCATION_TRACE_MAGIC || header.version != SHR_ALLOCATION_TRACE_VERSION || header.eventSize != sizeof(SHRAllocationTraceEvent))
+	{
+		return false;
+	}
+
+	//a trace cut short by a crash still replays up to its last whole event
+	SHRAllocationTraceEvent event;
+	events.clear();
+	while (file.read(reinterpret_cast<char*>(&event), sizeof(event)))
+	{
+		events.push_back(event);
+	}
+	return true;
+}
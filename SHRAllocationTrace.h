@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <fstream>
+
+#define SHR_ALLOCATION_TRACE_MAGIC 0x54524853	//"SHRT"
+#define SHR_ALLOCATION_TRACE_VERSION 2		//2: Dedicated system
+#define SHR_ALLOCATION_TRACE_FLUSH_COUNT 4096	//events buffered before they are written out
+
+enum class SHRAllocationTraceEventType : uint8_t
+{
+	Allocate,
+	Free		//the block went back to its allocator, i.e. its fence retired
+};
+
+//allocator system a request went through, same order as SHRAllocatorType
+enum class SHRAllocationTraceSystem : uint8_t
+{
+	Buddy,
+	Segregated,
+	FreeList,
+	Dedicated	//routed past the heaps of the buddy or segregated system to a resource of its own
+};
+
+struct SHRAllocationTraceHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t eventSize;
+	uint32_t reserved;
+};
+
+//fixed size record, the file is a header followed by these back to back.
+//heap type, heap flags, resource flags & states are the raw D3D12 values
+struct SHRAllocationTraceEvent
+{
+	uint8_t type;
+	uint8_t system;
+	uint8_t heapType;
+	uint8_t dimension;
+	uint32_t frame;
+	uint64_t id;			//ties a free to its allocation, 0 is never used
+	uint64_t size;
+	uint64_t alignment;
+	uint32_t heapFlags;
+	uint32_t resourceFlags;
+	uint32_t initState;
+	uint32_t served;		//0 when no allocator could take the request, no free follows
+};
+
+//binary trace of the allocation requests and retired blocks of the allocator systems, replayed offline by Tools/SHRAllocationReplay
+class SHRAllocationTraceRecorder
+{
+public:
+	SHRAllocationTraceRecorder() = default;
+	~SHRAllocationTraceRecorder();
+
+	bool Begin(const std::string& path);
+	void End();
+	bool IsRecording() const { return m_file.is_open(); }
+
+	void NextFrame() { m_frame++; }
+
+	//returns the id to keep in the resource block, 0 while not recording
+	uint64_t RecordAllocate(SHRAllocationTraceSystem system, uint32_t heapType, uint32_t dimension, uint64_t size, uint64_t alignment,
+		uint32_t heapFlags, uint32_t resourceFlags, uint32_t initState, bool served);
+	void RecordFree(uint64_t id);
+
+private:
+	void Flush();
+
+public:
+	uint32_t m_frame = 0;
+	uint64_t m_eventCount = 0;
+
+private:
+	std::ofstream m_file;
+	std::vector<SHRAllocationTraceEvent> m_events;
+	uint64_t m_nextId = 1;
+};
+
+//whole trace in memory, returns false when the file is missing or not a trace of this version
+bool SHRLoadAllocationTrace(const std::string& path, std::vector<SHRAllocationTraceEvent>& events);
@@ -0,0 +1,69 @@
+#include "SHRAllocatorStats.h"
+#include "SHRBitUtils.h"
+
+bool SHRAllocatorTelemetry::s_enabled = false;
+
+double SHRAllocatorStats::GetFragmentation() const
+{
+	uint64_t freeBytes = committedBytes > liveBytes ? committedBytes - liveBytes : 0;
+	if (freeBytes == 0) return 0.0;
+	return 1.0 - double(largestFreeBlock) / double(freeBytes);
+}
+
+void SHRAllocatorStats::Accumulate(const SHRAllocatorStats& other)
+{
+	liveBytes += other.liveBytes;
+	committedBytes += other.committedBytes;
+	if (other.largestFreeBlock > largestFreeBlock) largestFreeBlock = other.largestFreeBlock;
+	heapCount += other.heapCount;
+	allocationCount += other.allocationCount;
+	freeCount += other.freeCount;
+	failedCount += other.failedCount;
+	dedicatedCount += other.dedicatedCount;
+	for (uint32_t i = 0; i < SHR_ALLOCATOR_LATENCY_BUCKET_COUNT; i++)
+	{
+		latencyHistogram[i] += other.latencyHistogram[i];
+	}
+}
+
+void SHRAllocatorTelemetry::WriteJson(std::string& json, const char* name, const SHRAllocatorStats& stats)
+{
+	json += "{\"name\":\"";
+	json += name;
+	json += "\",\"liveBytes\":" + std::to_string(stats.liveBytes);
+	json += ",\"committedBytes\":" + std::to_string(stats.committedBytes);
+	json += ",\"largestFreeBlock\":" + std::to_string(stats.largestFreeBlock);
+	json += ",\"fragmentation\":" + std::to_string(stats.GetFragmentation());
+	json += ",\"heapCount\":" + std::to_string(stats.heapCount);
+	json += ",\"allocationCount\":" + std::to_string(stats.allocationCount);
+	json += ",\"freeCount\":" + std::to_string(stats.freeCount);
+	json += ",\"failedCount\":" + std::to_string(stats.failedCount);
+	json += ",\"dedicatedCount\":" + std::to_string(stats.dedicatedCount);
+
+	//trailing empty buckets are cut off
+	uint32_t bucketCount = SHR_ALLOCATOR_LATENCY_BUCKET_COUNT;
+	while (bucketCount > 0 && stats.latencyHistogram[bucketCount - 1] == 0) bucketCount--;
+
+	json += ",\"latencyHistogramLog2Ns\":[";
+	for (uint32_t i = 0; i < bucketCount; i++)
+	{
+		if (i) json += ",";
+		json += std::to_string(stats.latencyHistogram[i]);
+	}
+	json += "]}";
+}
+
+SHRAllocationSample::SHRAllocationSample(SHRAllocatorStats& stats) : m_stats(stats), m_enabled(SHRAllocatorTelemetry::IsEnabled())
+{
+	if (m_enabled) m_start = std::chrono::steady_clock::now();
+}
+
+SHRAllocationSample::~SHRAllocationSample()
+{
+	if (!m_enabled) return;
+
+	uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+	uint32_t bucket = ns ? SHRFindLastSet(ns) : 0;
+	if (bucket >= SHR_ALLOCATOR_LATENCY_BUCKET_COUNT) bucket = SHR_ALLOCATOR_LATENCY_BUCKET_COUNT - 1;
+	m_stats.latencyHistogram[bucket]++;
+}
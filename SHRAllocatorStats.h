@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+#define SHR_ALLOCATOR_LATENCY_BUCKET_COUNT 32	//bucket i counts allocations that took [2^i, 2^(i+1)) ns
+
+//occupancy is gathered on demand from the managers, counters & latencies are kept by the allocator
+struct SHRAllocatorStats
+{
+	uint64_t liveBytes;				//includes blocks waiting for their fence
+	uint64_t committedBytes;
+	uint64_t largestFreeBlock;
+	uint64_t heapCount;
+	uint64_t allocationCount;
+	uint64_t freeCount;
+	uint64_t failedCount;
+	uint64_t dedicatedCount;		//live resources with a committed resource or heap of their own
+	uint64_t latencyHistogram[SHR_ALLOCATOR_LATENCY_BUCKET_COUNT];
+
+	//0 when all free bytes are one block, close to 1 when they are scattered
+	double GetFragmentation() const;
+	void Accumulate(const SHRAllocatorStats& other);
+};
+
+//runtime switch for the latency samples, counters are always kept
+class SHRAllocatorTelemetry
+{
+public:
+	static bool IsEnabled() { return s_enabled; }
+	static void SetEnabled(bool enabled) { s_enabled = enabled; }
+
+	//appends one json object, no trailing separator
+	static void WriteJson(std::string& json, const char* name, const SHRAllocatorStats& stats);
+
+private:
+	static bool s_enabled;
+};
+
+//times one allocation into a latency bucket, reads no clock while telemetry is disabled
+class SHRAllocationSample
+{
+public:
+	SHRAllocationSample(SHRAllocatorStats& stats);
+	~SHRAllocationSample();
+
+private:
+	SHRAllocatorStats& m_stats;
+	bool m_enabled;
+	std::chrono::steady_clock::time_point m_start;
+};
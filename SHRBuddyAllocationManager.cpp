@@ -0,0 +1,159 @@
+#include "SHRBuddyAllocationManager.h"
+#include "SHRBitUtils.h"
+
+SHRBuddyAllocationManager::SHRBuddyAllocationManager(SHRHeapProvider* pProvider, uint64_t heapSize, uint64_t blockSize, uint64_t alignment)
+{
+	Initialize(pProvider, heapSize, blockSize, alignment);
+}
+
+void SHRBuddyAllocationManager::Initialize(SHRHeapProvider* pProvider, uint64_t heapSize, uint64_t blockSize, uint64_t alignment)
+{
+	m_pProvider = pProvider;
+	m_heapSize = heapSize;
+	m_blockSize = blockSize;
+
+	uint64_t blockNum = m_heapSize / m_blockSize;
+	uint64_t nodeNum = 2 * blockNum - 1;
+	m_blockStates.assign(nodeNum, { 0,nullptr });
+	m_freeLinks.assign(nodeNum, { -1,-1 });
+	m_splitBitmap.assign((nodeNum + 63) / 64, 0);
+
+	m_layerCount = 0;
+	for (uint64_t n = blockNum; n > 0; n >>= 1) m_layerCount++;
+	m_freeListHeads.assign(m_layerCount, -1);
+	m_freeLayerBitmap = 0;
+
+	m_heapIndex = m_pProvider->CreateHeap(m_heapSize, alignment);
+
+	//the whole heap starts as a single free block at layer 0
+	PushFreeBlock(0, 0);
+}
+
+std::pair<int32_t, uint32_t> SHRBuddyAllocationManager::CanAllocate(uint64_t size)
+{
+	if (m_heapSize < size) return { -1,0 };
+
+	int32_t layer = 0;
+	while ((m_heapSize >> layer) >= size && (m_heapSize >> layer) >= m_blockSize)
+	{
+		layer++;
+	}
+	layer -= 1;
+
+	//the deepest non-empty free list at or above the target layer holds the smallest block large enough,
+	//return the leftmost target-layer block inside it, AllocateBlock splits down to it
+	uint64_t candidates = m_freeLayerBitmap & ((2ULL << layer) - 1);
+	if (candidates == 0) return { -1,0 };
+
+	int32_t freeLayer = static_cast<int32_t>(SHRFindLastSet(candidates));
+	uint32_t freeOffset = static_cast<uint32_t>(m_freeListHeads[freeLayer]) - ((1u << freeLayer) - 1);
+	return { layer, freeOffset << (layer - freeLayer) };
+}
+
+void SHRBuddyAllocationManager::AllocateBlock(uint32_t layer, uint32_t offset, SHRResource* pResource)
+{
+	uint32_t node = GetNodeIndex(layer, offset);
+
+	//walk up to the free block containing the target node
+	uint32_t freeNode = node;
+	uint32_t freeLayer = layer;
+	while (!m_blockStates[freeNode].valid && freeNode > 0)
+	{
+		freeNode = (freeNode - 1) >> 1;
+		freeLayer--;
+	}
+
+	RemoveFreeBlock(freeLayer, freeNode);
+
+	//split down to the target layer, the buddy on the other side of the path goes back to the free lists
+	while (freeLayer < layer)
+	{
+		SetSplit(freeNode, true);
+
+		uint32_t child = ((node + 1) >> (layer - freeLayer - 1)) - 1;
+		uint32_t buddy = (child & 1) ? child + 1 : child - 1;
+		PushFreeBlock(freeLayer + 1, buddy);
+
+		freeNode = child;
+		freeLayer++;
+	}
+
+	m_blockStates[node].pResource = pResource;
+	m_pProvider->OnAllocate(m_heapIndex, GetBlockOffset(layer, offset), GetBlockSize(layer));
+}
+
+void SHRBuddyAllocationManager::DeallocateBlock(uint64_t layer, uint64_t offset)
+{
+	uint32_t node = GetNodeIndex(layer, offset);
+	uint32_t freeLayer = static_cast<uint32_t>(layer);
+	m_blockStates[node].pResource = nullptr;
+	m_pProvider->OnFree(m_heapIndex, GetBlockOffset(layer, offset), GetBlockSize(layer));
+
+	//coalesce with the buddy as long as it is a whole free block
+	while (node > 0)
+	{
+		uint32_t buddy = (node & 1) ? node + 1 : node - 1;
+		uint32_t parent = (node - 1) >> 1;
+		if (!m_blockStates[buddy].valid || !IsSplit(parent)) break;
+
+		RemoveFreeBlock(freeLayer, buddy);
+		SetSplit(parent, false);
+		node = parent;
+		freeLayer--;
+	}
+
+	PushFreeBlock(freeLayer, node);
+}
+
+uint64_t SHRBuddyAllocationManager::GetFreeSize() const
+{
+	uint64_t freeSize = 0;
+	for (uint32_t layer = 0; layer < m_layerCount; layer++)
+	{
+		for (int32_t node = m_freeListHeads[layer]; node != -1; node = m_freeLinks[node].next)
+		{
+			freeSize += GetBlockSize(layer);
+		}
+	}
+	return freeSize;
+}
+
+uint64_t SHRBuddyAllocationManager::GetLargestFreeBlock() const
+{
+	return m_freeLayerBitmap ? GetBlockSize(SHRFindFirstSet(m_freeLayerBitmap)) : 0;
+}
+
+void SHRBuddyAllocationManager::SetSplit(uint32_t node, bool split)
+{
+	uint64_t mask = 1ULL << (node & 63);
+	if (split)
+		m_splitBitmap[node >> 6] |= mask;
+	else
+		m_splitBitmap[node >> 6] &= ~mask;
+}
+
+void SHRBuddyAllocationManager::PushFreeBlock(uint32_t layer, uint32_t node)
+{
+	FreeLink& link = m_freeLinks[node];
+	link.prev = -1;
+	link.next = m_freeListHeads[layer];
+	if (link.next != -1) m_freeLinks[link.next].prev = node;
+	m_freeListHeads[layer] = node;
+	m_freeLayerBitmap |= 1ULL << layer;
+
+	m_blockStates[node].valid = 1;
+}
+
+void SHRBuddyAllocationManager::RemoveFreeBlock(uint32_t layer, uint32_t node)
+{
+	FreeLink& link = m_freeLinks[node];
+	if (link.prev != -1)
+		m_freeLinks[link.prev].next = link.next;
+	else
+		m_freeListHeads[layer] = link.next;
+	if (link.next != -1) m_freeLinks[link.next].prev = link.prev;
+	if (m_freeListHeads[layer] == -1) m_freeLayerBitmap &= ~(1ULL << layer);
+	link.prev = link.next = -1;
+
+	m_blockStates[node].valid = 0;
+}
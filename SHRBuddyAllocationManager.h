@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "SHRHeapProvider.h"
+
+class SHRResource;
+
+struct SHRBlockState
+{
+	uint32_t valid;
+	SHRResource* pResource;
+};
+
+//buddy bookkeeping of a single heap, blocks are addressed as {layer, offset in layer}
+class SHRBuddyAllocationManager
+{
+public:
+	struct FreeLink
+	{
+		int32_t prev;
+		int32_t next;
+	};
+
+public:
+	SHRBuddyAllocationManager() = default;
+	SHRBuddyAllocationManager(SHRHeapProvider* pProvider, uint64_t heapSize, uint64_t blockSize, uint64_t alignment);
+	~SHRBuddyAllocationManager() = default;
+
+	void Initialize(SHRHeapProvider* pProvider, uint64_t heapSize, uint64_t blockSize, uint64_t alignment);
+
+	std::pair<int32_t, uint32_t> CanAllocate(uint64_t size);					//return {layer, offset}
+	void AllocateBlock(uint32_t layer, uint32_t offset, SHRResource* pResource);
+	void DeallocateBlock(uint64_t layer, uint64_t offset);
+
+	void SetBlockResource(uint64_t layer, uint64_t offset, SHRResource* pResource) { m_blockStates[GetNodeIndex(layer, offset)].pResource = pResource; }
+
+	uint64_t GetBlockSize(uint64_t layer) const { return m_heapSize >> layer; }
+	uint64_t GetBlockOffset(uint64_t layer, uint64_t offset) const { return GetBlockSize(layer) * offset; }
+
+	bool IsSplit(uint32_t node) const { return (m_splitBitmap[node >> 6] >> (node & 63)) & 1; }
+
+	uint64_t GetFreeSize() const;
+	//constant time, read from m_freeLayerBitmap
+	uint64_t GetLargestFreeBlock() const;
+
+private:
+	uint32_t GetNodeIndex(uint64_t layer, uint64_t offset) const { return static_cast<uint32_t>((1ULL << layer) - 1 + offset); }
+	void SetSplit(uint32_t node, bool split);
+	void PushFreeBlock(uint32_t layer, uint32_t node);
+	void RemoveFreeBlock(uint32_t layer, uint32_t node);
+
+public:
+	//valid == 1 means the node is a whole free block and is linked in the free list of its layer
+	std::vector<SHRBlockState> m_blockStates;
+	std::vector<FreeLink> m_freeLinks;
+	std::vector<int32_t> m_freeListHeads;
+	//bit i is set while the free list of layer i is not empty, the lowest set bit is the largest free block
+	uint64_t m_freeLayerBitmap = 0;
+	std::vector<uint64_t> m_splitBitmap;
+	uint32_t m_layerCount = 0;
+
+	uint64_t m_heapSize = 0;
+	uint64_t m_blockSize = 0;
+	uint32_t m_heapIndex = 0;
+
+private:
+	SHRHeapProvider* m_pProvider = nullptr;
+};
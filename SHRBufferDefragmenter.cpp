@@ -0,0 +1,108 @@
+#include "SHRBufferDefragmenter.h"
+
+SHRBufferDefragmenter::SHRBufferDefragmenter(SHRBuddySystem* pBuddySystem)
+	: m_pBuddySystem(pBuddySystem)
+{
+}
+
+UINT64 SHRBufferDefragmenter::Execute(ID3D12GraphicsCommandList* pCmdList)
+{
+	if (!m_relocationCallback) return 0;
+
+	//allocators whose moves failed last time are regular candidates again
+	for (auto& pAllocator : m_pBuddySystem->m_allocators)
+	{
+		if (pAllocator->m_isEvacuating && pAllocator->m_liveCount > 0) pAllocator->m_isEvacuating = false;
+	}
+
+	m_planner.Reset();
+	m_heapAllocators.clear();
+	GatherHeaps();
+	m_planner.Plan();
+
+	//no new block may land in a heap that is being emptied
+	for (uint32_t heap : m_planner.m_evacuatedHeaps)
+	{
+		m_heapAllocators[heap]->m_isEvacuating = true;
+	}
+
+	UINT64 movedBytes = 0;
+	for (const SHRDefragmentationPlanner::Move& move : m_planner.m_moves)
+	{
+		SHRResource& resource = *static_cast<SHRResource*>(move.pUserData);
+		if (Relocate(pCmdList, resource, m_heapAllocators[move.dstHeap]))
+		{
+			movedBytes += move.size;
+			m_relocationCallback(resource);
+		}
+	}
+	return movedBytes;
+}
+
+void SHRBufferDefragmenter::GatherHeaps()
+{
+	//only default heaps, upload & readback ranges are CPU visible and cannot be copied into on the GPU
+	for (auto& pAllocator : m_pBuddySystem->m_allocators)
+	{
+		if (pAllocator->m_isEvacuating || pAllocator->GetDesc().properties.Type != D3D12_HEAP_TYPE_DEFAULT) continue;
+
+		uint32_t heapClass = GetHeapClass(pAllocator->GetDesc().alignment);
+		uint32_t heap = m_planner.AddHeap(heapClass, pAllocator->m_manager.m_heapSize);
+		m_heapAllocators.push_back(pAllocator.get());
+
+		m_scratchResources.clear();
+		pAllocator->GetLiveResources(m_scratchResources);
+		for (SHRResource* pResource : m_scratchResources)
+		{
+			m_planner.AddBlock(heap, pAllocator->m_manager.GetBlockSize(pResource->m_block.layer), pResource);
+		}
+	}
+}
+
+uint32_t SHRBufferDefragmenter::GetHeapClass(UINT64 alignment)
+{
+	for (uint32_t i = 0; i < m_heapClassAlignments.size(); i++)
+	{
+		if (m_heapClassAlignments[i] == alignment) return i;
+	}
+	m_heapClassAlignments.push_back(alignment);
+	return static_cast<uint32_t>(m_heapClassAlignments.size() - 1);
+}
+
+bool SHRBufferDefragmenter::Relocate(ID3D12GraphicsCommandList* pCmdList, SHRResource& resource, SHRResourceAllocator* pDstAllocator)
+{
+	SHRD3D12Resource& src = *resource.m_pSHRD3dResource;
+
+	D3D12_RESOURCE_DESC desc = src.GetResourceDesc();
+
+	SHRResource moved;
+	if (!pDstAllocator->AllocateSHRResouce(desc, src.m_currentState, static_cast<UINT>(desc.Width), moved))
+	{
+		return false;	//the byte count fit but the heap is too fragmented, stay where we are
+	}
+	SHRD3D12Resource& dst = *moved.m_pSHRD3dResource;
+
+	D3D12_RESOURCE_STATES state = src.m_currentState;
+	CD3DX12_RESOURCE_BARRIER barriers[2];
+	UINT barrierCount = 0;
+	if (state != D3D12_RESOURCE_STATE_COPY_SOURCE) barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(src.m_pResource.Get(), state, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	if (state != D3D12_RESOURCE_STATE_COPY_DEST) barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(dst.m_pResource.Get(), state, D3D12_RESOURCE_STATE_COPY_DEST);
+	if (barrierCount) pCmdList->ResourceBarrier(barrierCount, barriers);
+
+	pCmdList->CopyBufferRegion(dst.m_pResource.Get(), dst.m_offsetInResource, src.m_pResource.Get(), src.m_offsetInResource, desc.Width);
+
+	barrierCount = 0;
+	if (state != D3D12_RESOURCE_STATE_COPY_SOURCE) barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(src.m_pResource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, state);
+	if (state != D3D12_RESOURCE_STATE_COPY_DEST) barriers[barrierCount++] = CD3DX12_RESOURCE_BARRIER::Transition(dst.m_pResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, state);
+	if (barrierCount) pCmdList->ResourceBarrier(barrierCount, barriers);
+
+	//resource takes the new placement, moved takes the old one and releases it once this frame retires
+	src.Swap(dst);
+	std::swap(resource.m_block.layer, moved.m_block.layer);
+	std::swap(resource.m_block.offset, moved.m_block.offset);
+	std::swap(resource.m_block.pAllocator, moved.m_block.pAllocator);
+	resource.m_block.pAllocator->RebindResource(resource.m_block, &resource);
+	moved.m_block.pAllocator->RebindResource(moved.m_block, &moved);
+
+	return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <functional>
+
+#include "SHRResourceAllocator.h"
+#include "SHRDefragmentationPlanner.h"
+
+//moves live buffers out of sparse default heaps of the buddy system, the free list system only holds upload & readback
+//ranges. the SHRResource and its SHRD3D12Resource keep their addresses, only the placement underneath changes.
+//evacuated allocators are released by CleanupSystem once their deferred deletions retire
+class SHRBufferDefragmenter
+{
+public:
+	//runs right after a resource moved, owners must recreate views and cached GPU addresses of it
+	typedef std::function<void(SHRResource& resource)> RelocationCallback;
+
+public:
+	SHRBufferDefragmenter(SHRBuddySystem* pBuddySystem);
+	~SHRBufferDefragmenter() = default;
+
+	void SetRelocationCallback(RelocationCallback callback) { m_relocationCallback = callback; }
+
+	//records the copies of this frame into pCmdList, nothing moves until a relocation callback is set
+	UINT64 Execute(ID3D12GraphicsCommandList* pCmdList);		//return moved bytes
+
+private:
+	void GatherHeaps();
+	//heap classes, blocks only move between allocators of the same alignment
+	uint32_t GetHeapClass(UINT64 alignment);
+	bool Relocate(ID3D12GraphicsCommandList* pCmdList, SHRResource& resource, SHRResourceAllocator* pDstAllocator);
+
+public:
+	SHRDefragmentationPlanner m_planner;
+	RelocationCallback m_relocationCallback;
+
+private:
+	SHRBuddySystem* m_pBuddySystem;
+
+	//planner heap index -> allocator
+	std::vector<SHRResourceAllocator*> m_heapAllocators;
+	std::vector<UINT64> m_heapClassAlignments;
+	std::vector<SHRResource*> m_scratchResources;
+};
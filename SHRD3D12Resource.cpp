@@ -1,5 +1,7 @@
 #include "SHRD3D12Resource.h"
 
+#include <utility>
+
 SHRD3D12Resource::~SHRD3D12Resource()
 {
 	if (m_mappedBaseAddress)
@@ -19,4 +21,13 @@ D3D12_RESOURCE_DESC SHRD3D12Resource::GetResourceDesc()
 void SHRD3D12Resource::Map(UINT subresource, D3D12_RANGE* pReadRange)
 {
 	ThrowIfFailed(m_pResource->Map(subresource, pReadRange, &m_mappedBaseAddress));
-}
\ No newline at end of file
+	m_mappedBaseAddress = static_cast<UINT8*>(m_mappedBaseAddress) + m_offsetInResource;
+}
+void SHRD3D12Resource::Swap(SHRD3D12Resource& other)
+{
+	m_pResource.Swap(other.m_pResource);
+	std::swap(m_resourceGPUAddress, other.m_resourceGPUAddress);
+	std::swap(m_currentState, other.m_currentState);
+	std::swap(m_mappedBaseAddress, other.m_mappedBaseAddress);
+	std::swap(m_offsetInResource, other.m_offsetInResource);
+}
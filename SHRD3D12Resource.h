@@ -15,13 +15,20 @@ public:
 
 	void Map(UINT subresource, D3D12_RANGE* pReadRange = nullptr);
 
+	//exchanges the underlying placements, used to relocate a resource without changing its address on the CPU side
+	void Swap(SHRD3D12Resource& other);
+
 	D3D12_RESOURCE_DESC GetResourceDesc();
 
 public:
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_pResource = nullptr;
 
+	//m_resourceGPUAddress already includes m_offsetInResource
 	D3D12_GPU_VIRTUAL_ADDRESS m_resourceGPUAddress = 0;
 
+	//non zero when this is a sub-range of a buffer shared with other resources
+	UINT64 m_offsetInResource = 0;
+
 	D3D12_RESOURCE_STATES m_currentState;
 
 	void* m_mappedBaseAddress = nullptr;
@@ -0,0 +1,127 @@
+#include "SHRDefragmentationPlanner.h"
+
+#include <algorithm>
+
+enum SHRDefragHeapRole : uint8_t
+{
+	SHR_DEFRAG_HEAP_NONE = 0,
+	SHR_DEFRAG_HEAP_SOURCE = 1,
+	SHR_DEFRAG_HEAP_DESTINATION = 2
+};
+
+SHRDefragmentationPlanner::SHRDefragmentationPlanner(float sparseThreshold, uint64_t frameByteBudget)
+	: m_sparseThreshold(sparseThreshold)
+	, m_frameByteBudget(frameByteBudget)
+{
+}
+
+uint32_t SHRDefragmentationPlanner::AddHeap(uint32_t heapClass, uint64_t capacity)
+{
+	m_heaps.push_back({ heapClass, capacity, 0 });
+	return static_cast<uint32_t>(m_heaps.size() - 1);
+}
+
+void SHRDefragmentationPlanner::AddBlock(uint32_t heap, uint64_t size, void* pUserData)
+{
+	m_blocks.push_back({ heap, size, pUserData });
+	m_heaps[heap].liveBytes += size;
+}
+
+void SHRDefragmentationPlanner::Plan()
+{
+	m_moves.clear();
+	m_evacuatedHeaps.clear();
+	m_plannedBytes = 0;
+
+	uint32_t heapCount = static_cast<uint32_t>(m_heaps.size());
+	m_heapRoles.assign(heapCount, SHR_DEFRAG_HEAP_NONE);
+
+	std::vector<uint64_t> freeBytes(heapCount);
+	std::vector<uint32_t> sources;
+	std::vector<uint32_t> dstOrder(heapCount);
+	for (uint32_t i = 0; i < heapCount; i++)
+	{
+		const Heap& heap = m_heaps[i];
+		freeBytes[i] = heap.capacity > heap.liveBytes ? heap.capacity - heap.liveBytes : 0;
+		dstOrder[i] = i;
+
+		if (heap.liveBytes > 0 && heap.liveBytes < heap.capacity * m_sparseThreshold)
+		{
+			sources.push_back(i);
+		}
+	}
+
+	auto occupancy = [this](uint32_t heap) { return m_heaps[heap].capacity ? double(m_heaps[heap].liveBytes) / double(m_heaps[heap].capacity) : 1.0; };
+
+	//evacuate the sparsest heaps first and pack into the densest ones
+	std::sort(sources.begin(), sources.end(), [&](uint32_t a, uint32_t b) { return occupancy(a) < occupancy(b); });
+	std::sort(dstOrder.begin(), dstOrder.end(), [&](uint32_t a, uint32_t b) { return occupancy(a) > occupancy(b); });
+
+	for (uint32_t src : sources)
+	{
+		if (m_heapRoles[src] != SHR_DEFRAG_HEAP_NONE) continue;
+		if (m_plannedBytes + m_heaps[src].liveBytes > m_frameByteBudget) continue;
+
+		if (PlanHeap(src, freeBytes, dstOrder))
+		{
+			m_evacuatedHeaps.push_back(src);
+			m_plannedBytes += m_heaps[src].liveBytes;
+		}
+	}
+}
+
+void SHRDefragmentationPlanner::Reset()
+{
+	m_heaps.clear();
+	m_blocks.clear();
+	m_moves.clear();
+	m_evacuatedHeaps.clear();
+	m_plannedBytes = 0;
+}
+
+bool SHRDefragmentationPlanner::PlanHeap(uint32_t srcHeap, std::vector<uint64_t>& freeBytes, const std::vector<uint32_t>& dstOrder)
+{
+	m_scratchBlocks.clear();
+	for (uint32_t i = 0; i < m_blocks.size(); i++)
+	{
+		if (m_blocks[i].heap == srcHeap) m_scratchBlocks.push_back(i);
+	}
+	//largest first, small blocks fill the gaps left behind
+	std::sort(m_scratchBlocks.begin(), m_scratchBlocks.end(), [this](uint32_t a, uint32_t b) { return m_blocks[a].size > m_blocks[b].size; });
+
+	size_t firstMove = m_moves.size();
+	std::vector<uint64_t> trialFreeBytes = freeBytes;
+
+	for (uint32_t blockIndex : m_scratchBlocks)
+	{
+		const Block& block = m_blocks[blockIndex];
+
+		int32_t dst = -1;
+		for (uint32_t heap : dstOrder)
+		{
+			if (heap == srcHeap || m_heapRoles[heap] == SHR_DEFRAG_HEAP_SOURCE) continue;
+			if (m_heaps[heap].heapClass != m_heaps[srcHeap].heapClass) continue;
+			if (trialFreeBytes[heap] < block.size) continue;
+
+			dst = static_cast<int32_t>(heap);
+			break;
+		}
+
+		if (dst == -1)
+		{
+			m_moves.resize(firstMove);
+			return false;
+		}
+
+		trialFreeBytes[dst] -= block.size;
+		m_moves.push_back({ srcHeap, static_cast<uint32_t>(dst), block.size, block.pUserData });
+	}
+
+	freeBytes.swap(trialFreeBytes);
+	m_heapRoles[srcHeap] = SHR_DEFRAG_HEAP_SOURCE;
+	for (size_t i = firstMove; i < m_moves.size(); i++)
+	{
+		m_heapRoles[m_moves[i].dstHeap] = SHR_DEFRAG_HEAP_DESTINATION;
+	}
+	return true;
+}
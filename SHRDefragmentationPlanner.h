@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define SHR_DEFRAG_DEFAULT_SPARSE_THRESHOLD 0.25f
+#define SHR_DEFRAG_DEFAULT_FRAME_BYTE_BUDGET 4096 * 1024  //KB = 4MB
+
+//chooses sparse heaps to evacuate and where their blocks go, no device involved.
+//blocks only move between heaps of the same class, free space is only tracked as a byte count
+//so a move may still fail on the real allocator, the caller then keeps the block where it is
+class SHRDefragmentationPlanner
+{
+public:
+	struct Heap
+	{
+		uint32_t heapClass;
+		uint64_t capacity;
+		uint64_t liveBytes;
+	};
+
+	struct Block
+	{
+		uint32_t heap;
+		uint64_t size;
+		void* pUserData;
+	};
+
+	struct Move
+	{
+		uint32_t srcHeap;
+		uint32_t dstHeap;
+		uint64_t size;
+		void* pUserData;
+	};
+
+public:
+	SHRDefragmentationPlanner(float sparseThreshold = SHR_DEFRAG_DEFAULT_SPARSE_THRESHOLD, uint64_t frameByteBudget = SHR_DEFRAG_DEFAULT_FRAME_BYTE_BUDGET);
+	~SHRDefragmentationPlanner() = default;
+
+	uint32_t AddHeap(uint32_t heapClass, uint64_t capacity);		//return heap index used by AddBlock
+	void AddBlock(uint32_t heap, uint64_t size, void* pUserData);
+
+	//a heap is evacuated whole or not at all, never more than frameByteBudget bytes are planned
+	void Plan();
+	void Reset();
+
+private:
+	bool PlanHeap(uint32_t srcHeap, std::vector<uint64_t>& freeBytes, const std::vector<uint32_t>& dstOrder);
+
+public:
+	float m_sparseThreshold;
+	uint64_t m_frameByteBudget;
+
+	std::vector<Heap> m_heaps;
+	std::vector<Block> m_blocks;
+
+	//results of the last Plan
+	std::vector<Move> m_moves;
+	std::vector<uint32_t> m_evacuatedHeaps;
+	uint64_t m_plannedBytes = 0;
+
+private:
+	std::vector<uint8_t> m_heapRoles;
+	std::vector<uint32_t> m_scratchBlocks;
+};
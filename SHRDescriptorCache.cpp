@@ -1,8 +1,16 @@
 #include "SHRDescriptorCache.h"
+#include "SHRHash.h"
 
-SHRDescriptorCache::SHRDescriptorCache(ID3D12Device* pDevice, UINT cbvSrvUavDescriptorCount, UINT samplerDescriptorCount)
+SHRDescriptorCache::SHRDescriptorCache(ID3D12Device* pDevice, ID3D12Fence* pFence, SHRDescriptorCachePolicy policy, UINT cbvSrvUavDescriptorCount, UINT samplerDescriptorCount)
 {
 	m_pDevice = pDevice;
+	m_pFence = pFence;
+	m_policy = policy;
+	m_heapVersion = 0;
+	m_boundHeapVersion = UINT64_MAX;
+	m_cachedTableFreeGeneration = SHRHeapSlotAllocator::GetFreeGeneration();
+	m_stats = {};
+
 	m_cbvSrvUavDescriptorCount = cbvSrvUavDescriptorCount;
 	m_samplerDescriptorCount = samplerDescriptorCount;
 
@@ -18,30 +26,124 @@ SHRDescriptorCache::~SHRDescriptorCache()
 
 }
 
-std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> SHRDescriptorCache::CacheCbvSrvUavDescriptor(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& descriptors)
+std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> SHRDescriptorCache::CacheCbvSrvUavDescriptor(const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count)
+{
+	return CacheDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, pDescriptors, count);
+}
+
+std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> SHRDescriptorCache::CacheSamplerDescriptor(const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count)
+{
+	return CacheDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, pDescriptors, count);
+}
+
+std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> SHRDescriptorCache::CacheDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE type, const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count)
 {
-	UINT requiredCacheSize = descriptors.size();
+	BOOL isSampler = type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+	ID3D12DescriptorHeap* pHeap = isSampler ? m_pSamplerHeap.Get() : m_pCbvSrvUavHeap.Get();
+	UINT incrementSize = isSampler ? m_samplerIncrementSize : m_cbvSrvUavIncrementSize;
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE cacheCPUHandle(m_pCbvSrvUavHeap->GetCPUDescriptorHandleForHeapStart(), m_cbvSrvUavOffset, m_cbvSrvUavIncrementSize);;
-	m_pDevice->CopyDescriptors(1, &cacheCPUHandle, &requiredCacheSize, requiredCacheSize, descriptors.data(), nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	//a handle cached earlier may belong to a freed view whose slot a new view took
+	uint64_t freeGeneration = SHRHeapSlotAllocator::GetFreeGeneration();
+	if (freeGeneration != m_cachedTableFreeGeneration)
+	{
+		ClearCachedTables();
+		m_cachedTableFreeGeneration = freeGeneration;
+	}
 
-	UINT beginOffset = m_cbvSrvUavOffset;
-	CD3DX12_GPU_DESCRIPTOR_HANDLE cacheGPUHandle(m_pCbvSrvUavHeap->GetGPUDescriptorHandleForHeapStart(), m_cbvSrvUavOffset, m_cbvSrvUavIncrementSize);
-	m_cbvSrvUavOffset += requiredCacheSize;
+	UINT64 hash = SHRHashBytes(&type, sizeof(type));
+	hash = SHRHashBytes(pDescriptors, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * count, hash);
+
+	//the same handle sequence was already copied this frame
+	INT cachedTable = FindCachedTable(hash, type, pDescriptors, count);
+	if (cachedTable != -1)
+	{
+		m_stats.tableHitCount++;
+		UINT cachedOffset = m_cachedTables[cachedTable].offset;
+		return { cachedOffset, CD3DX12_GPU_DESCRIPTOR_HANDLE(pHeap->GetGPUDescriptorHandleForHeapStart(), cachedOffset, incrementSize) };
+	}
+	m_stats.tableMissCount++;
+
+	UINT beginOffset = AllocateRange(type, count);
+
+	//AllocateRange may have replaced the heap
+	pHeap = isSampler ? m_pSamplerHeap.Get() : m_pCbvSrvUavHeap.Get();
+
+	PendingCopies& copies = isSampler ? m_pendingSamplerCopies : m_pendingCbvSrvUavCopies;
+	copies.destRangeStarts.push_back(CD3DX12_CPU_DESCRIPTOR_HANDLE(pHeap->GetCPUDescriptorHandleForHeapStart(), beginOffset, incrementSize));
+	copies.destRangeSizes.push_back(count);
+	copies.srcDescriptors.insert(copies.srcDescriptors.end(), pDescriptors, pDescriptors + count);
+
+	AddCachedTable(hash, type, pDescriptors, count, beginOffset);
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE cacheGPUHandle(pHeap->GetGPUDescriptorHandleForHeapStart(), beginOffset, incrementSize);
 	return { beginOffset, cacheGPUHandle };
 }
 
-std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> SHRDescriptorCache::CacheSamplerDescriptor(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& descriptors)
+INT SHRDescriptorCache::FindCachedTable(UINT64 hash, D3D12_DESCRIPTOR_HEAP_TYPE type, const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count)
 {
-	UINT requiredCacheSize = descriptors.size();
+	auto iter = m_cachedTableLookup.find(hash);
+	if (iter == m_cachedTableLookup.end()) return -1;
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE cacheCPUHandle(m_pSamplerHeap->GetCPUDescriptorHandleForHeapStart(), m_samplerOffset, m_samplerIncrementSize);
-	m_pDevice->CopyDescriptors(1, &cacheCPUHandle, &requiredCacheSize, requiredCacheSize, descriptors.data(), nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+	for (INT index = iter->second; index != -1; index = m_cachedTables[index].next)
+	{
+		const CachedTable& table = m_cachedTables[index];
+		if (table.type != type || table.count != count) continue;
 
-	UINT beginOffset = m_samplerOffset;
-	CD3DX12_GPU_DESCRIPTOR_HANDLE cacheGPUHandle(m_pSamplerHeap->GetGPUDescriptorHandleForHeapStart(), m_samplerOffset, m_samplerIncrementSize);
-	m_samplerOffset += requiredCacheSize;
-	return { beginOffset, cacheGPUHandle };
+		UINT i = 0;
+		for (; i < count; i++)
+		{
+			if (m_cachedTableHandles[table.firstHandle + i].ptr != pDescriptors[i].ptr) break;
+		}
+		if (i == count) return index;
+	}
+
+	return -1;
+}
+
+void SHRDescriptorCache::AddCachedTable(UINT64 hash, D3D12_DESCRIPTOR_HEAP_TYPE type, const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count, UINT offset)
+{
+	CachedTable table = {};
+	table.type = type;
+	table.offset = offset;
+	table.count = count;
+	table.firstHandle = m_cachedTableHandles.size();
+	table.next = -1;
+
+	m_cachedTableHandles.insert(m_cachedTableHandles.end(), pDescriptors, pDescriptors + count);
+
+	auto [iter, inserted] = m_cachedTableLookup.emplace(hash, (INT)m_cachedTables.size());
+	if (!inserted)
+	{
+		table.next = iter->second;
+		iter->second = (INT)m_cachedTables.size();
+	}
+	m_cachedTables.push_back(table);
+}
+
+void SHRDescriptorCache::FlushCopies()
+{
+	FlushCopies(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_pendingCbvSrvUavCopies);
+	FlushCopies(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, m_pendingSamplerCopies);
+}
+
+void SHRDescriptorCache::FlushCopies(D3D12_DESCRIPTOR_HEAP_TYPE type, PendingCopies& copies)
+{
+	if (copies.destRangeStarts.empty()) return;
+
+	//a null source size array makes every source range a single descriptor
+	m_pDevice->CopyDescriptors(copies.destRangeStarts.size(), copies.destRangeStarts.data(), copies.destRangeSizes.data(),
+		copies.srcDescriptors.size(), copies.srcDescriptors.data(), nullptr, type);
+
+	copies.destRangeStarts.clear();
+	copies.destRangeSizes.clear();
+	copies.srcDescriptors.clear();
+}
+
+void SHRDescriptorCache::ClearCachedTables()
+{
+	m_cachedTableLookup.clear();
+	m_cachedTables.clear();
+	m_cachedTableHandles.clear();
 }
 
 void SHRDescriptorCache::CreateCbvSrvUavHeap()
@@ -53,7 +155,7 @@ void SHRDescriptorCache::CreateCbvSrvUavHeap()
 	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
 	ThrowIfFailed(m_pDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&m_pCbvSrvUavHeap)));
-	m_cbvSrvUavOffset = 0;
+	m_cbvSrvUavRing.Initialize(m_cbvSrvUavDescriptorCount);
 }
 
 void SHRDescriptorCache::CreateSamplerHeap()
@@ -65,13 +167,95 @@ void SHRDescriptorCache::CreateSamplerHeap()
 	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
 	ThrowIfFailed(m_pDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&m_pSamplerHeap)));
-	m_samplerOffset = 0;
+	m_samplerRing.Initialize(m_samplerDescriptorCount);
+}
+
+UINT SHRDescriptorCache::AllocateRange(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count)
+{
+	if (count == 0) return 0;
+
+	BOOL isSampler = type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+	UINT maxDescriptorCount = isSampler ? D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE : D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_1;
+
+	UINT64 offset = (isSampler ? m_samplerRing : m_cbvSrvUavRing).Allocate(count);
+	if (offset == SHR_RING_INVALID_OFFSET) m_stats.overflowCount++;
+
+	while (offset == SHR_RING_INVALID_OFFSET)
+	{
+		//GrowHeap replaces the ring, so it is looked up again on every try
+		SHRRingAllocationManager& ring = isSampler ? m_samplerRing : m_cbvSrvUavRing;
+		UINT64 oldestFenceValue = ring.m_frameUsedSizes.GetOldestFenceValue();
+
+		if (m_policy == SHRDescriptorCachePolicy::Grow && ring.m_size < maxDescriptorCount)
+		{
+			GrowHeap(type, count);
+		}
+		else if (oldestFenceValue != UINT64_MAX)
+		{
+			//a null event blocks until the fence reaches the value
+			ThrowIfFailed(m_pFence->SetEventOnCompletion(oldestFenceValue, nullptr));
+			ring.Retire(oldestFenceValue);
+			m_stats.stallCount++;
+		}
+		else
+		{
+			//the current frame alone fills the whole heap
+			ThrowIfFailed(E_OUTOFMEMORY);
+		}
+
+		offset = (isSampler ? m_samplerRing : m_cbvSrvUavRing).Allocate(count);
+	}
+
+	SHRRingAllocationManager& ring = isSampler ? m_samplerRing : m_cbvSrvUavRing;
+	UINT64& highWaterMark = isSampler ? m_stats.samplerHighWaterMark : m_stats.cbvSrvUavHighWaterMark;
+	highWaterMark = max(highWaterMark, ring.m_usedSize);
+
+	return static_cast<UINT>(offset);
+}
+
+void SHRDescriptorCache::GrowHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT requiredCount)
+{
+	if (type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
+	{
+		m_pendingRetiredHeaps.push_back(m_pSamplerHeap);
+		m_samplerDescriptorCount = min(max(m_samplerDescriptorCount * 2, requiredCount), (UINT)D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE);
+		CreateSamplerHeap();
+	}
+	else
+	{
+		m_pendingRetiredHeaps.push_back(m_pCbvSrvUavHeap);
+		m_cbvSrvUavDescriptorCount = min(max(m_cbvSrvUavDescriptorCount * 2, requiredCount), (UINT)D3D12_MAX_SHADER_VISIBLE_DESCRIPTOR_HEAP_SIZE_TIER_1);
+		CreateCbvSrvUavHeap();
+	}
+
+	//cached offsets point into the replaced heap
+	ClearCachedTables();
+
+	m_heapVersion++;
+	m_stats.growCount++;
+}
+
+void SHRDescriptorCache::FinishFrame(UINT64 fenceValue)
+{
+	m_cbvSrvUavRing.FinishFrame(fenceValue);
+	m_samplerRing.FinishFrame(fenceValue);
+
+	for (size_t i = 0; i < m_pendingRetiredHeaps.size(); i++)
+	{
+		m_retiredHeaps.Push(m_pendingRetiredHeaps[i], fenceValue);
+	}
+	m_pendingRetiredHeaps.clear();
+
+	ClearCachedTables();
 }
 
-void SHRDescriptorCache::ClearCache()
+void SHRDescriptorCache::Retire(UINT64 completedFenceValue)
 {
-	m_samplerOffset = 0;
-	m_cbvSrvUavOffset = 0;
+	m_cbvSrvUavRing.Retire(completedFenceValue);
+	m_samplerRing.Retire(completedFenceValue);
+
+	//popping the entry releases the heap
+	m_retiredHeaps.Retire(completedFenceValue, [](Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>&) {});
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE SHRDescriptorCache::GetCbvSrvUavHeapBaseHandle()
@@ -82,4 +266,12 @@ D3D12_GPU_DESCRIPTOR_HANDLE SHRDescriptorCache::GetCbvSrvUavHeapBaseHandle()
 D3D12_GPU_DESCRIPTOR_HANDLE SHRDescriptorCache::GetSamplerHeapBaseHandle()
 {
 	return m_pSamplerHeap->GetGPUDescriptorHandleForHeapStart();
+}
+
+void SHRDescriptorCache::SetDescriptorHeaps(ID3D12GraphicsCommandList* pCmdList)
+{
+	ID3D12DescriptorHeap* ppHeaps[] = { m_pCbvSrvUavHeap.Get(), m_pSamplerHeap.Get() };
+	pCmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+	m_boundHeapVersion = m_heapVersion;
 }
\ No newline at end of file
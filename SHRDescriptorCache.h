@@ -1,28 +1,92 @@
 #pragma once
 
+#include <unordered_map>
+
+#include "d3dx12.h"
 #include "SHRHeapSlotAllocator.h"
+#include "SHRFencedQueue.h"
+#include "SHRRingAllocationManager.h"
 
 #define SHR_DEFAULT_CBV_SRV_UAV_DESCRIPTOR_COUNT 1024
 #define SHR_DEFAULT_SAMPLER_DESCRIPTOR_COUNT 256
 
+//what to do when a table does not fit in the ring
+enum class SHRDescriptorCachePolicy : uint8_t
+{
+	Stall,		//block until the oldest frame in flight retires
+	Grow		//replace the heap with a larger one, tables cached before are cached again & the heaps set again on the command list
+};
+
+struct SHRDescriptorCacheStats
+{
+	UINT64 cbvSrvUavHighWaterMark;
+	UINT64 samplerHighWaterMark;
+	UINT64 overflowCount;
+	UINT64 stallCount;
+	UINT64 growCount;
+
+	UINT64 tableHitCount;
+	UINT64 tableMissCount;
+};
+
+//shader visible heaps used as fence gated rings, every table is a contiguous range
 class SHRDescriptorCache
 {
 public:
-	SHRDescriptorCache(ID3D12Device* pDevice, UINT cbvSrvUavDescriptorCount = SHR_DEFAULT_CBV_SRV_UAV_DESCRIPTOR_COUNT, UINT samplerDescriptorCount = SHR_DEFAULT_SAMPLER_DESCRIPTOR_COUNT);
+	//a table already copied this frame, tables sharing a hash are chained through next
+	struct CachedTable
+	{
+		D3D12_DESCRIPTOR_HEAP_TYPE type;
+		UINT offset;
+		UINT count;
+		UINT firstHandle;
+		INT next;
+	};
+
+	//destination ranges and flattened single descriptor sources of one CopyDescriptors call
+	struct PendingCopies
+	{
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> destRangeStarts;
+		std::vector<UINT> destRangeSizes;
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> srcDescriptors;
+	};
+
+public:
+	SHRDescriptorCache(ID3D12Device* pDevice, ID3D12Fence* pFence, SHRDescriptorCachePolicy policy = SHRDescriptorCachePolicy::Stall, UINT cbvSrvUavDescriptorCount = SHR_DEFAULT_CBV_SRV_UAV_DESCRIPTOR_COUNT, UINT samplerDescriptorCount = SHR_DEFAULT_SAMPLER_DESCRIPTOR_COUNT);
 	~SHRDescriptorCache();
 
-	std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> CacheCbvSrvUavDescriptor(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& descriptors);
-	std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> CacheSamplerDescriptor(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& descriptors);
+	//the copy into the shader visible heap is deferred until FlushCopies, which must run before the command list is executed
+	std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> CacheCbvSrvUavDescriptor(const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count);
+	std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> CacheSamplerDescriptor(const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count);
+
+	//issues one multi range CopyDescriptors per heap type for every table cached since the last flush
+	void FlushCopies();
 
-	void ClearCache();
+	//tables cached since the last call are retired with fenceValue
+	void FinishFrame(UINT64 fenceValue);
+	void Retire(UINT64 completedFenceValue);
 
 	D3D12_GPU_DESCRIPTOR_HANDLE GetCbvSrvUavHeapBaseHandle();
 	D3D12_GPU_DESCRIPTOR_HANDLE GetSamplerHeapBaseHandle();
 
+	//after every command list Reset, and again whenever m_heapVersion moved past m_boundHeapVersion
+	void SetDescriptorHeaps(ID3D12GraphicsCommandList* pCmdList);
+
+	const SHRDescriptorCacheStats& GetStats() const { return m_stats; }
+
 private:
 	void CreateCbvSrvUavHeap();
 	void CreateSamplerHeap();
 
+	UINT AllocateRange(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count);
+	void GrowHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT requiredCount);
+
+	std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE> CacheDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE type, const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count);
+	INT FindCachedTable(UINT64 hash, D3D12_DESCRIPTOR_HEAP_TYPE type, const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count);
+	void AddCachedTable(UINT64 hash, D3D12_DESCRIPTOR_HEAP_TYPE type, const D3D12_CPU_DESCRIPTOR_HANDLE* pDescriptors, UINT count, UINT offset);
+	void ClearCachedTables();
+	void FlushCopies(D3D12_DESCRIPTOR_HEAP_TYPE type, PendingCopies& copies);
+
 public:
 	//only sampler & cbv_srv_uav need to be cached on GPU
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_pCbvSrvUavHeap;
@@ -36,11 +100,30 @@ public:
 	UINT m_cbvSrvUavDescriptorCount;
 	UINT m_samplerDescriptorCount;
 
-	UINT m_cbvSrvUavOffset;
-	UINT m_samplerOffset;
+	SHRRingAllocationManager m_cbvSrvUavRing;
+	SHRRingAllocationManager m_samplerRing;
+
+	SHRDescriptorCachePolicy m_policy;
+	UINT64 m_heapVersion;			//bumped by GrowHeap
+	UINT64 m_boundHeapVersion;		//heaps last set on the command list
+	SHRDescriptorCacheStats m_stats;
 
 private:
 	ID3D12Device* m_pDevice;
+	ID3D12Fence* m_pFence;
 
-};
+	//keyed by the CPU handle values only, so the lookup is dropped once a staging slot was freed and may hold another view.
+	//a slot must still not be rewritten in place while its tables are cached. ranges retire per frame, so the lookup never outlives the frame that copied the table
+	std::unordered_map<UINT64, INT> m_cachedTableLookup;
+	uint64_t m_cachedTableFreeGeneration;
+	std::vector<CachedTable> m_cachedTables;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_cachedTableHandles;
 
+	//cleared after every flush, the storage is kept to avoid reallocating each frame
+	PendingCopies m_pendingCbvSrvUavCopies;
+	PendingCopies m_pendingSamplerCopies;
+
+	//heaps replaced by GrowHeap stay alive until the frames referencing them retire
+	std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> m_pendingRetiredHeaps;
+	SHRFencedQueue<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> m_retiredHeaps;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <cstddef>
+
+//items retired on the GPU timeline, an item is released once the completed fence value
+//reaches the value it was pushed with. fence values must be pushed in non-decreasing order
+template <typename T>
+class SHRFencedQueue
+{
+public:
+	struct Entry
+	{
+		uint64_t fenceValue;
+		T item;
+	};
+
+public:
+	void Push(const T& item, uint64_t fenceValue)
+	{
+		m_entries.push_back({ fenceValue, item });
+	}
+
+	template <typename Func>
+	void Retire(uint64_t completedFenceValue, Func&& release)
+	{
+		while (!m_entries.empty() && m_entries.front().fenceValue <= completedFenceValue)
+		{
+			release(m_entries.front().item);
+			m_entries.pop_front();
+		}
+	}
+
+	template <typename Func>
+	void RetireAll(Func&& release)
+	{
+		Retire(UINT64_MAX, release);
+	}
+
+	bool Empty() const { return m_entries.empty(); }
+	size_t Size() const { return m_entries.size(); }
+
+	uint64_t GetOldestFenceValue() const { return m_entries.empty() ? UINT64_MAX : m_entries.front().fenceValue; }
+
+public:
+	std::deque<Entry> m_entries;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#define SHR_FNV_OFFSET_BASIS 14695981039346656037ULL
+#define SHR_FNV_PRIME 1099511628211ULL
+
+//64 bit FNV-1a, pass the previous result as hash to chain several buffers
+inline uint64_t SHRHashBytes(const void* pData, size_t size, uint64_t hash = SHR_FNV_OFFSET_BASIS)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= SHR_FNV_PRIME;
+	}
+	return hash;
+}
+
+//same hash over a null terminated string, constexpr so names known at build time cost nothing at runtime
+constexpr uint64_t SHRHashString(const char* pText, uint64_t hash = SHR_FNV_OFFSET_BASIS)
+{
+	for (; *pText; pText++)
+	{
+		hash ^= static_cast<uint8_t>(*pText);
+		hash *= SHR_FNV_PRIME;
+	}
+	return hash;
+}
+
+//folds the 8 bytes of value into hash, matches SHRHashBytes(&value, 8, hash) on little endian
+constexpr uint64_t SHRHashCombine(uint64_t hash, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xff;
+		hash *= SHR_FNV_PRIME;
+	}
+	return hash;
+}
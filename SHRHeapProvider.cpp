@@ -0,0 +1,49 @@
+#include "SHRHeapProvider.h"
+#include "SHRMemoryBudget.h"
+
+bool SHRHeapProvider::CanCreateHeap(uint64_t size)
+{
+	return !m_pBudget || m_pBudget->RequestCommit(m_budgetHeapType, size);
+}
+
+SHRNullHeapProvider::~SHRNullHeapProvider()
+{
+	for (uint32_t i = 0; i < m_heaps.size(); i++)
+	{
+		ReleaseHeap(i);
+	}
+}
+
+uint32_t SHRNullHeapProvider::CreateHeap(uint64_t size, uint64_t alignment)
+{
+	m_heaps.push_back({ size, 0, false });
+
+	m_committedBytes += size;
+	if (m_committedBytes > m_peakCommittedBytes) m_peakCommittedBytes = m_committedBytes;
+	if (m_pBudget) m_pBudget->OnCommit(m_budgetHeapType, size);
+
+	return static_cast<uint32_t>(m_heaps.size() - 1);
+}
+
+void SHRNullHeapProvider::ReleaseHeap(uint32_t heapIndex)
+{
+	HeapRecord& heap = m_heaps[heapIndex];
+	if (heap.released) return;
+
+	heap.released = true;
+	m_committedBytes -= heap.size;
+	if (m_pBudget) m_pBudget->OnRelease(m_budgetHeapType, heap.size);
+}
+
+void SHRNullHeapProvider::OnAllocate(uint32_t heapIndex, uint64_t offset, uint64_t size)
+{
+	m_heaps[heapIndex].liveBytes += size;
+	m_liveBytes += size;
+	if (m_liveBytes > m_peakLiveBytes) m_peakLiveBytes = m_liveBytes;
+}
+
+void SHRNullHeapProvider::OnFree(uint32_t heapIndex, uint64_t offset, uint64_t size)
+{
+	m_heaps[heapIndex].liveBytes -= size;
+	m_liveBytes -= size;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class SHRMemoryBudget;
+
+//backing storage for the allocation managers, the managers only deal with heap indices and offsets
+class SHRHeapProvider
+{
+public:
+	virtual ~SHRHeapProvider() = default;
+
+	virtual uint32_t CreateHeap(uint64_t size, uint64_t alignment) = 0;
+	virtual void ReleaseHeap(uint32_t heapIndex) = 0;
+
+	//placement notifications, a device backed provider has nothing to do here
+	virtual void OnAllocate(uint32_t heapIndex, uint64_t offset, uint64_t size) {}
+	virtual void OnFree(uint32_t heapIndex, uint64_t offset, uint64_t size) {}
+
+	//every heap created or released from now on is reported to pBudget as heapType
+	void SetBudget(SHRMemoryBudget* pBudget, uint32_t heapType) { m_pBudget = pBudget; m_budgetHeapType = heapType; }
+	bool CanCreateHeap(uint64_t size);
+
+protected:
+	SHRMemoryBudget* m_pBudget = nullptr;
+	uint32_t m_budgetHeapType = 0;
+};
+
+//records heaps and the bytes placed in them without a device, used to run the allocation managers off a GPU box
+class SHRNullHeapProvider : public SHRHeapProvider
+{
+public:
+	struct HeapRecord
+	{
+		uint64_t size;
+		uint64_t liveBytes;
+		bool released;
+	};
+
+public:
+	SHRNullHeapProvider() = default;
+	~SHRNullHeapProvider();
+
+	uint32_t CreateHeap(uint64_t size, uint64_t alignment);
+	void ReleaseHeap(uint32_t heapIndex);
+
+	void OnAllocate(uint32_t heapIndex, uint64_t offset, uint64_t size);
+	void OnFree(uint32_t heapIndex, uint64_t offset, uint64_t size);
+
+public:
+	std::vector<HeapRecord> m_heaps;
+
+	uint64_t m_committedBytes = 0;
+	uint64_t m_peakCommittedBytes = 0;
+	uint64_t m_liveBytes = 0;
+	uint64_t m_peakLiveBytes = 0;
+};
@@ -1,4 +1,40 @@
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
 #include "SHRHeapSlotAllocator.h"
+#include "SHRBitUtils.h"
+
+//live allocators by id, an exiting thread only drains its magazines into allocators still listed here
+static std::mutex g_slotAllocatorRegistryMutex;
+static std::unordered_map<uint64_t, SHRHeapSlotAllocator*> g_slotAllocatorRegistry;
+static std::atomic<uint64_t> g_nextSlotAllocatorId = 0;
+
+std::atomic<uint64_t> SHRHeapSlotAllocator::s_freeGeneration = 0;
+
+struct SHRSlotThreadCache
+{
+	struct Entry
+	{
+		uint64_t allocatorId;
+		SHRHeapSlotAllocator::Magazine magazine;
+	};
+
+	~SHRSlotThreadCache()
+	{
+		std::lock_guard<std::mutex> registryLock(g_slotAllocatorRegistryMutex);
+		for (Entry& entry : entries)
+		{
+			auto iter = g_slotAllocatorRegistry.find(entry.allocatorId);
+			if (iter != g_slotAllocatorRegistry.end()) iter->second->FlushThreadCache();
+		}
+	}
+
+	//one entry per allocator this thread has touched, there are only a handful of allocators
+	std::vector<Entry> entries;
+};
+
+static thread_local SHRSlotThreadCache t_slotThreadCache;
 
 D3D12_DESCRIPTOR_HEAP_DESC SHRHeapSlotAllocator::CreateHeapDesc(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT numDescriptors)
 {
@@ -19,6 +55,92 @@ SHRHeapSlotAllocator::SHRHeapSlotAllocator(ID3D12Device* pDevice, D3D12_DESCRIPT
 	m_incrementSize = m_pDevice->GetDescriptorHandleIncrementSize(type);
 	
 	AllocateNewHeap();
+
+	m_allocatorId = g_nextSlotAllocatorId++;
+	std::lock_guard<std::mutex> registryLock(g_slotAllocatorRegistryMutex);
+	g_slotAllocatorRegistry[m_allocatorId] = this;
+}
+
+SHRHeapSlotAllocator::~SHRHeapSlotAllocator()
+{
+	//magazines still holding slots of this allocator are dropped with their threads
+	std::lock_guard<std::mutex> registryLock(g_slotAllocatorRegistryMutex);
+	g_slotAllocatorRegistry.erase(m_allocatorId);
+}
+
+SHRHeapSlotAllocator::Magazine& SHRHeapSlotAllocator::GetThreadMagazine()
+{
+	std::vector<SHRSlotThreadCache::Entry>& entries = t_slotThreadCache.entries;
+	for (SHRSlotThreadCache::Entry& entry : entries)
+	{
+		if (entry.allocatorId == m_allocatorId) return entry.magazine;
+	}
+
+	SHRSlotThreadCache::Entry entry = {};
+	entry.allocatorId = m_allocatorId;
+	entries.push_back(entry);
+	return entries.back().magazine;
+}
+
+SHRHeapSlotAllocator::HeapSlot SHRHeapSlotAllocator::AllocateSlot()
+{
+	Magazine& magazine = GetThreadMagazine();
+	if (magazine.count == 0)
+	{
+		//refill half a magazine under a single lock
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while (magazine.count < SHR_SLOT_MAGAZINE_SIZE / 2)
+		{
+			magazine.slots[magazine.count++] = AllocateRangeLocked(1);
+		}
+	}
+
+	return magazine.slots[--magazine.count];
+}
+
+void SHRHeapSlotAllocator::DeallocateSlot(const HeapSlot& slot)
+{
+	//before the slot can be handed out again, the magazine gives it to the next view on this thread
+	s_freeGeneration.fetch_add(1, std::memory_order_release);
+
+	Magazine& magazine = GetThreadMagazine();
+	if (magazine.count == SHR_SLOT_MAGAZINE_SIZE)
+	{
+		//keep the most recently freed half, hand the older half back
+		ReturnSlots(magazine.slots, SHR_SLOT_MAGAZINE_SIZE / 2);
+		std::copy(magazine.slots + SHR_SLOT_MAGAZINE_SIZE / 2, magazine.slots + SHR_SLOT_MAGAZINE_SIZE, magazine.slots);
+		magazine.count -= SHR_SLOT_MAGAZINE_SIZE / 2;
+	}
+
+	magazine.slots[magazine.count++] = slot;
+}
+
+void SHRHeapSlotAllocator::FlushThreadCache()
+{
+	Magazine& magazine = GetThreadMagazine();
+	ReturnSlots(magazine.slots, magazine.count);
+	magazine.count = 0;
+}
+
+void SHRHeapSlotAllocator::FlushAllThreadCaches()
+{
+	std::lock_guard<std::mutex> registryLock(g_slotAllocatorRegistryMutex);
+	for (SHRSlotThreadCache::Entry& entry : t_slotThreadCache.entries)
+	{
+		auto iter = g_slotAllocatorRegistry.find(entry.allocatorId);
+		if (iter != g_slotAllocatorRegistry.end()) iter->second->FlushThreadCache();
+	}
+}
+
+void SHRHeapSlotAllocator::ReturnSlots(const HeapSlot* pSlots, UINT count)
+{
+	if (count == 0) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (UINT i = 0; i < count; i++)
+	{
+		DeallocateRangeLocked(pSlots[i], 1);
+	}
 }
 
 void SHRHeapSlotAllocator::AllocateNewHeap()
@@ -26,69 +148,87 @@ void SHRHeapSlotAllocator::AllocateNewHeap()
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pHeap;
 	ThrowIfFailed(m_pDevice->CreateDescriptorHeap(&m_desc, IID_PPV_ARGS(&pHeap)));
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(pHeap->GetCPUDescriptorHandleForHeapStart());
-
 	HeapEntry entry;
 	entry.pHeap = pHeap;
-	entry.freeList.emplace_back(handle.ptr,handle.ptr + m_incrementSize * m_desc.NumDescriptors);
+	entry.heapStart = pHeap->GetCPUDescriptorHandleForHeapStart().ptr;
+	entry.slotManager.Initialize(m_desc.NumDescriptors);
 	
 	heapMap.emplace_back(std::move(entry));
+
+	if (m_availableHeapBits.size() * 64 < heapMap.size()) m_availableHeapBits.push_back(0);
+	UpdateHeapAvailability(heapMap.size() - 1);
 }
 
-SHRHeapSlotAllocator::HeapSlot SHRHeapSlotAllocator::AllocateSlot()
+SHRHeapSlotAllocator::HeapSlot SHRHeapSlotAllocator::AllocateRange(UINT count)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return AllocateRangeLocked(count);
+}
+
+void SHRHeapSlotAllocator::DeallocateRange(const HeapSlot& slot, UINT count)
 {
+	s_freeGeneration.fetch_add(1, std::memory_order_release);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	DeallocateRangeLocked(slot, count);
+}
+
+SHRHeapSlotAllocator::HeapSlot SHRHeapSlotAllocator::AllocateRangeLocked(UINT count)
+{
+	if (count == 0 || count > m_desc.NumDescriptors) ThrowIfFailed(E_INVALIDARG);
+
 	HeapSlot slot = {};
 
-	int heapIndex = -1;
-	for (size_t i = 0; i < heapMap.size(); i++)
+	//only heaps with a free slot are visited, single slots always succeed on the first one
+	for (size_t i = 0; i < m_availableHeapBits.size(); i++)
 	{
-		HeapEntry& entry = heapMap[i];
-		if (entry.freeList.size() != 0)
+		uint64_t heapBits = m_availableHeapBits[i];
+		while (heapBits)
 		{
-			heapIndex = i;
-			break;
+			UINT heapIndex = static_cast<UINT>(i * 64 + SHRFindFirstSet(heapBits));
+			heapBits &= heapBits - 1;
+
+			HeapEntry& entry = heapMap[heapIndex];
+			uint32_t first = entry.slotManager.AllocateRange(count);
+			if (first == SHR_SLOT_INVALID_INDEX) continue;
+
+			UpdateHeapAvailability(heapIndex);
+			slot.heapIndex = heapIndex;
+			slot.slotHandle.ptr = entry.heapStart + static_cast<CPUHandleRaw>(first) * m_incrementSize;
+			return slot;
 		}
 	}
-	if (heapIndex == -1)
-	{
-		AllocateNewHeap();
-		heapIndex = heapMap.size() - 1;
-	}
 
+	AllocateNewHeap();
+	UINT heapIndex = heapMap.size() - 1;
 	HeapEntry& entry = heapMap[heapIndex];
-	FreeRange& range = entry.freeList.front();
-	slot.heapIndex = heapIndex;
-	slot.slotHandle.ptr = range.begin;
-
-	range.begin += m_incrementSize;
-	if (range.begin == range.end)
-	{
-		entry.freeList.erase(entry.freeList.begin());
-	}
+	uint32_t first = entry.slotManager.AllocateRange(count);
 
+	UpdateHeapAvailability(heapIndex);
+	slot.heapIndex = heapIndex;
+	slot.slotHandle.ptr = entry.heapStart + static_cast<CPUHandleRaw>(first) * m_incrementSize;
 	return slot;
 }
 
-void SHRHeapSlotAllocator::DeallocateSlot(const HeapSlot& slot)
+void SHRHeapSlotAllocator::DeallocateRangeLocked(const HeapSlot& slot, UINT count)
 {
-	//not the full version
-	//lack the situation that the deallocate block is next to both the prev and next block, so that they should be merged into one
-	//large block
-	//but it's not a big deal, the heap slot allocator is used to manage the descriptor heap, the availble size does not matter much 
 	HeapEntry& entry = heapMap[slot.heapIndex];
 	
-	for (auto& range : entry.freeList)
-	{
-		if (slot.slotHandle.ptr == range.end)
-		{
-			range.end += m_incrementSize;
-			return;
-		}
-		else if (slot.slotHandle.ptr + m_incrementSize == range.begin)
-		{
-			range.begin -= m_incrementSize;
-			return;
-		}
-	}
-	entry.freeList.emplace_back(slot.slotHandle.ptr,slot.slotHandle.ptr + m_incrementSize);
-}
\ No newline at end of file
+	uint32_t first = static_cast<uint32_t>((slot.slotHandle.ptr - entry.heapStart) / m_incrementSize);
+	entry.slotManager.DeallocateRange(first, count);
+	UpdateHeapAvailability(slot.heapIndex);
+}
+
+std::pair<UINT, UINT> SHRHeapSlotAllocator::GetHeapOccupancy(UINT heapIndex) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const HeapEntry& entry = heapMap[heapIndex];
+	return { entry.slotManager.GetUsedCount(), entry.slotManager.m_slotCount };
+}
+
+void SHRHeapSlotAllocator::UpdateHeapAvailability(UINT heapIndex)
+{
+	uint64_t heapMask = 1ULL << (heapIndex & 63);
+	if (heapMap[heapIndex].slotManager.m_freeCount) m_availableHeapBits[heapIndex >> 6] |= heapMask;
+	else m_availableHeapBits[heapIndex >> 6] &= ~heapMask;
+}
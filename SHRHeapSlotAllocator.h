@@ -1,15 +1,18 @@
 #pragma once
 
 #include <vector>
+#include <mutex>
+#include <atomic>
 
 #include <windows.h>
 #include <wrl.h>
 #include <d3d12.h>
 
-#include "d3dx12.h"
 #include "SHRUtils.h"
+#include "SHRSlotAllocationManager.h"
 
 #define SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE 1024
+#define SHR_SLOT_MAGAZINE_SIZE 32
 
 class SHRHeapSlotAllocator
 {
@@ -22,37 +25,70 @@ public:
 		D3D12_CPU_DESCRIPTOR_HANDLE slotHandle;
 	};
 
-	struct FreeRange
+	struct HeapEntry
 	{
-		CPUHandleRaw begin;
-		CPUHandleRaw end;
-
-		FreeRange(CPUHandleRaw a, CPUHandleRaw b) : begin(a), end(b) {};
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pHeap;
+		CPUHandleRaw heapStart;
+		SHRSlotAllocationManager slotManager;
 	};
 
-	struct HeapEntry
+	//single slots cached by one thread, refilled from and drained to the heaps half a magazine at a time
+	struct Magazine
 	{
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pHeap;
-		std::vector<FreeRange> freeList;
+		UINT count;
+		HeapSlot slots[SHR_SLOT_MAGAZINE_SIZE];
 	};
 
 public:
 	static D3D12_DESCRIPTOR_HEAP_DESC CreateHeapDesc(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT numDescriptors);
 
 	SHRHeapSlotAllocator(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT numDescriptors);
-	~SHRHeapSlotAllocator() = default;
+	~SHRHeapSlotAllocator();
 
+	//thread safe, single slots go through the calling thread's magazine and only lock when it runs dry or overflows
 	HeapSlot AllocateSlot();
 	void DeallocateSlot(const HeapSlot& slot);
 
+	//count contiguous slots in one heap, slotHandle is the first of them
+	HeapSlot AllocateRange(UINT count);
+	void DeallocateRange(const HeapSlot& slot, UINT count);
+
+	//hands the calling thread's cached slots back, e.g. before a loading thread goes idle
+	void FlushThreadCache();
+	static void FlushAllThreadCaches();
+
+	//slots sitting in magazines count as used
+	std::pair<UINT, UINT> GetHeapOccupancy(UINT heapIndex) const;		//return {used slots, total slots}
+
+	//bumped by every free of any allocator, a descriptor copied before may since name another view at the same handle
+	static uint64_t GetFreeGeneration() { return s_freeGeneration.load(std::memory_order_acquire); }
+
 private:
+	HeapSlot AllocateRangeLocked(UINT count);
+	void DeallocateRangeLocked(const HeapSlot& slot, UINT count);
+	void ReturnSlots(const HeapSlot* pSlots, UINT count);
+
+	Magazine& GetThreadMagazine();
+
 	void AllocateNewHeap();
+	void UpdateHeapAvailability(UINT heapIndex);
 
 public:
 	std::vector<HeapEntry> heapMap;
 	D3D12_DESCRIPTOR_HEAP_DESC m_desc;
 	UINT m_incrementSize;
 
+	//a set bit means the heap still has a free slot
+	std::vector<uint64_t> m_availableHeapBits;
+
+	//never reused, thread caches outlive allocators and must not hand slots to a new one at the same address
+	uint64_t m_allocatorId;
+
 protected:
+	static std::atomic<uint64_t> s_freeGeneration;
+
 	ID3D12Device* m_pDevice;
+
+	//guards heapMap and m_availableHeapBits
+	mutable std::mutex m_mutex;
 };
@@ -1,76 +1,197 @@
 #include "SHRMemoryAllocationManager.h"
+#include "SHRBitUtils.h"
 
 SHRMemoryAllocationManager::SHRMemoryAllocationManager(size_t totalSize)
 {
-	AddNewFreeBlock(0, totalSize);
-
+	m_totalSize = totalSize;
 	m_freeSize = totalSize;
+
+	for (uint32_t i = 0; i < SHR_MEMORY_SIZE_CLASS_COUNT; i++) m_freeHeads[i] = -1;
+
+	int32_t node = CreateBlockNode();
+	Block& block = m_blocks[node];
+	block.offset = 0;
+	block.size = totalSize;
+	block.prevPhysical = -1;
+	block.nextPhysical = -1;
+
+	InsertFreeBlock(node);
 }
 
-size_t SHRMemoryAllocationManager::Allocate(size_t size)
+SHRMemoryAllocationManager::SHRMemoryAllocationManager(SHRHeapProvider* pProvider, size_t totalSize, size_t alignment) : SHRMemoryAllocationManager(totalSize)
 {
-	if (!CanAllocate(size)) return -1;
+	m_pProvider = pProvider;
+	m_heapIndex = m_pProvider->CreateHeap(totalSize, alignment);
+}
+
+SHRMemoryAllocationManager::Allocation SHRMemoryAllocationManager::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0 || !CanAllocate(size)) return { SHR_MEMORY_INVALID_OFFSET, 0, -1 };
 
-	SHRFreeBlockBySizeMap::iterator itBySize = m_freeBlocksBySize.lower_bound(size);
-	SHRFreeBlocksByOffsetMap::iterator itByOffset = itBySize->second;
+	int32_t block = FindFreeBlock(size, alignment);
+	if (block == -1) return { SHR_MEMORY_INVALID_OFFSET, 0, -1 };
 
-	size_t newOffset = itByOffset->first;
-	size_t newSize = itByOffset->second.size - size;
+	RemoveFreeBlock(block);
 
-	m_freeBlocksByOffset.erase(itByOffset);
-	m_freeBlocksBySize.erase(itBySize);
-	if (newSize > 0)
+	//the padding in front of the aligned offset becomes a free block of its own
+	size_t padding = GetAlignedOffset(m_blocks[block].offset, alignment) - m_blocks[block].offset;
+	if (padding > 0)
 	{
-		AddNewFreeBlock(newOffset, newSize);
+		int32_t used = SplitBlock(block, padding);
+		InsertFreeBlock(block);
+		block = used;
 	}
+
+	if (m_blocks[block].size > size)
+	{
+		InsertFreeBlock(SplitBlock(block, size));
+	}
+
 	m_freeSize -= size;
-	return newOffset;
+	if (m_pProvider) m_pProvider->OnAllocate(m_heapIndex, m_blocks[block].offset, size);
+	return { m_blocks[block].offset, size, block };
 }
 
-void SHRMemoryAllocationManager::Free(size_t offset, size_t size)
+void SHRMemoryAllocationManager::Free(const Allocation& allocation)
 {
-	auto itNextByOffset = m_freeBlocksByOffset.upper_bound(offset);
-	auto itPrevByOffset = itNextByOffset == m_freeBlocksByOffset.begin() ? m_freeBlocksByOffset.end() : itNextByOffset--;
+	int32_t block = allocation.block;
+
+	m_freeSize += m_blocks[block].size;
+	if (m_pProvider) m_pProvider->OnFree(m_heapIndex, m_blocks[block].offset, m_blocks[block].size);
 
-	size_t newOffset, newSize;
-	if (itPrevByOffset != m_freeBlocksByOffset.end() && itPrevByOffset->first + itPrevByOffset->second.size == offset)
+	int32_t prev = m_blocks[block].prevPhysical;
+	if (prev != -1 && m_blocks[prev].free)
 	{
-		newOffset = itPrevByOffset->first;
-		newSize = itPrevByOffset->second.size + size;
-		m_freeBlocksBySize.erase(itPrevByOffset->second.bySizeIt);
-		m_freeBlocksByOffset.erase(itPrevByOffset);
-		if (itNextByOffset != m_freeBlocksByOffset.end() && offset + size == itNextByOffset->first)
-		{
-			newSize += itNextByOffset->second.size;
-			m_freeBlocksBySize.erase(itNextByOffset->second.bySizeIt);
-			m_freeBlocksByOffset.erase(itNextByOffset);
-		}
+		RemoveFreeBlock(prev);
+		MergeBlocks(prev, block);
+		block = prev;
 	}
-	else if (itNextByOffset != m_freeBlocksByOffset.end() && offset + size == itNextByOffset->first)
+
+	int32_t next = m_blocks[block].nextPhysical;
+	if (next != -1 && m_blocks[next].free)
 	{
-		newOffset = offset;
-		newSize = size + itNextByOffset->second.size;
-		m_freeBlocksBySize.erase(itNextByOffset->second.bySizeIt);
-		m_freeBlocksByOffset.erase(itNextByOffset);
+		RemoveFreeBlock(next);
+		MergeBlocks(block, next);
 	}
-	else
+
+	InsertFreeBlock(block);
+}
+
+size_t SHRMemoryAllocationManager::GetLargestFreeBlock() const
+{
+	if (m_sizeClassBitmap == 0) return 0;
+
+	size_t largest = 0;
+	for (int32_t block = m_freeHeads[SHRFindLastSet(m_sizeClassBitmap)]; block != -1; block = m_blocks[block].nextFree)
+	{
+		if (m_blocks[block].size > largest) largest = m_blocks[block].size;
+	}
+	return largest;
+}
+
+int32_t SHRMemoryAllocationManager::FindFreeBlock(size_t size, size_t alignment) const
+{
+	//blocks of the request's own class may still be too small, so that list is walked first fit
+	uint32_t sizeClass = SHRFindLastSet(size);
+	for (int32_t block = m_freeHeads[sizeClass]; block != -1; block = m_blocks[block].nextFree)
+	{
+		const Block& freeBlock = m_blocks[block];
+		if (GetAlignedOffset(freeBlock.offset, alignment) + size <= freeBlock.offset + freeBlock.size) return block;
+	}
+
+	//every block of a larger class is big enough unless the padding eats the difference
+	uint64_t classMap = sizeClass + 1 < SHR_MEMORY_SIZE_CLASS_COUNT ? m_sizeClassBitmap & (~0ULL << (sizeClass + 1)) : 0;
+	while (classMap)
 	{
-		newOffset = offset;
-		newSize = size;
+		uint32_t largerClass = SHRFindFirstSet(classMap);
+		classMap &= classMap - 1;
+
+		for (int32_t block = m_freeHeads[largerClass]; block != -1; block = m_blocks[block].nextFree)
+		{
+			const Block& freeBlock = m_blocks[block];
+			if (GetAlignedOffset(freeBlock.offset, alignment) + size <= freeBlock.offset + freeBlock.size) return block;
+		}
 	}
 
-	AddNewFreeBlock(newOffset, newSize);
-	m_freeSize += size;
+	return -1;
 }
 
-bool SHRMemoryAllocationManager::CanAllocate(size_t requiredSize)
+void SHRMemoryAllocationManager::InsertFreeBlock(int32_t block)
 {
-	return m_freeSize >= requiredSize;
+	uint32_t sizeClass = SHRFindLastSet(m_blocks[block].size);
+
+	Block& freeBlock = m_blocks[block];
+	freeBlock.free = 1;
+	freeBlock.prevFree = -1;
+	freeBlock.nextFree = m_freeHeads[sizeClass];
+	if (freeBlock.nextFree != -1) m_blocks[freeBlock.nextFree].prevFree = block;
+	m_freeHeads[sizeClass] = block;
+
+	m_sizeClassBitmap |= 1ULL << sizeClass;
 }
 
-void SHRMemoryAllocationManager::AddNewFreeBlock(size_t offset, size_t size)
+void SHRMemoryAllocationManager::RemoveFreeBlock(int32_t block)
 {
-	auto itByOffset = m_freeBlocksByOffset.emplace(offset, size);
-	auto itBySize = m_freeBlocksBySize.emplace(size, itByOffset.first);
-	itByOffset.first->second.bySizeIt = itBySize;
-}
\ No newline at end of file
+	uint32_t sizeClass = SHRFindLastSet(m_blocks[block].size);
+
+	Block& freeBlock = m_blocks[block];
+	if (freeBlock.prevFree != -1)
+		m_blocks[freeBlock.prevFree].nextFree = freeBlock.nextFree;
+	else
+		m_freeHeads[sizeClass] = freeBlock.nextFree;
+	if (freeBlock.nextFree != -1) m_blocks[freeBlock.nextFree].prevFree = freeBlock.prevFree;
+
+	freeBlock.free = 0;
+	freeBlock.prevFree = freeBlock.nextFree = -1;
+
+	if (m_freeHeads[sizeClass] == -1) m_sizeClassBitmap &= ~(1ULL << sizeClass);
+}
+
+int32_t SHRMemoryAllocationManager::SplitBlock(int32_t block, size_t size)
+{
+	//keeps the first size bytes in block and returns the node of the rest
+	int32_t rest = CreateBlockNode();
+	Block& headBlock = m_blocks[block];
+	Block& restBlock = m_blocks[rest];
+
+	restBlock.offset = headBlock.offset + size;
+	restBlock.size = headBlock.size - size;
+	restBlock.prevPhysical = block;
+	restBlock.nextPhysical = headBlock.nextPhysical;
+	restBlock.free = 0;
+	if (headBlock.nextPhysical != -1) m_blocks[headBlock.nextPhysical].prevPhysical = rest;
+
+	headBlock.nextPhysical = rest;
+	headBlock.size = size;
+
+	return rest;
+}
+
+void SHRMemoryAllocationManager::MergeBlocks(int32_t left, int32_t right)
+{
+	Block& leftBlock = m_blocks[left];
+	Block& rightBlock = m_blocks[right];
+
+	leftBlock.size += rightBlock.size;
+	leftBlock.nextPhysical = rightBlock.nextPhysical;
+	if (rightBlock.nextPhysical != -1) m_blocks[rightBlock.nextPhysical].prevPhysical = left;
+
+	ReleaseBlockNode(right);
+}
+
+int32_t SHRMemoryAllocationManager::CreateBlockNode()
+{
+	if (!m_unusedBlockNodes.empty())
+	{
+		int32_t node = m_unusedBlockNodes.back();
+		m_unusedBlockNodes.pop_back();
+		return node;
+	}
+	m_blocks.push_back({});
+	return static_cast<int32_t>(m_blocks.size() - 1);
+}
+
+void SHRMemoryAllocationManager::ReleaseBlockNode(int32_t block)
+{
+	m_unusedBlockNodes.push_back(block);
+}
@@ -1,38 +1,73 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
 
+#include "SHRHeapProvider.h"
+
+#define SHR_MEMORY_INVALID_OFFSET SIZE_MAX
+#define SHR_MEMORY_SIZE_CLASS_COUNT 64
+
+//first fit free block allocator over one range of bytes. block nodes are pooled in a flat array and linked
+//to their physical neighbours, free blocks are bucketed by power of two size class
 class SHRMemoryAllocationManager
 {
 public:
-	struct FreeBlockInfo;
-
-	using SHRFreeBlocksByOffsetMap = std::map<size_t, FreeBlockInfo>;
-	using SHRFreeBlockBySizeMap = std::multimap<size_t, SHRFreeBlocksByOffsetMap::iterator>;
-
-	struct FreeBlockInfo
+	struct Block
 	{
+		size_t offset;
 		size_t size;
-		SHRFreeBlockBySizeMap::iterator bySizeIt;
+		int32_t prevPhysical;
+		int32_t nextPhysical;
+		int32_t prevFree;
+		int32_t nextFree;
+		uint32_t free;
+	};
 
-		FreeBlockInfo(size_t s) : size(s) {};
+	//offset is already aligned, front padding is split off and stays free
+	struct Allocation
+	{
+		size_t offset;
+		size_t size;
+		int32_t block;
 	};
 
 public:
 	SHRMemoryAllocationManager(size_t totalSize);
+	SHRMemoryAllocationManager(SHRHeapProvider* pProvider, size_t totalSize, size_t alignment);
 	~SHRMemoryAllocationManager() = default;
 
-	size_t Allocate(size_t size);
-	void Free(size_t offset, size_t size);
+	Allocation Allocate(size_t size, size_t alignment = 1);		//offset is SHR_MEMORY_INVALID_OFFSET on failure
+	void Free(const Allocation& allocation);
 
-	bool CanAllocate(size_t requiredSize);
+	bool CanAllocate(size_t requiredSize) const { return m_freeSize >= requiredSize; }
+	size_t GetLargestFreeBlock() const;
 
 private:
-	void AddNewFreeBlock(size_t offset, size_t size);
+	int32_t FindFreeBlock(size_t size, size_t alignment) const;
+	void InsertFreeBlock(int32_t block);
+	void RemoveFreeBlock(int32_t block);
+	int32_t SplitBlock(int32_t block, size_t size);
+	void MergeBlocks(int32_t left, int32_t right);
+
+	int32_t CreateBlockNode();
+	void ReleaseBlockNode(int32_t block);
+
+	static size_t GetAlignedOffset(size_t offset, size_t alignment) { return (offset + alignment - 1) / alignment * alignment; }
 
 public:
+	size_t m_totalSize;
 	size_t m_freeSize;
-	SHRFreeBlocksByOffsetMap m_freeBlocksByOffset;
-	SHRFreeBlockBySizeMap m_freeBlocksBySize;
-};
 
+	std::vector<Block> m_blocks;
+	std::vector<int32_t> m_unusedBlockNodes;
+
+	uint64_t m_sizeClassBitmap = 0;
+	int32_t m_freeHeads[SHR_MEMORY_SIZE_CLASS_COUNT];
+
+	uint32_t m_heapIndex = 0;
+
+private:
+	SHRHeapProvider* m_pProvider = nullptr;
+};
@@ -0,0 +1,72 @@
+#include "SHRMemoryBudget.h"
+
+SHRMemoryBudget::SHRMemoryBudget(SHRMemoryBudgetPolicy policy) : m_policy(policy)
+{
+}
+
+void SHRMemoryBudget::AddResidencyThreshold(uint32_t heapType, uint64_t bytes)
+{
+	m_thresholds.push_back({ heapType, bytes, m_usages[heapType].committedBytes >= bytes });
+}
+
+bool SHRMemoryBudget::RequestCommit(uint32_t heapType, uint64_t size)
+{
+	if (FitsBudget(heapType, size)) return true;
+
+	//a trim callback may release heaps, which reports back here but must not trim again
+	if (m_policy == SHRMemoryBudgetPolicy::Trim && !m_isTrimming)
+	{
+		m_isTrimming = true;
+		for (TrimCallback& callback : m_trimCallbacks)
+		{
+			callback(heapType);
+			if (FitsBudget(heapType, size)) break;
+		}
+		m_isTrimming = false;
+
+		if (FitsBudget(heapType, size)) return true;
+	}
+
+	m_usages[heapType].refusedCount++;
+	return false;
+}
+
+void SHRMemoryBudget::OnCommit(uint32_t heapType, uint64_t size)
+{
+	Usage& usage = m_usages[heapType];
+	usage.committedBytes += size;
+	usage.heapCount++;
+	if (usage.committedBytes > usage.peakCommittedBytes) usage.peakCommittedBytes = usage.committedBytes;
+
+	UpdateThresholds(heapType);
+}
+
+void SHRMemoryBudget::OnRelease(uint32_t heapType, uint64_t size)
+{
+	Usage& usage = m_usages[heapType];
+	usage.committedBytes -= size;
+	usage.heapCount--;
+
+	UpdateThresholds(heapType);
+}
+
+bool SHRMemoryBudget::FitsBudget(uint32_t heapType, uint64_t size) const
+{
+	uint64_t budget = m_budgets[heapType];
+	return budget == SHR_MEMORY_BUDGET_UNLIMITED || m_usages[heapType].committedBytes + size <= budget;
+}
+
+void SHRMemoryBudget::UpdateThresholds(uint32_t heapType)
+{
+	uint64_t committedBytes = m_usages[heapType].committedBytes;
+	for (ResidencyThreshold& threshold : m_thresholds)
+	{
+		if (threshold.heapType != heapType) continue;
+
+		bool exceeded = committedBytes >= threshold.bytes;
+		if (exceeded == threshold.exceeded) continue;
+
+		threshold.exceeded = exceeded;
+		if (m_residencyCallback) m_residencyCallback(heapType, threshold.bytes, committedBytes, exceeded);
+	}
+}
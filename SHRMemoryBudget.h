@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+#define SHR_MEMORY_BUDGET_HEAP_TYPE_COUNT 5		//indexed by D3D12_HEAP_TYPE, DEFAULT..CUSTOM
+#define SHR_MEMORY_BUDGET_UNLIMITED 0
+
+//what to do when a new heap would go over budget
+enum class SHRMemoryBudgetPolicy : uint8_t
+{
+	Refuse,		//the heap is not created, the allocation fails
+	Trim		//owners release their idle heaps first, the heap is refused if that is not enough
+};
+
+//committed heap bytes per heap type, heap providers report every heap they create or release.
+//no device involved, the accounting runs the same with SHRNullHeapProvider
+class SHRMemoryBudget
+{
+public:
+	struct Usage
+	{
+		uint64_t committedBytes;
+		uint64_t peakCommittedBytes;
+		uint64_t heapCount;
+		uint64_t refusedCount;
+	};
+
+	struct ResidencyThreshold
+	{
+		uint32_t heapType;
+		uint64_t bytes;
+		bool exceeded;
+	};
+
+	//releases idle heaps of heapType right away
+	typedef std::function<void(uint32_t heapType)> TrimCallback;
+	//fires once each time committed bytes of heapType cross thresholdBytes, in either direction
+	typedef std::function<void(uint32_t heapType, uint64_t thresholdBytes, uint64_t committedBytes, bool exceeded)> ResidencyCallback;
+
+public:
+	SHRMemoryBudget(SHRMemoryBudgetPolicy policy = SHRMemoryBudgetPolicy::Trim);
+	~SHRMemoryBudget() = default;
+
+	void SetBudget(uint32_t heapType, uint64_t budgetBytes) { m_budgets[heapType] = budgetBytes; }
+	void AddTrimCallback(TrimCallback callback) { m_trimCallbacks.push_back(callback); }
+	void SetResidencyCallback(ResidencyCallback callback) { m_residencyCallback = callback; }
+	void AddResidencyThreshold(uint32_t heapType, uint64_t bytes);
+
+	//asked before a heap is created, does not commit anything
+	bool RequestCommit(uint32_t heapType, uint64_t size);
+
+	void OnCommit(uint32_t heapType, uint64_t size);
+	void OnRelease(uint32_t heapType, uint64_t size);
+
+	const Usage& GetUsage(uint32_t heapType) const { return m_usages[heapType]; }
+
+private:
+	bool FitsBudget(uint32_t heapType, uint64_t size) const;
+	void UpdateThresholds(uint32_t heapType);
+
+public:
+	SHRMemoryBudgetPolicy m_policy;
+	uint64_t m_budgets[SHR_MEMORY_BUDGET_HEAP_TYPE_COUNT] = {};
+	Usage m_usages[SHR_MEMORY_BUDGET_HEAP_TYPE_COUNT] = {};
+
+	std::vector<ResidencyThreshold> m_thresholds;
+
+private:
+	std::vector<TrimCallback> m_trimCallbacks;
+	ResidencyCallback m_residencyCallback;
+	bool m_isTrimming = false;
+};
@@ -2,6 +2,24 @@
 #include "Win32Application.h"
 #include "SHRRenderEngine.h"
 
+#include <fstream>
+
+template<typename T>
+static void WriteAllocatorSystemJson(std::string& json, const char* name, T& system)
+{
+	json += "{\"name\":\"";
+	json += name;
+	json += "\",\"total\":";
+	SHRAllocatorTelemetry::WriteJson(json, name, system.GetStats());
+	json += ",\"allocators\":[";
+	for (size_t i = 0; i < system.m_allocators.size(); i++)
+	{
+		if (i) json += ",";
+		SHRAllocatorTelemetry::WriteJson(json, std::to_string(i).c_str(), system.m_allocators[i]->GetStats());
+	}
+	json += "]}";
+}
+
 void GetHardwareAdaptor(IDXGIFactory1* pFactory, IDXGIAdapter1** ppAdapter)
 {
 	using Microsoft::WRL::ComPtr;
@@ -130,8 +148,13 @@ SHRRenderContext::SHRRenderContext(SHRRenderEngine* pEngine)
 
 	ID3D12Device* pD3dDevice = m_pDevice->m_pD3dDevice.Get();
 
-	ThrowIfFailed(pD3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_pCommandAllocator)));
-	ThrowIfFailed(pD3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_pCommandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_pCommandList)));
+	m_frameContextIndex = 0;
+	for (UINT i = 0; i < SHR_FRAME_IN_FLIGHT_COUNT; i++)
+	{
+		ThrowIfFailed(pD3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_frameContexts[i].m_pCommandAllocator)));
+		m_frameContexts[i].m_fenceValue = 0;
+	}
+	ThrowIfFailed(pD3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, GetCmdAllocator(), nullptr, IID_PPV_ARGS(&m_pCommandList)));
 	ThrowIfFailed(m_pCommandList->Close());
 
 	m_pRTVHeapSlotManager = std::make_unique<SHRHeapSlotAllocator>(pD3dDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
@@ -139,16 +162,83 @@ SHRRenderContext::SHRRenderContext(SHRRenderEngine* pEngine)
 	m_pCBVSRVUAVHeapSlotManager = std::make_unique<SHRHeapSlotAllocator>(pD3dDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
 	m_pSamplerHeapSlotManager = std::make_unique<SHRHeapSlotAllocator>(pD3dDevice, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
 
-	m_pGPUDescriptorCache = std::make_unique<SHRDescriptorCache>(pD3dDevice);
+	m_pGPUDescriptorCache = std::make_unique<SHRDescriptorCache>(pD3dDevice, GetFence());
 
 	m_pTextureAllocateSystem = std::make_unique<SHRSegregatedListSystem>(pD3dDevice);
 	m_pBufferAllocateSystem = std::make_unique<SHRBuddySystem>(pD3dDevice);
+	m_pBufferSubAllocateSystem = std::make_unique<SHRFreeListSystem>(pD3dDevice);
+	m_pBufferAllocateSystem->SetSubAllocateSystem(m_pBufferSubAllocateSystem.get());
+	m_pBufferDefragmenter = std::make_unique<SHRBufferDefragmenter>(m_pBufferAllocateSystem.get());
+
+	m_pMemoryBudget = std::make_unique<SHRMemoryBudget>();
+	m_pTextureAllocateSystem->SetMemoryBudget(m_pMemoryBudget.get());
+	m_pBufferAllocateSystem->SetMemoryBudget(m_pMemoryBudget.get());
+	m_pBufferSubAllocateSystem->SetMemoryBudget(m_pMemoryBudget.get());
+
+	m_pAllocationTrace = std::make_unique<SHRAllocationTraceRecorder>();
+	m_pTextureAllocateSystem->SetTraceRecorder(m_pAllocationTrace.get());
+	m_pBufferAllocateSystem->SetTraceRecorder(m_pAllocationTrace.get());
+	m_pBufferSubAllocateSystem->SetTraceRecorder(m_pAllocationTrace.get());
+
+	m_pTextureAllocateSystem->SetFrameFenceValue(GetGPUFenceValue());
+	m_pBufferAllocateSystem->SetFrameFenceValue(GetGPUFenceValue());
+	m_pBufferSubAllocateSystem->SetFrameFenceValue(GetGPUFenceValue());
+
+	m_pUploadRingBuffer = std::make_unique<SHRUploadRingBuffer>(m_pBufferAllocateSystem.get());
+}
+
+void SHRRenderContext::EndFrameContext(uint64_t signaledFenceValue)
+{
+	m_frameContexts[m_frameContextIndex].m_fenceValue = signaledFenceValue;
+	m_pUploadRingBuffer->FinishFrame(signaledFenceValue);
+	m_pGPUDescriptorCache->FinishFrame(signaledFenceValue);
+	m_frameContextIndex = (m_frameContextIndex + 1) % SHR_FRAME_IN_FLIGHT_COUNT;
 }
 
 void SHRRenderContext::CleanupContext()
 {
-	m_pBufferAllocateSystem->CleanupSystem();
-	m_pTextureAllocateSystem->CleanupSystem();
+	//only blocks whose retiring frame has finished on the GPU are released
+	UINT64 completedFenceValue = GetFence()->GetCompletedValue();
+	m_pBufferAllocateSystem->CleanupSystem(completedFenceValue);
+	m_pBufferSubAllocateSystem->CleanupSystem(completedFenceValue);
+	m_pTextureAllocateSystem->CleanupSystem(completedFenceValue);
+	m_pUploadRingBuffer->Retire(completedFenceValue);
+	m_pGPUDescriptorCache->Retire(completedFenceValue);
+
+	//resources released from now on are retired by the next fence signal
+	m_pBufferAllocateSystem->SetFrameFenceValue(GetGPUFenceValue());
+	m_pBufferSubAllocateSystem->SetFrameFenceValue(GetGPUFenceValue());
+	m_pTextureAllocateSystem->SetFrameFenceValue(GetGPUFenceValue());
+	m_pAllocationTrace->NextFrame();
+
+	if (!m_allocatorStatsDumpPath.empty())
+	{
+		std::ofstream file(m_allocatorStatsDumpPath, std::ios::trunc);
+		file << DumpAllocatorStats();
+	}
+}
 
-	m_pGPUDescriptorCache->ClearCache();
+std::string SHRRenderContext::DumpAllocatorStats()
+{
+	std::string json = "{\"systems\":[";
+	WriteAllocatorSystemJson(json, "texture", *m_pTextureAllocateSystem);
+	json += ",";
+	WriteAllocatorSystemJson(json, "buffer", *m_pBufferAllocateSystem);
+	json += ",";
+	WriteAllocatorSystemJson(json, "subBuffer", *m_pBufferSubAllocateSystem);
+
+	json += "],\"budget\":[";
+	for (uint32_t heapType = 1; heapType < SHR_MEMORY_BUDGET_HEAP_TYPE_COUNT; heapType++)
+	{
+		const SHRMemoryBudget::Usage& usage = m_pMemoryBudget->GetUsage(heapType);
+		if (heapType > 1) json += ",";
+		json += "{\"heapType\":" + std::to_string(heapType);
+		json += ",\"committedBytes\":" + std::to_string(usage.committedBytes);
+		json += ",\"peakCommittedBytes\":" + std::to_string(usage.peakCommittedBytes);
+		json += ",\"heapCount\":" + std::to_string(usage.heapCount);
+		json += ",\"refusedCount\":" + std::to_string(usage.refusedCount);
+		json += "}";
+	}
+	json += "]}";
+	return json;
 }
\ No newline at end of file
@@ -7,6 +7,10 @@
 #include "SHRHeapSlotAllocator.h"
 #include "SHRDescriptorCache.h"
 #include "SHRResourceAllocator.h"
+#include "SHRUploadRingBuffer.h"
+#include "SHRBufferDefragmenter.h"
+
+#define SHR_FRAME_IN_FLIGHT_COUNT 2
 
 class SHRRenderEngine;
 
@@ -21,6 +25,13 @@ struct SHRDevice
 	void InitializeDevice(SHRRenderEngine* pEngine);
 };
 
+//everything a frame records into, recycled once the GPU passes m_fenceValue
+struct SHRFrameContext
+{
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_pCommandAllocator;
+	uint64_t m_fenceValue;
+};
+
 class SHRRenderContext
 {
 public:
@@ -30,7 +41,9 @@ public:
 	ID3D12Device* GetDevice() { return m_pDevice->m_pD3dDevice.Get(); }
 	SHRHeapSlotAllocator* GetHeapSlotManager(D3D12_DESCRIPTOR_HEAP_TYPE type);
 	ID3D12GraphicsCommandList* GetCmdList() { return m_pCommandList.Get(); }
-	ID3D12CommandAllocator* GetCmdAllocator() { return m_pCommandAllocator.Get(); }
+	ID3D12CommandAllocator* GetCmdAllocator() { return m_frameContexts[m_frameContextIndex].m_pCommandAllocator.Get(); }
+	SHRFrameContext& GetCurrentFrameContext() { return m_frameContexts[m_frameContextIndex]; }
+	UINT GetCurrentFrameContextIndex() { return m_frameContextIndex; }
 	SHRDescriptorCache* GetDescriptorCache() { return m_pGPUDescriptorCache.get(); }
 	ID3D12CommandQueue* GetCmdQueue() { return m_pDevice->m_pCommandQueue.Get(); }
 	ID3D12Fence* GetFence() { return m_pDevice->m_pFence.Get(); }
@@ -38,21 +51,43 @@ public:
 
 	SHRSegregatedListSystem* GetTextureAllocator() { return m_pTextureAllocateSystem.get(); }
 	SHRBuddySystem* GetBufferAllocator() { return m_pBufferAllocateSystem.get(); }
+	SHRFreeListSystem* GetBufferSubAllocator() { return m_pBufferSubAllocateSystem.get(); }
+	SHRBufferDefragmenter* GetBufferDefragmenter() { return m_pBufferDefragmenter.get(); }
+	SHRMemoryBudget* GetMemoryBudget() { return m_pMemoryBudget.get(); }
+	//Begin/End it to capture the allocator workload for Tools/SHRAllocationReplay
+	SHRAllocationTraceRecorder* GetAllocationTrace() { return m_pAllocationTrace.get(); }
 
 	UINT GetCurrentBackBufferIndex() { return m_pDevice->m_pSwapChain->GetCurrentBackBufferIndex(); }
 	uint64_t& GetGPUFenceValue() { return m_pDevice->m_fenceValue; }
 	void Present() { ThrowIfFailed(m_pDevice->m_pSwapChain->Present(1, 0)); }
 
+	//transient upload memory that stays valid until the current frame retires
+	SHRUploadAllocation AllocateUpload(UINT64 size, UINT64 alignment = 16) { return m_pUploadRingBuffer->Allocate(size, alignment); }
+	SHRUploadRingBuffer* GetUploadRingBuffer() { return m_pUploadRingBuffer.get(); }
+
+	//tags the current frame with the fence value it was signaled with and moves to the next slot,
+	//the caller must wait for the new slot's m_fenceValue before calling CleanupContext
+	void EndFrameContext(uint64_t signaledFenceValue);
 	void CleanupContext();
 
+	//json snapshot of every allocator system and the memory budget
+	std::string DumpAllocatorStats();
+	//while not empty, CleanupContext overwrites this file with DumpAllocatorStats once per frame
+	void SetAllocatorStatsDumpPath(const std::string& path) { m_allocatorStatsDumpPath = path; }
+
 private:
 	std::unique_ptr<SHRDevice> m_pDevice;
 
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_pCommandAllocator;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_pCommandList;
 
+	//declared before the allocator systems, their heaps report to it until they are destroyed
+	std::unique_ptr<SHRMemoryBudget> m_pMemoryBudget;
+	std::unique_ptr<SHRAllocationTraceRecorder> m_pAllocationTrace;
+
 	std::unique_ptr<SHRSegregatedListSystem> m_pTextureAllocateSystem;
 	std::unique_ptr<SHRBuddySystem> m_pBufferAllocateSystem;
+	std::unique_ptr<SHRFreeListSystem> m_pBufferSubAllocateSystem;
+	std::unique_ptr<SHRBufferDefragmenter> m_pBufferDefragmenter;
 
 	std::unique_ptr<SHRHeapSlotAllocator> m_pRTVHeapSlotManager;
 	std::unique_ptr<SHRHeapSlotAllocator> m_pDSVHeapSlotManager;
@@ -60,5 +95,13 @@ private:
 	std::unique_ptr<SHRHeapSlotAllocator> m_pSamplerHeapSlotManager;
 
 	std::unique_ptr<SHRDescriptorCache> m_pGPUDescriptorCache;
+
+	//declared after the allocator systems so the upload ring is released first
+	std::unique_ptr<SHRUploadRingBuffer> m_pUploadRingBuffer;
+
+	SHRFrameContext m_frameContexts[SHR_FRAME_IN_FLIGHT_COUNT];
+	UINT m_frameContextIndex;
+
+	std::string m_allocatorStatsDumpPath;
 };
 
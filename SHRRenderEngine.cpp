@@ -39,29 +39,22 @@ void SHRRenderEngine::OnUpdate()
 	float positionStreamData[] = { 0.0f, 0.25f * m_aspectRatio, 0.0f, 0.25f, -0.25f * m_aspectRatio, 0.0f , -0.25f, -0.25f * m_aspectRatio, 0.0f };
 	float colorStreamData[] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f };
 
-	SHRBuddySystem* pBufferAllocator = m_renderContext->GetBufferAllocator();
+	//transient vertex data lives in the upload ring until this frame retires
+	SHRUploadAllocation positionStream = m_renderContext->AllocateUpload(sizeof(positionStreamData));
+	SHRUploadAllocation colorStream = m_renderContext->AllocateUpload(sizeof(colorStreamData));
 
-	SHRResource positionStream;
-	SHRResource colorStream;
-
-	pBufferAllocator->AllocateSHRResouce(D3D12_HEAP_TYPE_UPLOAD, CD3DX12_RESOURCE_DESC::Buffer(sizeof(positionStreamData)), D3D12_RESOURCE_STATE_GENERIC_READ, sizeof(positionStreamData), positionStream, nullptr);
-	pBufferAllocator->AllocateSHRResouce(D3D12_HEAP_TYPE_UPLOAD, CD3DX12_RESOURCE_DESC::Buffer(sizeof(colorStreamData)), D3D12_RESOURCE_STATE_GENERIC_READ, sizeof(colorStreamData), colorStream, nullptr);
-
-	UINT8* pPositionMapData = reinterpret_cast<UINT8*>(positionStream.Map(0));
-	UINT8* pColorMapData = reinterpret_cast<UINT8*>(colorStream.Map(0));
-
-	memcpy(pPositionMapData, positionStreamData, sizeof(positionStreamData));
-	memcpy(pColorMapData, colorStreamData, sizeof(colorStreamData));
+	memcpy(positionStream.pCPUAddress, positionStreamData, sizeof(positionStreamData));
+	memcpy(colorStream.pCPUAddress, colorStreamData, sizeof(colorStreamData));
 
 	if (vbvs.empty())
 	{
-		vbvs.emplace_back(*m_renderContext.get(), (UINT)3 * sizeof(float), (UINT)sizeof(positionStreamData), &positionStream);
-		vbvs.emplace_back(*m_renderContext.get(), (UINT)4 * sizeof(float), (UINT)sizeof(colorStreamData), &colorStream);
+		vbvs.emplace_back(*m_renderContext.get(), (UINT)3 * sizeof(float), (UINT)sizeof(positionStreamData), positionStream.gpuAddress);
+		vbvs.emplace_back(*m_renderContext.get(), (UINT)4 * sizeof(float), (UINT)sizeof(colorStreamData), colorStream.gpuAddress);
 	}
 	else
 	{
-		vbvs[0] = SHRVertexBufferView(*m_renderContext.get(), (UINT)3 * sizeof(float), (UINT)sizeof(positionStreamData), &positionStream);
-		vbvs[1] = SHRVertexBufferView(*m_renderContext.get(), (UINT)4 * sizeof(float), (UINT)sizeof(colorStreamData), &colorStream);
+		vbvs[0] = SHRVertexBufferView(*m_renderContext.get(), (UINT)3 * sizeof(float), (UINT)sizeof(positionStreamData), positionStream.gpuAddress);
+		vbvs[1] = SHRVertexBufferView(*m_renderContext.get(), (UINT)4 * sizeof(float), (UINT)sizeof(colorStreamData), colorStream.gpuAddress);
 	}
 }
 
@@ -75,6 +68,7 @@ void SHRRenderEngine::OnRender()
 void SHRRenderEngine::OnDestory()
 {
 	WaitForGPUSynchronize();
+	m_renderContext->CleanupContext();
 	CloseHandle(m_fenceEvent);
 }
 
@@ -91,22 +85,51 @@ void SHRRenderEngine::CompileShaders()
 	compileFlags.push_back(DXC_ARG_SKIP_OPTIMIZATIONS);
 #endif
 
-	SHRShader vs(L"shaders", L"VSMain", L"vs_6_0", compileFlags);
-	SHRShader ps(L"shaders", L"PSMain", L"ps_6_0", compileFlags);
+	m_shaderPrograms["VS"] = std::make_unique<SHRShaderProgram>(L"shaders", L"VSMain", L"vs_6_0", std::vector<std::string>{}, compileFlags);
+	m_shaderPrograms["PS"] = std::make_unique<SHRShaderProgram>(L"shaders", L"PSMain", L"ps_6_0", std::vector<std::string>{}, compileFlags);
+
+	//variants off the precompile lists are compiled on first request
+	std::vector<SHRShaderPermutationDesc> permutations;
+	for (auto& program : m_shaderPrograms)
+	{
+		program.second->AddPrecompileVariant(0);
+		program.second->GetPrecompilePermutations(permutations);
+	}
 
-	m_shaderMap["VS"] = std::make_unique<SHRShader>(vs);
-	m_shaderMap["PS"] = std::make_unique<SHRShader>(ps);
+	if (!m_shaderCompileQueue) m_shaderCompileQueue = std::make_unique<SHRShaderCompileQueue>();
+#if SHR_SHADER_HOT_RELOAD
+	//created before the batch so it tracks the includes of every permutation published from now on
+	if (!m_shaderHotReload) m_shaderHotReload = std::make_unique<SHRShaderHotReload>(*m_renderContext, *m_shaderCompileQueue);
+#endif
+
+	//permutations compile on the workers, startup only waits for the slowest one
+	std::shared_ptr<SHRShaderBatch> pBatch = m_shaderCompileQueue->Submit(permutations, g_shaderRegistry);
+	if (!pBatch->Wait())
+	{
+		throw COMException(pBatch->GetFailures().front().error);
+	}
+
+	m_shaderMap["VS"] = m_shaderPrograms["VS"]->GetVariant(0);
+	m_shaderMap["PS"] = m_shaderPrograms["PS"]->GetVariant(0);
 }
 
 void SHRRenderEngine::BeginFrame()
 {
-
+#if SHR_SHADER_HOT_RELOAD
+	//reloaded shaders & pass objects are swapped in before this frame looks any of them up
+	m_shaderHotReload->Update();
+	m_shaderMap["VS"] = m_shaderPrograms["VS"]->GetVariant(0);
+	m_shaderMap["PS"] = m_shaderPrograms["PS"]->GetVariant(0);
+#endif
 }
 
 void SHRRenderEngine::EndFrame()
 {
 	ExecuteCommandQueue();
-	WaitForGPUSynchronize();
+
+	//move to the next frame slot, this only blocks when the GPU is still working on the frame that last used it
+	m_renderContext->EndFrameContext(SignalGPUFence());
+	WaitForFenceValue(m_renderContext->GetCurrentFrameContext().m_fenceValue);
 
 	m_renderContext->CleanupContext();
 	m_frameIndexBackBuffer = m_renderContext->GetCurrentBackBufferIndex();
@@ -139,10 +162,15 @@ void SHRRenderEngine::PopulateCommandList()
 	ID3D12CommandAllocator* cmdAllocator = m_renderContext->GetCmdAllocator();
 
 	ThrowIfFailed(cmdAllocator->Reset());
-	ThrowIfFailed(cmdList->Reset(cmdAllocator, passObject->m_pPipelineState));
+	ThrowIfFailed(cmdList->Reset(cmdAllocator, passObject->m_pPipelineState.Get()));
+
+	//relocations run before any draw so views rebuilt by the callback are used this frame
+	m_renderContext->GetBufferDefragmenter()->Execute(cmdList);
 
 	// Set necessary state.
 	cmdList->SetGraphicsRootSignature(passObject->m_pRootSignature.Get());
+	//Reset cleared the heaps of the list
+	m_renderContext->GetDescriptorCache()->SetDescriptorHeaps(cmdList);
 	cmdList->RSSetViewports(1, &m_viewport);
 	cmdList->RSSetScissorRects(1, &m_scissorRect);
 
@@ -179,6 +207,9 @@ void SHRRenderEngine::ExecuteCommandQueue()
 	ID3D12CommandQueue* cmdQueue = m_renderContext->GetCmdQueue();
 	ID3D12GraphicsCommandList* cmdList = m_renderContext->GetCmdList();
 
+	//descriptor tables must be in the shader visible heap before the GPU reads them
+	m_renderContext->GetDescriptorCache()->FlushCopies();
+
 	ID3D12CommandList* ppCommandLists[] = { cmdList };
 	cmdQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
@@ -186,16 +217,28 @@ void SHRRenderEngine::ExecuteCommandQueue()
 }
 
 void SHRRenderEngine::WaitForGPUSynchronize()
+{
+	WaitForFenceValue(SignalGPUFence());
+}
+
+uint64_t SHRRenderEngine::SignalGPUFence()
 {
 	uint64_t& gpuFenceValue = m_renderContext->GetGPUFenceValue();
 
 	ID3D12CommandQueue* cmdQueue = m_renderContext->GetCmdQueue();
 	ID3D12Fence* fence = m_renderContext->GetFence();
 
-	const uint64_t waitValue = gpuFenceValue;
-	ThrowIfFailed(cmdQueue->Signal(fence, waitValue));
+	const uint64_t signalValue = gpuFenceValue;
+	ThrowIfFailed(cmdQueue->Signal(fence, signalValue));
 	gpuFenceValue++;
 
+	return signalValue;
+}
+
+void SHRRenderEngine::WaitForFenceValue(uint64_t waitValue)
+{
+	ID3D12Fence* fence = m_renderContext->GetFence();
+
 	if (fence->GetCompletedValue() < waitValue)
 	{
 		ThrowIfFailed(fence->SetEventOnCompletion(waitValue, m_fenceEvent));
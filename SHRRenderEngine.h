@@ -11,6 +11,9 @@
 #include "SHRRenderContext.h"
 #include "SHRResourceView.h"
 #include "SHRShaderPassObject.h"
+#include "SHRShaderCompileQueue.h"
+#include "SHRShaderProgram.h"
+#include "SHRShaderHotReload.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -46,6 +49,8 @@ private:
 	void PopulateCommandList();
 	void ExecuteCommandQueue();
 	void WaitForGPUSynchronize();
+	uint64_t SignalGPUFence();
+	void WaitForFenceValue(uint64_t waitValue);
 
 private:
 	static const uint32_t FrameCount = 2;
@@ -74,7 +79,10 @@ private:
 	std::vector<SHRResource> m_depthStencils;
 	std::vector<SHRRenderTargetView> rtvs;
 
-	std::unordered_map<std::string, std::unique_ptr<SHRShader>> m_shaderMap;
+	std::unique_ptr<SHRShaderCompileQueue> m_shaderCompileQueue;
+	std::unique_ptr<SHRShaderHotReload> m_shaderHotReload;
+	std::unordered_map<std::string, std::unique_ptr<SHRShaderProgram>> m_shaderPrograms;
+	std::unordered_map<std::string, std::shared_ptr<SHRShader>> m_shaderMap;
 
 	std::vector<SHRVertexBufferView> vbvs;
 
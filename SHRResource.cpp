@@ -2,17 +2,45 @@
 #include "SHRResourceAllocator.h"
 
 SHRResource::SHRResource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES initialState)
-	: m_block{ 0, 0, nullptr, nullptr }
+	: m_block{ 0, 0, nullptr, nullptr, 0 }
 	, m_pSHRD3dResource(nullptr)
 {
 	m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(pResource, initialState);
 }
 
+SHRResource::SHRResource(SHRResource&& other)
+	: m_pSHRD3dResource(std::move(other.m_pSHRD3dResource))
+	, m_block(other.m_block)
+{
+	//the allocator keeps a back-pointer to the owning SHRResource, the moved from object must not release the block
+	other.m_block = { 0, 0, nullptr, nullptr, 0 };
+	if (m_block.pAllocator) m_block.pAllocator->RebindResource(m_block, this);
+}
+
+SHRResource& SHRResource::operator=(SHRResource&& other)
+{
+	if (this != &other)
+	{
+		Release();
+		m_pSHRD3dResource = std::move(other.m_pSHRD3dResource);
+		m_block = other.m_block;
+		other.m_block = { 0, 0, nullptr, nullptr, 0 };
+		if (m_block.pAllocator) m_block.pAllocator->RebindResource(m_block, this);
+	}
+	return *this;
+}
+
 SHRResource::~SHRResource()
+{
+	Release();
+}
+
+void SHRResource::Release()
 {
 	if (m_block.pAllocator)
 	{
 		m_block.pResource = m_pSHRD3dResource.release();
 		m_block.pAllocator->DeallocateSHRResource(m_block);
+		m_block = { 0, 0, nullptr, nullptr, 0 };
 	}
 }
\ No newline at end of file
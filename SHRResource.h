@@ -13,19 +13,23 @@ public:
 		UINT64 offset;
 		SHRResourceAllocator* pAllocator;
 		SHRD3D12Resource* pResource;
+		UINT64 traceId;		//SHRAllocationTraceRecorder id, 0 when the allocation was not traced
 	};
 public:
 	SHRResource() = default;
 	SHRResource(ID3D12Resource* pResource, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON);
 	~SHRResource();
 	SHRResource(const SHRResource&) = delete;
-	SHRResource(SHRResource&& other) = default;
+	SHRResource(SHRResource&& other);
 	SHRResource& operator=(const SHRResource&) = delete;
-	SHRResource& operator=(SHRResource&& other) = default;
+	SHRResource& operator=(SHRResource&& other);
 
 	void* Map(UINT subresource, D3D12_RANGE* pReadRange = nullptr) { m_pSHRD3dResource->Map(subresource, pReadRange); return m_pSHRD3dResource->m_mappedBaseAddress; };
 
+private:
+	void Release();
+
 public:
 	std::unique_ptr<SHRD3D12Resource> m_pSHRD3dResource;
-	ResourceBlock m_block;
+	ResourceBlock m_block = { 0, 0, nullptr, nullptr, 0 };
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "SHRResourceAllocator.h"
 
+#include <algorithm>
+
 ///////
 // Texture -> SFL -> default heap -> heap_flag_deny_buffers & YES rtv/dsv
 // Buffer -> Buddy -> default/upload heap -> heap_flag_allow_only_buffers & NO rtv/dsv
@@ -26,6 +28,7 @@ static D3D12_HEAP_FLAGS GetAllocatorFlags(SHRAllocatorType type, const D3D12_RES
 	}
 	break;
 	case SHRAllocatorType::Buddy:
+	case SHRAllocatorType::FreeList:
 	{
 		flag |= D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;				//normal
 	}
@@ -42,6 +45,84 @@ static BOOL ValidateAllocation(const SHRAllocatorDesc& allocDesc, const D3D12_RE
 	return isValid;
 }
 
+//nothing live or in flight references the heap of a drained allocator
+static bool IsAllocatorDrained(const SHRResourceAllocator& allocator)
+{
+	return allocator.m_liveCount == 0 && allocator.m_defferedDeletionList.Empty();
+}
+
+//drops allocators emptied by the defragmenter and the ones drained for idleFrameLimit frames in a row, call once per frame
+template<typename T>
+static void ReleaseIdleAllocators(std::vector<std::unique_ptr<T>>& allocators, uint32_t idleFrameLimit)
+{
+	for (auto& pAllocator : allocators)
+	{
+		pAllocator->m_idleFrameCount = IsAllocatorDrained(*pAllocator) ? pAllocator->m_idleFrameCount + 1 : 0;
+	}
+
+	allocators.erase(std::remove_if(allocators.begin(), allocators.end(), [idleFrameLimit](const std::unique_ptr<T>& pAllocator)
+		{
+			return IsAllocatorDrained(*pAllocator) && (pAllocator->m_isEvacuating || pAllocator->m_idleFrameCount >= idleFrameLimit);
+		}), allocators.end());
+}
+
+//drops every drained allocator of heapType right away, used when a new heap would go over budget
+template<typename T>
+static void TrimAllocators(std::vector<std::unique_ptr<T>>& allocators, uint32_t heapType)
+{
+	allocators.erase(std::remove_if(allocators.begin(), allocators.end(), [heapType](const std::unique_ptr<T>& pAllocator)
+		{
+			return pAllocator->GetDesc().properties.Type == heapType && IsAllocatorDrained(*pAllocator);
+		}), allocators.end());
+}
+
+//one event per request that reached a system, a served request keeps its id in the resource block until the block retires
+//type is the allocator that took the request, heap flags are the ones of the system it came through
+static void TraceAllocation(SHRAllocationTraceRecorder* pTrace, SHRAllocatorType type, D3D12_HEAP_FLAGS heapFlags, D3D12_HEAP_TYPE requiredType,
+	const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES& initState, UINT size, bool served, SHRResource& resource)
+{
+	if (!pTrace || !pTrace->IsRecording()) return;
+
+	UINT64 traceId = pTrace->RecordAllocate(static_cast<SHRAllocationTraceSystem>(type), requiredType, desc.Dimension, size, desc.Alignment,
+		heapFlags, desc.Flags, initState, served);
+	if (served) resource.m_block.traceId = traceId;
+}
+
+static UINT64 GetRefusedCount(SHRMemoryBudget* pBudget, D3D12_HEAP_TYPE heapType)
+{
+	return pBudget ? pBudget->GetUsage(heapType).refusedCount : 0;
+}
+
+//a failed request was over budget when the budget refused a heap while serving it
+static SHRAllocationResult GetFailureResult(SHRMemoryBudget* pBudget, D3D12_HEAP_TYPE heapType, UINT64 refusedCount)
+{
+	return GetRefusedCount(pBudget, heapType) != refusedCount ? SHRAllocationResult::OutOfBudget : SHRAllocationResult::OutOfMemory;
+}
+
+//one dedicated allocator per heap type, heap flags & mode, created on first use
+static SHRDedicatedAllocator& GetDedicatedAllocator(std::vector<std::unique_ptr<SHRDedicatedAllocator>>& allocators, ID3D12Device* pDevice,
+	const SHRAllocatorDesc& allocDesc, UINT64 frameFenceValue)
+{
+	for (auto& pAllocator : allocators)
+	{
+		const SHRAllocatorDesc& other = pAllocator->m_allocatorDesc;
+		if (other.properties.Type == allocDesc.properties.Type && other.flags == allocDesc.flags && other.dedicatedParams.committed == allocDesc.dedicatedParams.committed) return *pAllocator;
+	}
+
+	allocators.push_back(std::make_unique<SHRDedicatedAllocator>(pDevice, allocDesc));
+	allocators.back()->SetFrameFenceValue(frameFenceValue);
+	return *allocators.back();
+}
+
+template<typename T>
+static void SetAllocatorsTraceRecorder(std::vector<std::unique_ptr<T>>& allocators, SHRAllocationTraceRecorder* pTrace)
+{
+	for (auto& pAllocator : allocators)
+	{
+		pAllocator->m_allocatorDesc.pTrace = pTrace;
+	}
+}
+
 SHRResourceAllocator::SHRResourceAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData)
 {
 	Initialize(pDevice, initData);
@@ -61,43 +142,99 @@ SHRAllocatorDesc SHRResourceAllocator::GetDesc()
 	return m_allocatorDesc;
 }
 
-SHRBuddyAllocator::SHRBuddyAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData) : SHRResourceAllocator(pDevice, initData)
+SHRD3D12HeapProvider::SHRD3D12HeapProvider(ID3D12Device* pDevice, D3D12_HEAP_FLAGS flags, const D3D12_HEAP_PROPERTIES& properties)
+	: m_pDevice(pDevice)
+	, m_flags(flags)
+	, m_properties(properties)
 {
-	Initialize(pDevice, initData);
 }
 
-void SHRBuddyAllocator::Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData)
+uint32_t SHRD3D12HeapProvider::CreateHeap(uint64_t size, uint64_t alignment)
 {
-	m_allocatorDesc.buddyParams.heapMaxSize = m_allocatorDesc.buddyParams.heapMaxSize > m_allocatorDesc.heapBlockSize ? m_allocatorDesc.buddyParams.heapMaxSize : m_allocatorDesc.heapBlockSize * SHR_BUDDY_HEAP_DEFAULT_BLOCK_COUNT;
-
-	UINT64 blockNum = m_allocatorDesc.buddyParams.heapMaxSize / m_allocatorDesc.heapBlockSize;
-	m_blockStates.resize(2 * blockNum - 1);
+	uint32_t heapIndex = 0;
+	ThrowIfFailed(TryCreateHeap(size, alignment, heapIndex));
+	return heapIndex;
+}
 
+HRESULT SHRD3D12HeapProvider::TryCreateHeap(uint64_t size, uint64_t alignment, uint32_t& heapIndex)
+{
 	D3D12_HEAP_DESC heapDesc = {};
-	heapDesc.Alignment = m_allocatorDesc.alignment;
-	heapDesc.Properties;
-	heapDesc.Flags = m_allocatorDesc.flags;
-	heapDesc.Properties = initData.properties;
-	heapDesc.SizeInBytes = m_allocatorDesc.buddyParams.heapMaxSize;
+	heapDesc.Alignment = alignment;
+	heapDesc.Flags = m_flags;
+	heapDesc.Properties = m_properties;
+	heapDesc.SizeInBytes = size;
 
-	ID3D12Heap* pHeap;
-	ThrowIfFailed(m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap)));
+	Microsoft::WRL::ComPtr<ID3D12Heap> pHeap;
+	HRESULT hr = m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap));
+	if (FAILED(hr)) return hr;
 
-	m_pHeap = pHeap;
+	heapIndex = static_cast<uint32_t>(m_pHeaps.size());
+	if (!m_unusedHeapIndices.empty())
+	{
+		heapIndex = m_unusedHeapIndices.back();
+		m_unusedHeapIndices.pop_back();
+		m_pHeaps[heapIndex] = pHeap;
+		m_heapSizes[heapIndex] = size;
+	}
+	else
+	{
+		m_pHeaps.push_back(pHeap);
+		m_heapSizes.push_back(size);
+	}
+
+	m_committedBytes += size;
+	m_heapCount++;
+	if (m_pBudget) m_pBudget->OnCommit(m_budgetHeapType, size);
+	return S_OK;
+}
 
-	for (auto it = m_blockStates.begin(); it != m_blockStates.end(); it++)
+SHRD3D12HeapProvider::~SHRD3D12HeapProvider()
+{
+	for (uint32_t i = 0; i < m_pHeaps.size(); i++)
 	{
-		it->valid = 1;
-		it->pResource = nullptr;
+		ReleaseHeap(i);
 	}
 }
 
+void SHRD3D12HeapProvider::ReleaseHeap(uint32_t heapIndex)
+{
+	if (!m_pHeaps[heapIndex]) return;
+
+	m_pHeaps[heapIndex] = nullptr;
+	m_unusedHeapIndices.push_back(heapIndex);
+	m_committedBytes -= m_heapSizes[heapIndex];
+	m_heapCount--;
+	if (m_pBudget) m_pBudget->OnRelease(m_budgetHeapType, m_heapSizes[heapIndex]);
+}
+
+SHRBuddyAllocator::SHRBuddyAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData) : SHRResourceAllocator(pDevice, initData)
+{
+	Initialize(pDevice, initData);
+}
+
+SHRBuddyAllocator::~SHRBuddyAllocator()
+{
+	//owners only destroy allocators once the GPU is idle
+	m_defferedDeletionList.RetireAll([this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
+}
+
+void SHRBuddyAllocator::Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData)
+{
+	m_allocatorDesc.buddyParams.heapMaxSize = m_allocatorDesc.buddyParams.heapMaxSize > m_allocatorDesc.heapBlockSize ? m_allocatorDesc.buddyParams.heapMaxSize : m_allocatorDesc.heapBlockSize * SHR_BUDDY_HEAP_DEFAULT_BLOCK_COUNT;
+
+	m_pHeapProvider = std::make_unique<SHRD3D12HeapProvider>(m_pDevice, m_allocatorDesc.flags, initData.properties);
+	m_pHeapProvider->SetBudget(m_allocatorDesc.pBudget, m_allocatorDesc.properties.Type);
+	m_manager.Initialize(m_pHeapProvider.get(), m_allocatorDesc.buddyParams.heapMaxSize, m_allocatorDesc.heapBlockSize, m_allocatorDesc.alignment);
+}
+
 
 bool SHRBuddyAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
 	const D3D12_RESOURCE_STATES& initState,
 	UINT size, SHRResource& resource,
 	const D3D12_CLEAR_VALUE* clrValue)
 {
+	SHRAllocationSample sample(m_stats);
+
 	if (desc.Alignment > m_allocatorDesc.alignment) return false; //ֻж뷽ʽСڵڶѶ뷽ʽܷ
 
 	UINT64 allocSize = GetAllocateSize(size, desc.Alignment);
@@ -109,29 +246,35 @@ bool SHRBuddyAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
 		return false;
 	}
 
-	AllocateBlock(layer, offset, resource);
+	AllocateBlock(layer, offset, allocSize, resource);
 
 	UINT64 addressOffset = GetRealAllocatedLocation(size, desc.Alignment, layer, offset);
 
-	ID3D12Resource* pResource;
-	ThrowIfFailed(m_pDevice->CreatePlacedResource(m_pHeap.Get(), addressOffset, &desc, initState, clrValue, IID_PPV_ARGS(&pResource)));
-	resource.m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(pResource,initState);
+	Microsoft::WRL::ComPtr<ID3D12Resource> pResource;
+	ThrowIfFailed(m_pDevice->CreatePlacedResource(GetHeap(), addressOffset, &desc, initState, clrValue, IID_PPV_ARGS(&pResource)));
+	resource.m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(pResource.Get(), initState);
 	resource.m_block.layer = layer;
 	resource.m_block.offset = offset;
 	resource.m_block.pAllocator = this;
 	resource.m_block.pResource = resource.m_pSHRD3dResource.get();
 	resource.m_pSHRD3dResource->m_resourceGPUAddress = pResource->GetGPUVirtualAddress();
+	m_liveCount++;
+	m_stats.allocationCount++;
 
 	return true;
 }
 
 void SHRBuddyAllocator::DeallocateSHRResource(SHRResource::ResourceBlock& block)
 {
-	m_defferedDeletionList.push_back(block);
+	RebindResource(block, nullptr);
+	m_liveCount--;
+	m_stats.freeCount++;
+	m_defferedDeletionList.Push(block, m_frameFenceValue);
 }
 
 void SHRBuddyAllocator::DeallocateImmediate(SHRResource::ResourceBlock& block)
 {
+	if (m_allocatorDesc.pTrace) m_allocatorDesc.pTrace->RecordFree(block.traceId);
 	DeallocateBlock(block.layer, block.offset);
 
 	if (block.pResource)
@@ -142,49 +285,17 @@ void SHRBuddyAllocator::DeallocateImmediate(SHRResource::ResourceBlock& block)
 
 void SHRBuddyAllocator::DeallocateBlock(UINT64 layer, UINT64 offset)
 {
-	UINT baseOffset = (1 << layer) - 1;
-	UINT realOffset = static_cast<UINT>(offset) + baseOffset;
-
-	m_blockStates[realOffset].valid = 1;
-
-	UINT parentOffset = (realOffset - 1) >> 1;
-	while (parentOffset)
-	{
-		if (m_blockStates[parentOffset * 2 + 1].valid && m_blockStates[parentOffset * 2 + 2].valid)
-		{
-			m_blockStates[parentOffset].valid = 1;
-		}
-		parentOffset = (parentOffset - 1) >> 1;
-	}
-
-	UINT rangeBegin = realOffset * 2 + 1;
-	UINT rangeEnd = realOffset * 2 + 2;
-	while (rangeEnd < m_blockStates.size())
-	{
-		for (UINT it = 0; rangeBegin + it <= rangeEnd; it++)
-		{
-			m_blockStates[rangeBegin + it].valid = 1;
-		}
-		rangeBegin = rangeBegin * 2 + 1;
-		rangeEnd = rangeEnd * 2 + 2;
-	}
+	m_manager.DeallocateBlock(layer, offset);
 }
 
-void SHRBuddyAllocator::CleanupHeap()
+void SHRBuddyAllocator::CleanupHeap(UINT64 completedFenceValue)
 {
-	for (size_t i = 0; i < m_defferedDeletionList.size(); i++)
-	{
-		SHRResource::ResourceBlock& block = m_defferedDeletionList[i];
-		DeallocateImmediate(block);
-	}
-
-	m_defferedDeletionList.clear();
+	m_defferedDeletionList.Retire(completedFenceValue, [this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
 }
 
 UINT64 SHRBuddyAllocator::GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset)
 {
-	UINT64 layerBlockSize = m_allocatorDesc.buddyParams.heapMaxSize >> layer;
-	UINT64 blockBaseAddressOffset = layerBlockSize * offset;
+	UINT64 blockBaseAddressOffset = m_manager.GetBlockOffset(layer, offset);
 	return alignment == 0? blockBaseAddressOffset : UPPER_ALIGNMENT(blockBaseAddressOffset, alignment);
 }
 
@@ -199,76 +310,60 @@ UINT64 SHRBuddyAllocator::GetAllocateSize(UINT64 size, UINT64 alignment)
 
 std::pair<INT, UINT> SHRBuddyAllocator::CanAllocate(UINT64 size)
 {
-	if (m_allocatorDesc.buddyParams.heapMaxSize < size) return { -1,0 };
-
-	int layer = 0;
-	while ((m_allocatorDesc.buddyParams.heapMaxSize >> layer) >= size && (m_allocatorDesc.buddyParams.heapMaxSize >> layer) >= m_allocatorDesc.heapBlockSize)
-	{
-		layer++;
-	}
-	layer -= 1;
+	return m_manager.CanAllocate(size);
+}
 
-	UINT baseOffset = (1 << layer) - 1;
-	for (UINT offset = 0; offset < (1ULL << layer); offset++)
-	{
-		if (m_blockStates[offset + baseOffset].valid)
-		{
-			return { layer, offset };
-		}
-	}
-	return { -1,0 };
+void SHRBuddyAllocator::AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource)
+{
+	m_manager.AllocateBlock(layer, offset, &resource);
 }
 
-void SHRBuddyAllocator::AllocateBlock(UINT layer, UINT offset, SHRResource& resource)
+void SHRBuddyAllocator::RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource)
 {
-	UINT baseOffset = (1 << layer) - 1;
-	UINT realOffset = offset + baseOffset;
+	m_manager.SetBlockResource(block.layer, block.offset, pResource);
+}
 
-	UINT parentOffset = realOffset;
-	m_blockStates[realOffset].pResource = &resource;
-	while (parentOffset > 0)
-	{
-		m_blockStates[parentOffset].valid = 0;
-		parentOffset = (parentOffset - 1) >> 1;
-	}
-	m_blockStates[parentOffset].valid = 0;
+SHRAllocatorStats SHRBuddyAllocator::GetStats()
+{
+	SHRAllocatorStats stats = m_stats;
+	stats.committedBytes = m_pHeapProvider->m_committedBytes;
+	stats.heapCount = m_pHeapProvider->m_heapCount;
+	stats.liveBytes = stats.committedBytes - m_manager.GetFreeSize();
+	stats.largestFreeBlock = m_manager.GetLargestFreeBlock();
+	return stats;
+}
 
-	UINT rangeBegin = realOffset * 2 + 1;
-	UINT rangeEnd = realOffset * 2 + 2;
-	while (rangeEnd < m_blockStates.size())
+void SHRBuddyAllocator::GetLiveResources(std::vector<SHRResource*>& resources)
+{
+	for (const BlockState& state : m_manager.m_blockStates)
 	{
-		for (UINT it = 0; rangeBegin + it <= rangeEnd; it++)
-		{
-			m_blockStates[rangeBegin + it].valid = 0;
-		}
-		rangeBegin = rangeBegin * 2 + 1;
-		rangeEnd = rangeEnd * 2 + 2;
+		if (state.pResource) resources.push_back(state.pResource);
 	}
 }
 
 
-SHRSegregatedAllocator::~SHRSegregatedAllocator()
+SHRSegregatedAllocator::SHRSegregatedAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData) : SHRResourceAllocator(pDevice, initData)
 {
-	delete[] m_pBlockStates;
+	Initialize(pDevice, initData);
 }
 
-
-SHRSegregatedAllocator::SHRSegregatedAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData) : SHRResourceAllocator(pDevice, initData)
+SHRSegregatedAllocator::~SHRSegregatedAllocator()
 {
-	Initialize(pDevice, initData);
+	//owners only destroy allocators once the GPU is idle
+	m_defferedDeletionList.RetireAll([this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
 }
 
-///
 void SHRSegregatedAllocator::Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData)
 {
 	m_allocatorDesc = initData;
-	m_pHeaps.resize(m_allocatorDesc.sflParams.heapLayerNum, nullptr); ////heaps ᵼڴռù󣬶Է
-	m_pBlockStates = new std::vector<BlockState>[m_allocatorDesc.sflParams.heapLayerNum];
-
-	for (size_t layer = 0; layer < m_allocatorDesc.sflParams.heapLayerNum; layer++)
+	if (m_allocatorDesc.sflParams.heapGrowSize < m_allocatorDesc.heapBlockSize)
 	{
-		m_pBlockStates[layer].resize(SHR_SEGREGATED_HEAP_DEFAULT_BLOCK_COUNT, { 0,nullptr });
+		m_allocatorDesc.sflParams.heapGrowSize = max(SHR_SEGREGATED_HEAP_DEFAULT_SIZE, m_allocatorDesc.heapBlockSize);
 	}
+
+	m_pHeapProvider = std::make_unique<SHRD3D12HeapProvider>(m_pDevice, m_allocatorDesc.flags, m_allocatorDesc.properties);
+	m_pHeapProvider->SetBudget(m_allocatorDesc.pBudget, m_allocatorDesc.properties.Type);
+	m_manager.Initialize(m_pHeapProvider.get(), m_allocatorDesc.heapBlockSize, m_allocatorDesc.sflParams.heapGrowSize, m_allocatorDesc.alignment);
 }
 
 bool SHRSegregatedAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
@@ -276,6 +371,8 @@ bool SHRSegregatedAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
 	UINT size, SHRResource& resource,
 	const D3D12_CLEAR_VALUE* clrValue)
 {
+	SHRAllocationSample sample(m_stats);
+
 	if (desc.Alignment > m_allocatorDesc.alignment) return false; //ֻж뷽ʽСڵڶѶ뷽ʽܷ
 
 	UINT64 allocSize = GetAllocateSize(size, desc.Alignment);
@@ -287,31 +384,36 @@ bool SHRSegregatedAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
 		return false;
 	}
 
-	AllocateBlock(layer, offset, resource);
+	AllocateBlock(layer, offset, allocSize, resource);
 
 	UINT64 addressOffset = GetRealAllocatedLocation(size, desc.Alignment, layer, offset);
 
-	ID3D12Resource* pResource;
-	ThrowIfFailed(m_pDevice->CreatePlacedResource(m_pHeaps[layer].Get(), addressOffset, &desc, initState, clrValue, IID_PPV_ARGS(&pResource)));
+	Microsoft::WRL::ComPtr<ID3D12Resource> pResource;
+	ThrowIfFailed(m_pDevice->CreatePlacedResource(m_pHeapProvider->GetHeap(layer), addressOffset, &desc, initState, clrValue, IID_PPV_ARGS(&pResource)));
 
-	resource.m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(pResource, initState);
+	resource.m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(pResource.Get(), initState);
 	resource.m_block.layer = layer;
 	resource.m_block.offset = offset;
-	resource.m_block.offset = offset;
 	resource.m_block.pAllocator = this;
 	resource.m_block.pResource = resource.m_pSHRD3dResource.get();
 	resource.m_pSHRD3dResource->m_resourceGPUAddress = pResource->GetGPUVirtualAddress();
+	m_liveCount++;
+	m_stats.allocationCount++;
 
 	return true;
 }
 
 void SHRSegregatedAllocator::DeallocateSHRResource(SHRResource::ResourceBlock& block)
 {
-	m_defferedDeletionList.push_back(block);
+	RebindResource(block, nullptr);
+	m_liveCount--;
+	m_stats.freeCount++;
+	m_defferedDeletionList.Push(block, m_frameFenceValue);
 }
 
 void SHRSegregatedAllocator::DeallocateImmediate(SHRResource::ResourceBlock& block)
 {
+	if (m_allocatorDesc.pTrace) m_allocatorDesc.pTrace->RecordFree(block.traceId);
 	DeallocateBlock(block.layer, block.offset);
 	if (block.pResource)
 	{
@@ -319,93 +421,367 @@ void SHRSegregatedAllocator::DeallocateImmediate(SHRResource::ResourceBlock& blo
 	}
 }
 
-void SHRSegregatedAllocator::CleanupHeap()
+void SHRSegregatedAllocator::CleanupHeap(UINT64 completedFenceValue)
 {
-	for (size_t i = 0; i < m_defferedDeletionList.size(); i++)
-	{
-		SHRResource::ResourceBlock& block = m_defferedDeletionList[i];
-		DeallocateImmediate(block);
-	}
-
-	m_defferedDeletionList.clear();
+	m_defferedDeletionList.Retire(completedFenceValue, [this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
 }
 
 std::pair<INT, UINT> SHRSegregatedAllocator::CanAllocate(UINT64 size)
 {
-	INT layer = static_cast<INT>(m_allocatorDesc.sflParams.heapLayerNum) - 1;
-	while (layer >= 0)
-	{
-		UINT64 blockSize = m_allocatorDesc.heapBlockSize << (SHR_SEGREGATED_HEAP_DEFAULT_BLOCK_COUNT - 1 - layer);
-		if (blockSize >= size)
-		{
-			if (!m_pHeaps[layer]) CreateHeap(layer);
-
-			for (UINT offset = 0; offset < SHR_SEGREGATED_HEAP_DEFAULT_BLOCK_COUNT; offset++)
-			{
-				if (m_pBlockStates[layer][offset].valid)
-				{
-					return { layer, offset };
-				}
-			}
-		}
-		layer--;
-	}
-	return { -1,0 };
+	return m_manager.CanAllocate(size);
 }
 
-void SHRSegregatedAllocator::AllocateBlock(UINT layer, UINT offset, SHRResource& resource)
+void SHRSegregatedAllocator::AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource)
 {
-	BlockState& block = m_pBlockStates[layer][offset];
-	block.pResource = &resource;
-	block.valid = 0;
+	m_manager.AllocateBlock(offset, size, &resource);
 }
 
 void SHRSegregatedAllocator::DeallocateBlock(UINT64 layer, UINT64 offset)
 {
-	BlockState& block = m_pBlockStates[layer][offset];
-	block.valid = 1;
-	block.pResource = nullptr;
+	m_manager.DeallocateBlock(static_cast<UINT>(offset));
 }
 
 UINT64 SHRSegregatedAllocator::GetAllocateSize(UINT64 size, UINT64 alignment)
 {
 	if (alignment != 0 && m_allocatorDesc.heapBlockSize % alignment != 0)
 	{
-		return size + alignment;
+		size += alignment;
 	}
-	return size;
+	return UPPER_ALIGNMENT(size, m_allocatorDesc.heapBlockSize);
 }
 
 UINT64 SHRSegregatedAllocator::GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset)
 {
-	UINT64 layerBlockSize = m_allocatorDesc.heapBlockSize << (m_allocatorDesc.sflParams.heapLayerNum - 1 - layer);
-	UINT64 blockBaseAddressOffset = layerBlockSize * offset;
+	UINT64 blockBaseAddressOffset = m_manager.GetBlockOffset(static_cast<UINT>(offset));
 	return alignment == 0 ? blockBaseAddressOffset : UPPER_ALIGNMENT(blockBaseAddressOffset, alignment);
 }
 
-void SHRSegregatedAllocator::CreateHeap(UINT layer)
+void SHRSegregatedAllocator::RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource)
 {
-	UINT64 size = (m_allocatorDesc.heapBlockSize << (SHR_SEGREGATED_HEAP_DEFAULT_BLOCK_COUNT - 1 - layer)) * SHR_SEGREGATED_HEAP_DEFAULT_BLOCK_COUNT;
+	m_manager.m_blocks[block.offset].pResource = pResource;
+}
 
-	D3D12_HEAP_DESC heapDesc = {};
-	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-	heapDesc.Properties;
-	heapDesc.Flags = m_allocatorDesc.flags;
-	heapDesc.Properties = m_allocatorDesc.properties;
-	heapDesc.SizeInBytes = size;
+SHRAllocatorStats SHRSegregatedAllocator::GetStats()
+{
+	SHRAllocatorStats stats = m_stats;
+	stats.committedBytes = m_pHeapProvider->m_committedBytes;
+	stats.heapCount = m_pHeapProvider->m_heapCount;
+	stats.liveBytes = stats.committedBytes - m_manager.GetFreeSize();
+	stats.largestFreeBlock = m_manager.GetLargestFreeBlock();
+	return stats;
+}
+
+SHRFreeListAllocator::SHRFreeListAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData) : SHRResourceAllocator(pDevice, initData)
+{
+	Initialize(pDevice, initData);
+}
+
+SHRFreeListAllocator::~SHRFreeListAllocator()
+{
+	//owners only destroy allocators once the GPU is idle
+	m_defferedDeletionList.RetireAll([this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
+}
+
+void SHRFreeListAllocator::Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData)
+{
+	m_allocatorDesc = initData;
+	if (m_allocatorDesc.freeListParams.heapSize == 0)
+	{
+		m_allocatorDesc.freeListParams.heapSize = SHR_FREELIST_HEAP_DEFAULT_SIZE;
+	}
+	m_allocatorDesc.freeListParams.heapSize = UPPER_ALIGNMENT(m_allocatorDesc.freeListParams.heapSize, m_allocatorDesc.alignment);
+
+	m_pHeapProvider = std::make_unique<SHRD3D12HeapProvider>(m_pDevice, m_allocatorDesc.flags, m_allocatorDesc.properties);
+	m_pHeapProvider->SetBudget(m_allocatorDesc.pBudget, m_allocatorDesc.properties.Type);
+	m_pManager = std::make_unique<SHRMemoryAllocationManager>(m_pHeapProvider.get(), m_allocatorDesc.freeListParams.heapSize, m_allocatorDesc.alignment);
+
+	//one buffer covers the whole heap, every allocation is a range of it
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(m_allocatorDesc.freeListParams.heapSize, m_allocatorDesc.freeListParams.bufferFlags);
+	ThrowIfFailed(m_pDevice->CreatePlacedResource(GetHeap(), 0, &bufferDesc, m_allocatorDesc.freeListParams.bufferState, nullptr, IID_PPV_ARGS(&m_pBuffer)));
+	m_bufferGPUAddress = m_pBuffer->GetGPUVirtualAddress();
+}
+
+bool SHRFreeListAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
+	const D3D12_RESOURCE_STATES& initState,
+	UINT size, SHRResource& resource,
+	const D3D12_CLEAR_VALUE* clrValue)
+{
+	SHRAllocationSample sample(m_stats);
+
+	if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER) return false;
+	if (initState != m_allocatorDesc.freeListParams.bufferState || desc.Flags != m_allocatorDesc.freeListParams.bufferFlags) return false;
+
+	UINT64 allocSize = GetAllocateSize(size, SHR_FREELIST_SUBALLOCATION_ALIGNMENT);
+
+	auto [layer, offset] = CanAllocate(allocSize);
+	if (layer == -1)
+	{
+		return false;
+	}
+
+	SHRMemoryAllocationManager::Allocation allocation = m_pManager->Allocate(allocSize, SHR_FREELIST_SUBALLOCATION_ALIGNMENT);
+	if (allocation.offset == SHR_MEMORY_INVALID_OFFSET)
+	{
+		return false;	//enough bytes free but no single block large enough
+	}
+
+	//the range shares the buffer, SHRD3D12Resource only holds another reference to it
+	resource.m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(m_pBuffer.Get(), initState);
+	resource.m_pSHRD3dResource->m_offsetInResource = allocation.offset;
+	resource.m_pSHRD3dResource->m_resourceGPUAddress = m_bufferGPUAddress + allocation.offset;
+	resource.m_block.layer = static_cast<UINT64>(allocation.block);
+	resource.m_block.offset = allocation.offset;
+	resource.m_block.pAllocator = this;
+	resource.m_block.pResource = resource.m_pSHRD3dResource.get();
+
+	if (m_blockResources.size() < m_pManager->m_blocks.size()) m_blockResources.resize(m_pManager->m_blocks.size(), nullptr);
+	m_blockResources[allocation.block] = &resource;
+	m_liveCount++;
+	m_stats.allocationCount++;
+
+	return true;
+}
+
+void SHRFreeListAllocator::DeallocateSHRResource(SHRResource::ResourceBlock& block)
+{
+	RebindResource(block, nullptr);
+	m_liveCount--;
+	m_stats.freeCount++;
+	m_defferedDeletionList.Push(block, m_frameFenceValue);
+}
+
+void SHRFreeListAllocator::DeallocateImmediate(SHRResource::ResourceBlock& block)
+{
+	if (m_allocatorDesc.pTrace) m_allocatorDesc.pTrace->RecordFree(block.traceId);
+	DeallocateBlock(block.layer, block.offset);
+	if (block.pResource)
+	{
+		delete block.pResource;
+	}
+}
+
+void SHRFreeListAllocator::CleanupHeap(UINT64 completedFenceValue)
+{
+	m_defferedDeletionList.Retire(completedFenceValue, [this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
+}
+
+std::pair<INT, UINT> SHRFreeListAllocator::CanAllocate(UINT64 size)
+{
+	//only a byte count check, Allocate still fails when no single free block is large enough
+	return { m_pManager->CanAllocate(size) ? 0 : -1, 0 };
+}
+
+void SHRFreeListAllocator::AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource)
+{
+	//ranges are found and reserved by a single SHRMemoryAllocationManager::Allocate in AllocateSHRResouce
+}
+
+void SHRFreeListAllocator::DeallocateBlock(UINT64 layer, UINT64 offset)
+{
+	m_pManager->Free({ static_cast<size_t>(offset), 0, static_cast<int32_t>(layer) });
+}
+
+UINT64 SHRFreeListAllocator::GetAllocateSize(UINT64 size, UINT64 alignment)
+{
+	return UPPER_ALIGNMENT(size, alignment);
+}
 
-	ID3D12Heap* pHeap;
-	ThrowIfFailed(m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap)));
+UINT64 SHRFreeListAllocator::GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset)
+{
+	return offset;	//ranges are placed at aligned offsets already
+}
 
-	m_pHeaps[layer] = pHeap;
+void SHRFreeListAllocator::RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource)
+{
+	m_blockResources[block.layer] = pResource;
+}
+
+SHRAllocatorStats SHRFreeListAllocator::GetStats()
+{
+	SHRAllocatorStats stats = m_stats;
+	stats.committedBytes = m_pHeapProvider->m_committedBytes;
+	stats.heapCount = m_pHeapProvider->m_heapCount;
+	stats.liveBytes = stats.committedBytes - m_pManager->m_freeSize;
+	stats.largestFreeBlock = m_pManager->GetLargestFreeBlock();
+	return stats;
+}
 
-	for (auto it = m_pBlockStates[layer].begin(); it != m_pBlockStates[layer].end(); it++)
+void SHRFreeListAllocator::GetLiveResources(std::vector<SHRResource*>& resources)
+{
+	for (SHRResource* pResource : m_blockResources)
 	{
-		it->valid = 1;
-		it->pResource = nullptr;
+		if (pResource) resources.push_back(pResource);
 	}
 }
 
+SHRDedicatedAllocator::SHRDedicatedAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData) : SHRResourceAllocator(pDevice, initData)
+{
+	Initialize(pDevice, initData);
+}
+
+SHRDedicatedAllocator::~SHRDedicatedAllocator()
+{
+	//owners only destroy allocators once the GPU is idle
+	m_defferedDeletionList.RetireAll([this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
+}
+
+void SHRDedicatedAllocator::Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData)
+{
+	m_pHeapProvider = std::make_unique<SHRD3D12HeapProvider>(m_pDevice, m_allocatorDesc.flags, m_allocatorDesc.properties);
+	m_pHeapProvider->SetBudget(m_allocatorDesc.pBudget, m_allocatorDesc.properties.Type);
+}
+
+bool SHRDedicatedAllocator::AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
+	const D3D12_RESOURCE_STATES& initState,
+	UINT size, SHRResource& resource,
+	const D3D12_CLEAR_VALUE* clrValue)
+{
+	SHRAllocationSample sample(m_stats);
+
+	//the real footprint, textures take more than their texel bytes
+	D3D12_RESOURCE_ALLOCATION_INFO info = m_pDevice->GetResourceAllocationInfo(0, 1, &desc);
+
+	auto [layer, offset] = CanAllocate(info.SizeInBytes);
+	if (layer == -1)
+	{
+		return false;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> pResource;
+	INT heapIndex = -1;
+	if (m_allocatorDesc.dedicatedParams.committed)
+	{
+		//the ALLOW_ONLY & DENY heap flags do not apply to committed resources
+		HRESULT hr = m_pDevice->CreateCommittedResource(&m_allocatorDesc.properties, D3D12_HEAP_FLAG_NONE, &desc, initState, clrValue, IID_PPV_ARGS(&pResource));
+		if (hr == E_OUTOFMEMORY) return false;
+		ThrowIfFailed(hr);
+
+		m_committedResourceBytes += info.SizeInBytes;
+		m_committedResourceCount++;
+		if (m_allocatorDesc.pBudget) m_allocatorDesc.pBudget->OnCommit(m_allocatorDesc.properties.Type, info.SizeInBytes);
+	}
+	else
+	{
+		//out of memory is reported as in the committed mode, a heap without its resource goes back right away
+		uint32_t placedHeapIndex = 0;
+		HRESULT hr = m_pHeapProvider->TryCreateHeap(info.SizeInBytes, info.Alignment, placedHeapIndex);
+		if (hr == E_OUTOFMEMORY) return false;
+		ThrowIfFailed(hr);
+
+		hr = m_pDevice->CreatePlacedResource(m_pHeapProvider->GetHeap(placedHeapIndex), 0, &desc, initState, clrValue, IID_PPV_ARGS(&pResource));
+		if (FAILED(hr))
+		{
+			m_pHeapProvider->ReleaseHeap(placedHeapIndex);
+			if (hr == E_OUTOFMEMORY) return false;
+			ThrowIfFailed(hr);
+		}
+		heapIndex = static_cast<INT>(placedHeapIndex);
+	}
+
+	UINT slot = static_cast<UINT>(m_slots.size());
+	if (!m_unusedSlots.empty())
+	{
+		slot = m_unusedSlots.back();
+		m_unusedSlots.pop_back();
+	}
+	else
+	{
+		m_slots.push_back({});
+	}
+	m_slots[slot] = { info.SizeInBytes, heapIndex, &resource };
+
+	resource.m_pSHRD3dResource = std::make_unique<SHRD3D12Resource>(pResource.Get(), initState);
+	resource.m_block.layer = slot;
+	resource.m_block.offset = 0;
+	resource.m_block.pAllocator = this;
+	resource.m_block.pResource = resource.m_pSHRD3dResource.get();
+	resource.m_pSHRD3dResource->m_resourceGPUAddress = pResource->GetGPUVirtualAddress();
+	m_liveCount++;
+	m_stats.allocationCount++;
+
+	return true;
+}
+
+void SHRDedicatedAllocator::DeallocateSHRResource(SHRResource::ResourceBlock& block)
+{
+	RebindResource(block, nullptr);
+	m_liveCount--;
+	m_stats.freeCount++;
+	m_defferedDeletionList.Push(block, m_frameFenceValue);
+}
+
+void SHRDedicatedAllocator::DeallocateImmediate(SHRResource::ResourceBlock& block)
+{
+	if (m_allocatorDesc.pTrace) m_allocatorDesc.pTrace->RecordFree(block.traceId);
+
+	//the placed resource has to go before its heap
+	if (block.pResource)
+	{
+		delete block.pResource;
+	}
+	DeallocateBlock(block.layer, block.offset);
+}
+
+void SHRDedicatedAllocator::CleanupHeap(UINT64 completedFenceValue)
+{
+	m_defferedDeletionList.Retire(completedFenceValue, [this](SHRResource::ResourceBlock& block) { DeallocateImmediate(block); });
+}
+
+std::pair<INT, UINT> SHRDedicatedAllocator::CanAllocate(UINT64 size)
+{
+	bool fitsBudget = !m_allocatorDesc.pBudget || m_allocatorDesc.pBudget->RequestCommit(m_allocatorDesc.properties.Type, size);
+	return { fitsBudget ? 0 : -1, 0 };
+}
+
+void SHRDedicatedAllocator::AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource)
+{
+	//slots are taken in AllocateSHRResouce once the resource exists
+}
+
+void SHRDedicatedAllocator::DeallocateBlock(UINT64 layer, UINT64 offset)
+{
+	Slot& slot = m_slots[layer];
+	if (slot.heapIndex != -1)
+	{
+		m_pHeapProvider->ReleaseHeap(static_cast<uint32_t>(slot.heapIndex));
+	}
+	else
+	{
+		m_committedResourceBytes -= slot.size;
+		m_committedResourceCount--;
+		if (m_allocatorDesc.pBudget) m_allocatorDesc.pBudget->OnRelease(m_allocatorDesc.properties.Type, slot.size);
+	}
+
+	slot = { 0, -1, nullptr };
+	m_unusedSlots.push_back(static_cast<UINT>(layer));
+}
+
+UINT64 SHRDedicatedAllocator::GetAllocateSize(UINT64 size, UINT64 alignment)
+{
+	return UPPER_ALIGNMENT(size, alignment);
+}
+
+UINT64 SHRDedicatedAllocator::GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset)
+{
+	return 0;	//every resource starts its own heap
+}
+
+void SHRDedicatedAllocator::RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource)
+{
+	m_slots[block.layer].pResource = pResource;
+}
+
+SHRAllocatorStats SHRDedicatedAllocator::GetStats()
+{
+	SHRAllocatorStats stats = m_stats;
+	stats.committedBytes = m_pHeapProvider->m_committedBytes + m_committedResourceBytes;
+	stats.heapCount = m_pHeapProvider->m_heapCount + m_committedResourceCount;
+	stats.liveBytes = stats.committedBytes;
+	stats.largestFreeBlock = 0;
+	stats.dedicatedCount = stats.heapCount;
+	return stats;
+}
+
 SHRBuddySystem::SHRBuddySystem(ID3D12Device* pDevice)
 {
 	Initialize(pDevice);
@@ -416,102 +792,452 @@ void SHRBuddySystem::Initialize(ID3D12Device* pDevice)
 	m_pDevice = pDevice;
 }
 
-bool SHRBuddySystem::AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
+void SHRBuddySystem::SetSubAllocateSystem(SHRFreeListSystem* pSubAllocateSystem)
+{
+	m_pSubAllocateSystem = pSubAllocateSystem;
+}
+
+SHRAllocationResult SHRBuddySystem::AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
 	const D3D12_RESOURCE_STATES& initState,
 	UINT size, SHRResource& resource,
 	const D3D12_CLEAR_VALUE* clrValue)
 {
+	//small upload & readback buffers become ranges of a shared buffer instead of one placed resource each. their heaps pin
+	//the state, so the ranges never transition the shared buffer under each other. default buffers stay placed, they are
+	//transitioned & may get typed or odd stride views a 256B aligned range cannot express
+	BOOL isFixedState = requiredType == D3D12_HEAP_TYPE_UPLOAD || requiredType == D3D12_HEAP_TYPE_READBACK;
+	if (m_pSubAllocateSystem && isFixedState && desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER && size < SHR_BUDDY_SUBALLOCATION_THRESHOLD)
+	{
+		return m_pSubAllocateSystem->AllocateSHRResouce(requiredType, desc, initState, size, resource, clrValue);	//traced by the sub-allocate system
+	}
+
+	UINT64 refusedCount = GetRefusedCount(m_pBudget, requiredType);
+
+	BOOL isDefault = desc.Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	D3D12_HEAP_FLAGS flags = GetAllocatorFlags(SHRAllocatorType::Buddy, desc);
+	UINT64 alignment = isDefault ? D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT : desc.Alignment;
+	UINT64 heapBlockSize = max(SHR_BUDDY_HEAP_DEFAULT_BLOCK_SIZE, desc.Alignment);
+	UINT64 heapMaxSize = isDefault ? SHR_BUDDY_HEAP_DEFAULT_MAX_SIZE : heapBlockSize * SHR_BUDDY_HEAP_DEFAULT_BLOCK_COUNT;
+
 	bool result = false;
+	SHRAllocatorType tracedType = SHRAllocatorType::Buddy;
+
+	//a large buffer would leave most of a buddy heap to rounding, or not fit one at all
+	if (size >= m_dedicatedThreshold || size > heapMaxSize)
+	{
+		tracedType = SHRAllocatorType::Dedicated;
+
+		SHRAllocatorDesc allocDesc = {};
+		allocDesc.type = SHRAllocatorType::Dedicated;
+		allocDesc.properties = CD3DX12_HEAP_PROPERTIES(requiredType);
+		allocDesc.flags = flags;
+		allocDesc.alignment = alignment;
+		allocDesc.dedicatedParams.committed = m_useCommittedResources;
+		allocDesc.pBudget = m_pBudget;
+		allocDesc.pTrace = m_pTrace;
+
+		result = GetDedicatedAllocator(m_dedicatedAllocators, m_pDevice, allocDesc, m_frameFenceValue).AllocateSHRResouce(desc, initState, size, resource, clrValue);
+	}
+	else
+	{
+		//the largest free block of the picked allocator already fits the request, so the first visit succeeds
+		SHRBuddyAllocator* pAllocator = FindBestFitAllocator(GetAllocatorClass(requiredType, flags, alignment), desc.Alignment, size);
+
+		//over-aligned heaps of the same type & flags still take the request before a new heap is created
+		for (size_t i = 0; !pAllocator && i < m_allocatorClasses.size(); i++)
+		{
+			const AllocatorClass& allocatorClass = m_allocatorClasses[i];
+			if (allocatorClass.heapType != requiredType || allocatorClass.flags != flags || allocatorClass.alignment <= alignment) continue;
+			pAllocator = FindBestFitAllocator(allocatorClass, desc.Alignment, size);
+		}
+
+		if (pAllocator) result = pAllocator->AllocateSHRResouce(desc, initState, size, resource, clrValue);
+
+		if (!result && (!m_pBudget || m_pBudget->RequestCommit(requiredType, heapMaxSize)))
+		{
+			SHRAllocatorDesc allocDesc = {};
+			allocDesc.type = SHRAllocatorType::Buddy;
+			allocDesc.properties = CD3DX12_HEAP_PROPERTIES(requiredType);
+			allocDesc.flags = flags;
+			allocDesc.heapBlockSize = heapBlockSize;
+			allocDesc.buddyParams.heapMaxSize = heapMaxSize;
+			allocDesc.alignment = alignment;
+			allocDesc.pBudget = m_pBudget;
+			allocDesc.pTrace = m_pTrace;
+
+			//RequestCommit may have trimmed allocators and rebuilt the index, look the class up again
+			m_allocators.push_back(std::make_unique<SHRBuddyAllocator>(m_pDevice, allocDesc));
+			m_allocators.back()->SetFrameFenceValue(m_frameFenceValue);
+			GetAllocatorClass(requiredType, flags, alignment).allocators.push_back(m_allocators.back().get());
+			result = m_allocators.back()->AllocateSHRResouce(desc, initState, size, resource, clrValue);
+		}
+	}
+
+	if (!result) m_failedCount++;
+	TraceAllocation(m_pTrace, tracedType, flags, requiredType, desc, initState, size, result, resource);
+	return result ? SHRAllocationResult::Success : GetFailureResult(m_pBudget, requiredType, refusedCount);
+}
 
+void SHRBuddySystem::SetFrameFenceValue(UINT64 fenceValue)
+{
+	m_frameFenceValue = fenceValue;
 	for (size_t i = 0; i < m_allocators.size(); i++)
 	{
-		SHRBuddyAllocator& allocator = m_allocators[i];
-		result = ValidateAllocation(allocator.GetDesc(), desc, requiredType);
-		if (result) result = allocator.AllocateSHRResouce(desc, initState, size, resource, clrValue);
-		if (result) break;
+		m_allocators[i]->SetFrameFenceValue(fenceValue);
+	}
+	for (auto& pAllocator : m_dedicatedAllocators)
+	{
+		pAllocator->SetFrameFenceValue(fenceValue);
+	}
+}
+
+void SHRBuddySystem::CleanupSystem(UINT64 completedFenceValue)
+{
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		SHRResourceAllocator& allocator = *m_allocators[i];
+		allocator.CleanupHeap(completedFenceValue);
 	}
 
-	if (!result)
+	for (auto& pAllocator : m_dedicatedAllocators)
 	{
-		BOOL isDefault = desc.Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		pAllocator->CleanupHeap(completedFenceValue);
+	}
 
-		CD3DX12_HEAP_PROPERTIES properties(requiredType);
+	size_t allocatorCount = m_allocators.size();
+	ReleaseIdleAllocators(m_allocators, m_idleFrameLimit);
+	if (m_allocators.size() != allocatorCount) RebuildAllocatorIndex();
+}
+
+void SHRBuddySystem::SetMemoryBudget(SHRMemoryBudget* pBudget)
+{
+	m_pBudget = pBudget;
+	m_pBudget->AddTrimCallback([this](uint32_t heapType) { TrimSystem(heapType); });
+}
+
+void SHRBuddySystem::TrimSystem(uint32_t heapType)
+{
+	size_t allocatorCount = m_allocators.size();
+	TrimAllocators(m_allocators, heapType);
+	if (m_allocators.size() != allocatorCount) RebuildAllocatorIndex();
+}
+
+void SHRBuddySystem::SetTraceRecorder(SHRAllocationTraceRecorder* pTrace)
+{
+	m_pTrace = pTrace;
+	SetAllocatorsTraceRecorder(m_allocators, pTrace);
+	SetAllocatorsTraceRecorder(m_dedicatedAllocators, pTrace);
+}
+
+SHRAllocatorStats SHRBuddySystem::GetStats()
+{
+	SHRAllocatorStats stats = {};
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		stats.Accumulate(m_allocators[i]->GetStats());
+	}
+	for (auto& pAllocator : m_dedicatedAllocators)
+	{
+		stats.Accumulate(pAllocator->GetStats());
+	}
+	stats.failedCount += m_failedCount;
+	return stats;
+}
+
+SHRBuddySystem::AllocatorClass& SHRBuddySystem::GetAllocatorClass(D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS flags, UINT64 alignment)
+{
+	//only a handful of classes ever exist, a linear scan beats hashing here
+	for (AllocatorClass& allocatorClass : m_allocatorClasses)
+	{
+		if (allocatorClass.heapType == heapType && allocatorClass.flags == flags && allocatorClass.alignment == alignment) return allocatorClass;
+	}
+	m_allocatorClasses.push_back({ heapType, flags, alignment, {} });
+	return m_allocatorClasses.back();
+}
+
+SHRBuddyAllocator* SHRBuddySystem::FindBestFitAllocator(const AllocatorClass& allocatorClass, UINT64 alignment, UINT size)
+{
+	SHRBuddyAllocator* pBestFit = nullptr;
+	UINT64 bestFreeBlock = 0;
+
+	for (SHRBuddyAllocator* pAllocator : allocatorClass.allocators)
+	{
+		if (pAllocator->m_isEvacuating) continue;
+
+		UINT64 allocSize = pAllocator->GetAllocateSize(size, alignment);
+		UINT64 largestFreeBlock = pAllocator->m_manager.GetLargestFreeBlock();
+		if (largestFreeBlock < allocSize) continue;
+
+		if (!pBestFit || largestFreeBlock < bestFreeBlock)
+		{
+			pBestFit = pAllocator;
+			bestFreeBlock = largestFreeBlock;
+		}
+
+		//the block would be taken without splitting, nothing fits tighter
+		if (largestFreeBlock < allocSize * 2 || largestFreeBlock == pAllocator->m_manager.m_blockSize) break;
+	}
+	return pBestFit;
+}
+
+void SHRBuddySystem::RebuildAllocatorIndex()
+{
+	for (AllocatorClass& allocatorClass : m_allocatorClasses)
+	{
+		allocatorClass.allocators.clear();
+	}
+
+	for (auto& pAllocator : m_allocators)
+	{
+		const SHRAllocatorDesc& allocDesc = pAllocator->m_allocatorDesc;
+		GetAllocatorClass(allocDesc.properties.Type, allocDesc.flags, allocDesc.alignment).allocators.push_back(pAllocator.get());
+	}
+}
+
+
+SHRSegregatedListSystem::SHRSegregatedListSystem(ID3D12Device* pDevice)
+{
+	Initialize(pDevice);
+}
+
+void SHRSegregatedListSystem::Initialize(ID3D12Device* pDevice)
+{
+	m_pDevice = pDevice;
+}
+
+SHRAllocationResult SHRSegregatedListSystem::AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
+	const D3D12_RESOURCE_STATES& initState,
+	UINT size, SHRResource& resource,
+	const D3D12_CLEAR_VALUE* clrValue)
+{
+	UINT64 refusedCount = GetRefusedCount(m_pBudget, requiredType);
+
+	BOOL isDefault = desc.Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	D3D12_HEAP_FLAGS flags = GetAllocatorFlags(SHRAllocatorType::Segregated, desc);
+
+	bool result = false;
+	SHRAllocatorType tracedType = SHRAllocatorType::Segregated;
+
+	//a large texture would grow a heap of its own size that stays in the allocator after it is released
+	if (size >= m_dedicatedThreshold)
+	{
+		tracedType = SHRAllocatorType::Dedicated;
 
 		SHRAllocatorDesc allocDesc = {};
-		allocDesc.type = SHRAllocatorType::Buddy;
-		allocDesc.properties = properties;
-		allocDesc.flags = GetAllocatorFlags(SHRAllocatorType::Buddy, desc);
-		allocDesc.heapBlockSize = max(SHR_BUDDY_HEAP_DEFAULT_BLOCK_SIZE, desc.Alignment);
-		allocDesc.buddyParams.heapMaxSize = isDefault ? SHR_BUDDY_HEAP_DEFAULT_MAX_SIZE : allocDesc.heapBlockSize * SHR_BUDDY_HEAP_DEFAULT_BLOCK_COUNT;
+		allocDesc.type = SHRAllocatorType::Dedicated;
+		allocDesc.properties = CD3DX12_HEAP_PROPERTIES(requiredType);
+		allocDesc.flags = flags;
 		allocDesc.alignment = isDefault ? D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT : desc.Alignment;
+		allocDesc.dedicatedParams.committed = m_useCommittedResources;
+		allocDesc.pBudget = m_pBudget;
+		allocDesc.pTrace = m_pTrace;
+
+		result = GetDedicatedAllocator(m_dedicatedAllocators, m_pDevice, allocDesc, m_frameFenceValue).AllocateSHRResouce(desc, initState, size, resource, clrValue);
+	}
+	else
+	{
+		for (size_t i = 0; i < m_allocators.size(); i++)
+		{
+			SHRSegregatedAllocator& allocator = *m_allocators[i];
+			result = ValidateAllocation(allocator.GetDesc(), desc, requiredType);
+			if (result) result = allocator.AllocateSHRResouce(desc, initState, size, resource, clrValue);
+			if (result) break;
+		}
+
+		if (!result)
+		{
+			SHRAllocatorDesc allocDesc = {};
+			allocDesc.type = SHRAllocatorType::Segregated;
+			allocDesc.properties = CD3DX12_HEAP_PROPERTIES(requiredType);
+			allocDesc.flags = flags;
+			allocDesc.alignment = isDefault ? D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT : desc.Alignment;
+			allocDesc.heapBlockSize = allocDesc.alignment;
+			allocDesc.sflParams.heapGrowSize = SHR_SEGREGATED_HEAP_DEFAULT_SIZE;
+			allocDesc.pBudget = m_pBudget;
+			allocDesc.pTrace = m_pTrace;
+			m_allocators.push_back(std::make_unique<SHRSegregatedAllocator>(m_pDevice, allocDesc));
+			m_allocators.back()->SetFrameFenceValue(m_frameFenceValue);
+			result = m_allocators.back()->AllocateSHRResouce(desc, initState, size, resource, clrValue);
+		}
+	}
+
+	if (!result) m_failedCount++;
+	TraceAllocation(m_pTrace, tracedType, flags, requiredType, desc, initState, size, result, resource);
+	return result ? SHRAllocationResult::Success : GetFailureResult(m_pBudget, requiredType, refusedCount);
+}
+
+void SHRSegregatedListSystem::SetFrameFenceValue(UINT64 fenceValue)
+{
+	m_frameFenceValue = fenceValue;
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		m_allocators[i]->SetFrameFenceValue(fenceValue);
+	}
+	for (auto& pAllocator : m_dedicatedAllocators)
+	{
+		pAllocator->SetFrameFenceValue(fenceValue);
+	}
+}
 
-		m_allocators.emplace_back(m_pDevice, allocDesc);
-		m_allocators[m_allocators.size() - 1].AllocateSHRResouce(desc, initState, size, resource, clrValue);
+void SHRSegregatedListSystem::CleanupSystem(UINT64 completedFenceValue)
+{
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		SHRSegregatedAllocator& allocator = *m_allocators[i];
+		allocator.CleanupHeap(completedFenceValue);
+		allocator.m_manager.TrimHeaps(m_idleFrameLimit);
 	}
+	for (auto& pAllocator : m_dedicatedAllocators)
+	{
+		pAllocator->CleanupHeap(completedFenceValue);
+	}
+}
 
-	return result;
+void SHRSegregatedListSystem::SetMemoryBudget(SHRMemoryBudget* pBudget)
+{
+	m_pBudget = pBudget;
+	m_pBudget->AddTrimCallback([this](uint32_t heapType) { TrimSystem(heapType); });
 }
 
-void SHRBuddySystem::CleanupSystem()
+void SHRSegregatedListSystem::TrimSystem(uint32_t heapType)
 {
+	//heaps only grow inside an allocator, so only its empty heaps are released
 	for (size_t i = 0; i < m_allocators.size(); i++)
 	{
-		SHRResourceAllocator& allocator = m_allocators[i];
-		allocator.CleanupHeap();
+		SHRSegregatedAllocator& allocator = *m_allocators[i];
+		if (allocator.GetDesc().properties.Type == heapType) allocator.m_manager.ReleaseEmptyHeaps();
 	}
 }
 
+void SHRSegregatedListSystem::SetTraceRecorder(SHRAllocationTraceRecorder* pTrace)
+{
+	m_pTrace = pTrace;
+	SetAllocatorsTraceRecorder(m_allocators, pTrace);
+	SetAllocatorsTraceRecorder(m_dedicatedAllocators, pTrace);
+}
 
-SHRSegregatedListSystem::SHRSegregatedListSystem(ID3D12Device* pDevice)
+SHRAllocatorStats SHRSegregatedListSystem::GetStats()
+{
+	SHRAllocatorStats stats = {};
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		stats.Accumulate(m_allocators[i]->GetStats());
+	}
+	for (auto& pAllocator : m_dedicatedAllocators)
+	{
+		stats.Accumulate(pAllocator->GetStats());
+	}
+	stats.failedCount += m_failedCount;
+	return stats;
+}
+
+SHRFreeListSystem::SHRFreeListSystem(ID3D12Device* pDevice)
 {
 	Initialize(pDevice);
 }
 
-void SHRSegregatedListSystem::Initialize(ID3D12Device* pDevice)
+void SHRFreeListSystem::Initialize(ID3D12Device* pDevice)
 {
 	m_pDevice = pDevice;
 }
 
-bool SHRSegregatedListSystem::AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
+SHRAllocationResult SHRFreeListSystem::AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
 	const D3D12_RESOURCE_STATES& initState,
 	UINT size, SHRResource& resource,
 	const D3D12_CLEAR_VALUE* clrValue)
 {
+	//heaps are a single buffer that is handed out in ranges
+	if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		m_failedCount++;
+		return SHRAllocationResult::Unsupported;
+	}
+
+	UINT64 refusedCount = GetRefusedCount(m_pBudget, requiredType);
+
 	bool result = false;
 
 	for (size_t i = 0; i < m_allocators.size(); i++)
 	{
-		SHRSegregatedAllocator& allocator = m_allocators[i];
-		result = ValidateAllocation(allocator.GetDesc(), desc, requiredType);
+		SHRFreeListAllocator& allocator = *m_allocators[i];
+		result = !allocator.m_isEvacuating && ValidateAllocation(allocator.GetDesc(), desc, requiredType);
 		if (result) result = allocator.AllocateSHRResouce(desc, initState, size, resource, clrValue);
 		if (result) break;
 	}
 
 	if (!result)
 	{
-		BOOL isDefault = desc.Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-
 		CD3DX12_HEAP_PROPERTIES properties(requiredType);
 
 		SHRAllocatorDesc allocDesc = {};
-		allocDesc.type = SHRAllocatorType::Segregated;
+		allocDesc.type = SHRAllocatorType::FreeList;
 		allocDesc.properties = properties;
-		allocDesc.flags = GetAllocatorFlags(SHRAllocatorType::Segregated, desc);
-		allocDesc.alignment = isDefault ? D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT : desc.Alignment;
-		allocDesc.heapBlockSize = allocDesc.alignment;
-		allocDesc.sflParams.heapLayerNum = SHR_SEGREGATED_HEAP_DEFAULT_LAYER_NUM;
-		m_allocators.emplace_back(m_pDevice, allocDesc);
-		m_allocators[m_allocators.size() - 1].AllocateSHRResouce(desc, initState, size, resource, clrValue);
+		allocDesc.flags = GetAllocatorFlags(SHRAllocatorType::FreeList, desc);
+		allocDesc.alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		allocDesc.heapBlockSize = SHR_FREELIST_SUBALLOCATION_ALIGNMENT;
+		allocDesc.freeListParams.heapSize = max((UINT64)SHR_FREELIST_HEAP_DEFAULT_SIZE, UPPER_ALIGNMENT(size, SHR_FREELIST_SUBALLOCATION_ALIGNMENT));
+		allocDesc.freeListParams.bufferState = initState;
+		allocDesc.freeListParams.bufferFlags = desc.Flags;
+		allocDesc.pBudget = m_pBudget;
+		allocDesc.pTrace = m_pTrace;
+
+		if (!m_pBudget || m_pBudget->RequestCommit(requiredType, allocDesc.freeListParams.heapSize))
+		{
+			m_allocators.push_back(std::make_unique<SHRFreeListAllocator>(m_pDevice, allocDesc));
+			m_allocators.back()->SetFrameFenceValue(m_frameFenceValue);
+			result = m_allocators.back()->AllocateSHRResouce(desc, initState, size, resource, clrValue);
+		}
+	}
+
+	if (!result) m_failedCount++;
+	TraceAllocation(m_pTrace, SHRAllocatorType::FreeList, GetAllocatorFlags(SHRAllocatorType::FreeList, desc), requiredType, desc, initState, size, result, resource);
+	return result ? SHRAllocationResult::Success : GetFailureResult(m_pBudget, requiredType, refusedCount);
+}
+
+void SHRFreeListSystem::SetFrameFenceValue(UINT64 fenceValue)
+{
+	m_frameFenceValue = fenceValue;
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		m_allocators[i]->SetFrameFenceValue(fenceValue);
+	}
+}
+
+void SHRFreeListSystem::CleanupSystem(UINT64 completedFenceValue)
+{
+	for (size_t i = 0; i < m_allocators.size(); i++)
+	{
+		SHRResourceAllocator& allocator = *m_allocators[i];
+		allocator.CleanupHeap(completedFenceValue);
 	}
 
-	return result;
+	ReleaseIdleAllocators(m_allocators, m_idleFrameLimit);
+}
+
+void SHRFreeListSystem::SetMemoryBudget(SHRMemoryBudget* pBudget)
+{
+	m_pBudget = pBudget;
+	m_pBudget->AddTrimCallback([this](uint32_t heapType) { TrimSystem(heapType); });
+}
+
+void SHRFreeListSystem::TrimSystem(uint32_t heapType)
+{
+	TrimAllocators(m_allocators, heapType);
+}
+
+void SHRFreeListSystem::SetTraceRecorder(SHRAllocationTraceRecorder* pTrace)
+{
+	m_pTrace = pTrace;
+	SetAllocatorsTraceRecorder(m_allocators, pTrace);
 }
 
-void SHRSegregatedListSystem::CleanupSystem()
+SHRAllocatorStats SHRFreeListSystem::GetStats()
 {
+	SHRAllocatorStats stats = {};
 	for (size_t i = 0; i < m_allocators.size(); i++)
 	{
-		SHRResourceAllocator& allocator = m_allocators[i];
-		allocator.CleanupHeap();
+		stats.Accumulate(m_allocators[i]->GetStats());
 	}
+	stats.failedCount += m_failedCount;
+	return stats;
 }
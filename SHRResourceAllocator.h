@@ -1,24 +1,50 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 
 #include "d3dx12.h"
 
 #include "SHRUtils.h"
 #include "SHRResource.h"
+#include "SHRFencedQueue.h"
+#include "SHRHeapProvider.h"
+#include "SHRMemoryBudget.h"
+#include "SHRAllocatorStats.h"
+#include "SHRAllocationTrace.h"
+#include "SHRBuddyAllocationManager.h"
+#include "SHRSegregatedAllocationManager.h"
+#include "SHRMemoryAllocationManager.h"
 
 #define SHR_BUDDY_HEAP_DEFAULT_MAX_SIZE 8192 * 1024  //KB = 8MB
 #define SHR_BUDDY_HEAP_DEFAULT_BLOCK_SIZE D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT * 4 //32KB
 #define SHR_BUDDY_HEAP_DEFAULT_BLOCK_COUNT 8
+#define SHR_BUDDY_SUBALLOCATION_THRESHOLD D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT	//a placed buffer never takes less than 64KB
+#define SHR_BUDDY_DEDICATED_THRESHOLD SHR_BUDDY_HEAP_DEFAULT_MAX_SIZE / 2	//4MB, a larger buffer gets a resource of its own
 
-#define SHR_SEGREGATED_HEAP_DEFAULT_BLOCK_COUNT 4
-#define SHR_SEGREGATED_HEAP_DEFAULT_LAYER_NUM 4
-//#define SHR_SEGREGATED_HEAP_DEFAULT_MIN_BLOCK_SIZE 32
+#define SHR_SEGREGATED_HEAP_DEFAULT_SIZE 16384 * 1024  //KB = 16MB
+#define SHR_SEGREGATED_DEDICATED_THRESHOLD SHR_SEGREGATED_HEAP_DEFAULT_SIZE / 2	//8MB, big render targets & streaming textures
+
+#define SHR_ALLOCATOR_DEFAULT_IDLE_FRAME_LIMIT 300	//frames a drained allocator or heap is kept before it is released
+
+#define SHR_FREELIST_HEAP_DEFAULT_SIZE 32768 * 1024  //KB = 32MB
+#define SHR_FREELIST_SUBALLOCATION_ALIGNMENT D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT //256B, enough for cbv/vbv/ibv/raw views
 
 enum class SHRAllocatorType : uint8_t
 {
 	Buddy,
-	Segregated
+	Segregated,
+	FreeList,
+	Dedicated
+};
+
+//returned by the allocator systems, anything but Success leaves the resource untouched
+enum class SHRAllocationResult : uint8_t
+{
+	Success,
+	OutOfBudget,		//a new heap or dedicated resource would go over the memory budget
+	OutOfMemory,		//no heap could place it and the device refused a new one
+	Unsupported			//the system does not take this kind of resource
 };
 
 struct SHRBuddyAllocatorParams
@@ -28,7 +54,20 @@ struct SHRBuddyAllocatorParams
 
 struct SHRSFLAllocatorParams
 {
-	UINT64 heapLayerNum;
+	UINT64 heapGrowSize;
+};
+
+//every range of a free list heap shares one placed buffer, so they share its state and flags as well
+struct SHRFreeListAllocatorParams
+{
+	UINT64 heapSize;
+	D3D12_RESOURCE_STATES bufferState;
+	D3D12_RESOURCE_FLAGS bufferFlags;
+};
+
+struct SHRDedicatedAllocatorParams
+{
+	BOOL committed;		//committed resources, otherwise a heap of the exact size per resource
 };
 
 struct SHRAllocatorDesc
@@ -42,9 +81,41 @@ struct SHRAllocatorDesc
 	{
 		SHRBuddyAllocatorParams buddyParams;
 		SHRSFLAllocatorParams sflParams;
+		SHRFreeListAllocatorParams freeListParams;
+		SHRDedicatedAllocatorParams dedicatedParams;
 	};
+	SHRMemoryBudget* pBudget;		//heaps are reported here, nullptr when nothing is budgeted
+	SHRAllocationTraceRecorder* pTrace;	//retired blocks are recorded here, nullptr when nothing is traced
 };
 
+//creates the ID3D12Heaps requested by the allocation managers
+class SHRD3D12HeapProvider : public SHRHeapProvider
+{
+public:
+	SHRD3D12HeapProvider(ID3D12Device* pDevice, D3D12_HEAP_FLAGS flags, const D3D12_HEAP_PROPERTIES& properties);
+	~SHRD3D12HeapProvider();
+
+	uint32_t CreateHeap(uint64_t size, uint64_t alignment);
+	void ReleaseHeap(uint32_t heapIndex);
+
+	//as CreateHeap, but a failed device call is returned instead of thrown and nothing is committed
+	HRESULT TryCreateHeap(uint64_t size, uint64_t alignment, uint32_t& heapIndex);
+
+	ID3D12Heap* GetHeap(uint32_t heapIndex) { return m_pHeaps[heapIndex].Get(); }
+
+public:
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> m_pHeaps;
+	std::vector<uint64_t> m_heapSizes;
+	//released indices are handed out again, a dedicated allocator creates and releases a heap per resource
+	std::vector<uint32_t> m_unusedHeapIndices;
+	uint64_t m_committedBytes = 0;
+	uint64_t m_heapCount = 0;
+
+private:
+	ID3D12Device* m_pDevice = nullptr;
+	D3D12_HEAP_FLAGS m_flags;
+	D3D12_HEAP_PROPERTIES m_properties;
+};
 
 class SHRResourceAllocator
 {
@@ -61,26 +132,41 @@ public:
 
 	virtual void DeallocateSHRResource(SHRResource::ResourceBlock& block) = 0;
 	virtual void DeallocateImmediate(SHRResource::ResourceBlock& block) = 0;
-	virtual void CleanupHeap() = 0;
+	virtual void CleanupHeap(UINT64 completedFenceValue) = 0;
 
 	virtual std::pair<INT, UINT> CanAllocate(UINT64 size) = 0;
-	virtual void AllocateBlock(UINT layer, UINT offset, SHRResource& resource) = 0;
+	virtual void AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource) = 0;
 
 	virtual void DeallocateBlock(UINT64 layer, UINT64 offset) = 0;
 	virtual UINT64 GetAllocateSize(UINT64 size, UINT64 alignment) = 0;
 	virtual UINT64 GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset) = 0;
 
+	//the back-pointer of a live block follows its SHRResource when it moves, nullptr once it is released
+	virtual void RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource) = 0;
+
+	//m_stats plus the occupancy of the heaps, walks the free lists so keep it out of hot paths
+	virtual SHRAllocatorStats GetStats() = 0;
+
 	SHRAllocatorDesc GetDesc();
 
+	//blocks released from now on are freed once the fence reaches this value
+	void SetFrameFenceValue(UINT64 fenceValue) { m_frameFenceValue = fenceValue; }
+
 public:
-	struct BlockState
-	{
-		UINT valid;
-		SHRResource* pResource;
-	};
+	typedef SHRBlockState BlockState;
 
-	std::vector<SHRResource::ResourceBlock> m_defferedDeletionList;
+	SHRFencedQueue<SHRResource::ResourceBlock> m_defferedDeletionList;
 	SHRAllocatorDesc m_allocatorDesc;
+	UINT64 m_frameFenceValue = 0;
+
+	//blocks handed out and not released yet, deferred deletions are not counted
+	UINT64 m_liveCount = 0;
+	//set by the defragmenter, no new block is placed here and the owner drops the allocator once it drains
+	bool m_isEvacuating = false;
+	//consecutive frames without live blocks or deferred deletions
+	uint32_t m_idleFrameCount = 0;
+
+	SHRAllocatorStats m_stats = {};
 
 protected:
 	ID3D12Device* m_pDevice = nullptr;
@@ -90,7 +176,7 @@ class SHRBuddyAllocator : public SHRResourceAllocator
 {
 public:
 	SHRBuddyAllocator() = default;
-	~SHRBuddyAllocator() = default;
+	~SHRBuddyAllocator();
 
 	SHRBuddyAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData);
 
@@ -103,18 +189,24 @@ public:
 
 	void DeallocateSHRResource(SHRResource::ResourceBlock& block);
 	void DeallocateImmediate(SHRResource::ResourceBlock& block);
-	void CleanupHeap();
+	void CleanupHeap(UINT64 completedFenceValue);
 
 	std::pair<INT, UINT> CanAllocate(UINT64 size);					//return {layer, offset}
-	void AllocateBlock(UINT layer, UINT offset, SHRResource& resource);					//return offset
+	void AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource);
 
 	void DeallocateBlock(UINT64 layer, UINT64 offset);
 	UINT64 GetAllocateSize(UINT64 size, UINT64 alignment);
 	UINT64 GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset);
 
+	void RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource);
+	SHRAllocatorStats GetStats();
+	void GetLiveResources(std::vector<SHRResource*>& resources);
+
+	ID3D12Heap* GetHeap() { return m_pHeapProvider->GetHeap(m_manager.m_heapIndex); }
+
 public:
-	std::vector<BlockState> m_blockStates;
-	Microsoft::WRL::ComPtr<ID3D12Heap> m_pHeap = nullptr;
+	std::unique_ptr<SHRD3D12HeapProvider> m_pHeapProvider;
+	SHRBuddyAllocationManager m_manager;
 };
 
 class SHRSegregatedAllocator : public SHRResourceAllocator
@@ -138,44 +230,184 @@ public:
 
 	void DeallocateSHRResource(SHRResource::ResourceBlock& block);
 	void DeallocateImmediate(SHRResource::ResourceBlock& block);
-	void CleanupHeap();
+	void CleanupHeap(UINT64 completedFenceValue);
 
-	std::pair<INT, UINT> CanAllocate(UINT64 size);
-	void AllocateBlock(UINT layer, UINT offset, SHRResource& resource);
+	std::pair<INT, UINT> CanAllocate(UINT64 size);					//return {heap, block}
+	void AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource);
 
 	void DeallocateBlock(UINT64 layer, UINT64 offset);
 	UINT64 GetAllocateSize(UINT64 size, UINT64 alignment);
 	UINT64 GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset);
 
-private:
-	void CreateHeap(UINT layer);
+	void RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource);
+	SHRAllocatorStats GetStats();
 
 public:
-	std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> m_pHeaps;
-	std::vector<BlockState>* m_pBlockStates;
+	std::unique_ptr<SHRD3D12HeapProvider> m_pHeapProvider;
+	SHRSegregatedAllocationManager m_manager;
+};
 
-private:
+//sub-allocates one placed buffer by exact aligned size, resources are ranges of that buffer instead of placed resources.
+//ResourceBlock::layer is the block node of the range and ResourceBlock::offset its byte offset.
+//every range has its own m_currentState over the one shared buffer, so ranges must not be transitioned
+class SHRFreeListAllocator : public SHRResourceAllocator
+{
+public:
+	SHRFreeListAllocator() = default;
+	~SHRFreeListAllocator();
+
+	SHRFreeListAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData);
+
+	void Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData);
+
+	bool AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
+		const D3D12_RESOURCE_STATES& initState,
+		UINT size, SHRResource& resource,
+		const D3D12_CLEAR_VALUE* clrValue = nullptr);
+
+	void DeallocateSHRResource(SHRResource::ResourceBlock& block);
+	void DeallocateImmediate(SHRResource::ResourceBlock& block);
+	void CleanupHeap(UINT64 completedFenceValue);
+
+	std::pair<INT, UINT> CanAllocate(UINT64 size);					//return {0, 0} when enough bytes are free, {-1, 0} otherwise
+	void AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource);
+
+	void DeallocateBlock(UINT64 layer, UINT64 offset);
+	UINT64 GetAllocateSize(UINT64 size, UINT64 alignment);
+	UINT64 GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset);
+
+	void RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource);
+	SHRAllocatorStats GetStats();
+	void GetLiveResources(std::vector<SHRResource*>& resources);
 
+	ID3D12Heap* GetHeap() { return m_pHeapProvider->GetHeap(m_pManager->m_heapIndex); }
+
+public:
+	std::unique_ptr<SHRD3D12HeapProvider> m_pHeapProvider;
+	std::unique_ptr<SHRMemoryAllocationManager> m_pManager;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_pBuffer;
+	D3D12_GPU_VIRTUAL_ADDRESS m_bufferGPUAddress = 0;
+
+	//indexed by block node, the manager itself does not know about resources
+	std::vector<SHRResource*> m_blockResources;
 };
 
+//one resource per allocation for the ones too large to share a heap, either committed or placed at 0 in a heap of its own.
+//ResourceBlock::layer is the slot of the allocation and ResourceBlock::offset is always 0
+class SHRDedicatedAllocator : public SHRResourceAllocator
+{
+public:
+	struct Slot
+	{
+		UINT64 size;
+		INT heapIndex;		//-1 for a committed resource
+		SHRResource* pResource;
+	};
+
+public:
+	SHRDedicatedAllocator() = default;
+	~SHRDedicatedAllocator();
+
+	SHRDedicatedAllocator(ID3D12Device* pDevice, const SHRAllocatorDesc& initData);
+
+	void Initialize(ID3D12Device* pDevice, const SHRAllocatorDesc& initData);
+
+	bool AllocateSHRResouce(const D3D12_RESOURCE_DESC& desc,
+		const D3D12_RESOURCE_STATES& initState,
+		UINT size, SHRResource& resource,
+		const D3D12_CLEAR_VALUE* clrValue = nullptr);
+
+	void DeallocateSHRResource(SHRResource::ResourceBlock& block);
+	void DeallocateImmediate(SHRResource::ResourceBlock& block);
+	void CleanupHeap(UINT64 completedFenceValue);
+
+	std::pair<INT, UINT> CanAllocate(UINT64 size);					//return {0, 0} unless the budget refuses size
+	void AllocateBlock(UINT layer, UINT offset, UINT64 size, SHRResource& resource);
+
+	void DeallocateBlock(UINT64 layer, UINT64 offset);
+	UINT64 GetAllocateSize(UINT64 size, UINT64 alignment);
+	UINT64 GetRealAllocatedLocation(UINT64 size, UINT64 alignment, UINT64 layer, UINT64 offset);
+
+	void RebindResource(const SHRResource::ResourceBlock& block, SHRResource* pResource);
+	SHRAllocatorStats GetStats();
+
+public:
+	std::unique_ptr<SHRD3D12HeapProvider> m_pHeapProvider;
+	std::vector<Slot> m_slots;
+	std::vector<UINT> m_unusedSlots;
+
+	//committed resources only, heaps are counted by the provider
+	UINT64 m_committedResourceBytes = 0;
+	UINT64 m_committedResourceCount = 0;
+};
+
+class SHRFreeListSystem;
+
 class SHRBuddySystem
 {
+public:
+	//allocators sharing heap type, heap flags & alignment, a request only looks at the allocators of its class
+	struct AllocatorClass
+	{
+		D3D12_HEAP_TYPE heapType;
+		D3D12_HEAP_FLAGS flags;
+		UINT64 alignment;
+		std::vector<SHRBuddyAllocator*> allocators;
+	};
+
 public:
 	SHRBuddySystem(ID3D12Device* pDevice);
 	void Initialize(ID3D12Device* pDevice);
 
-	bool AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
+	//upload & readback buffers smaller than SHR_BUDDY_SUBALLOCATION_THRESHOLD are forwarded to pSubAllocateSystem when set
+	void SetSubAllocateSystem(SHRFreeListSystem* pSubAllocateSystem);
+
+	SHRAllocationResult AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
 		const D3D12_RESOURCE_STATES& initState,
 		UINT size, SHRResource& resource,
 		const D3D12_CLEAR_VALUE* clrValue = nullptr);
 
-	void CleanupSystem();
+	void SetFrameFenceValue(UINT64 fenceValue);
+	//also releases allocators drained for m_idleFrameLimit frames
+	void CleanupSystem(UINT64 completedFenceValue);
+
+	//new heaps are checked against pBudget, which may ask this system to release its drained heaps
+	void SetMemoryBudget(SHRMemoryBudget* pBudget);
+	void TrimSystem(uint32_t heapType);
+
+	//requests and retired blocks are recorded while pTrace is recording
+	void SetTraceRecorder(SHRAllocationTraceRecorder* pTrace);
+
+	//sum over the allocators, requests no allocator could serve are counted as failed
+	SHRAllocatorStats GetStats();
+
+private:
+	AllocatorClass& GetAllocatorClass(D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS flags, UINT64 alignment);
+	//the allocator whose largest free block fits the request tightest, nullptr when none of the class can take it
+	SHRBuddyAllocator* FindBestFitAllocator(const AllocatorClass& allocatorClass, UINT64 alignment, UINT size);
+	//m_allocatorClasses hold raw pointers, called whenever allocators are dropped
+	void RebuildAllocatorIndex();
 
 public:
-	std::vector<SHRBuddyAllocator> m_allocators;
+	//allocators are held by pointer, resource blocks keep a back-pointer to their allocator
+	std::vector<std::unique_ptr<SHRBuddyAllocator>> m_allocators;
+	std::vector<AllocatorClass> m_allocatorClasses;
+	uint32_t m_idleFrameLimit = SHR_ALLOCATOR_DEFAULT_IDLE_FRAME_LIMIT;
+
+	//buffers of at least m_dedicatedThreshold bytes skip the buddy heaps
+	std::vector<std::unique_ptr<SHRDedicatedAllocator>> m_dedicatedAllocators;
+	UINT64 m_dedicatedThreshold = SHR_BUDDY_DEDICATED_THRESHOLD;
+	BOOL m_useCommittedResources = TRUE;
 
 private:
 	ID3D12Device* m_pDevice = nullptr;
+	UINT64 m_frameFenceValue = 0;
+
+	SHRMemoryBudget* m_pBudget = nullptr;
+	SHRAllocationTraceRecorder* m_pTrace = nullptr;
+	UINT64 m_failedCount = 0;
+
+	SHRFreeListSystem* m_pSubAllocateSystem = nullptr;
 };
 
 class SHRSegregatedListSystem
@@ -184,17 +416,80 @@ public:
 	SHRSegregatedListSystem(ID3D12Device* pDevice);
 	void Initialize(ID3D12Device* pDevice);
 
-	bool AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
+	SHRAllocationResult AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
 		const D3D12_RESOURCE_STATES& initState,
 		UINT size, SHRResource& resource,
 		const D3D12_CLEAR_VALUE* clrValue = nullptr);
 
-	void CleanupSystem();
+	void SetFrameFenceValue(UINT64 fenceValue);
+	//also releases heaps left empty for m_idleFrameLimit frames
+	void CleanupSystem(UINT64 completedFenceValue);
+
+	//new heaps are checked against pBudget, which may ask this system to release its drained heaps
+	void SetMemoryBudget(SHRMemoryBudget* pBudget);
+	void TrimSystem(uint32_t heapType);
+
+	//requests and retired blocks are recorded while pTrace is recording
+	void SetTraceRecorder(SHRAllocationTraceRecorder* pTrace);
+
+	//sum over the allocators, requests no allocator could serve are counted as failed
+	SHRAllocatorStats GetStats();
+
 public:
-	std::vector<SHRSegregatedAllocator> m_allocators;
+	std::vector<std::unique_ptr<SHRSegregatedAllocator>> m_allocators;
+	uint32_t m_idleFrameLimit = SHR_ALLOCATOR_DEFAULT_IDLE_FRAME_LIMIT;
+
+	//textures of at least m_dedicatedThreshold bytes skip the segregated heaps
+	std::vector<std::unique_ptr<SHRDedicatedAllocator>> m_dedicatedAllocators;
+	UINT64 m_dedicatedThreshold = SHR_SEGREGATED_DEDICATED_THRESHOLD;
+	BOOL m_useCommittedResources = TRUE;
 
 private:
 	ID3D12Device* m_pDevice = nullptr;
+	UINT64 m_frameFenceValue = 0;
+
+	SHRMemoryBudget* m_pBudget = nullptr;
+	SHRAllocationTraceRecorder* m_pTrace = nullptr;
+	UINT64 m_failedCount = 0;
+};
+
+class SHRFreeListSystem
+{
+public:
+	SHRFreeListSystem(ID3D12Device* pDevice);
+	void Initialize(ID3D12Device* pDevice);
+
+	//Unsupported unless desc describes a buffer
+	SHRAllocationResult AllocateSHRResouce(D3D12_HEAP_TYPE requiredType, const D3D12_RESOURCE_DESC& desc,
+		const D3D12_RESOURCE_STATES& initState,
+		UINT size, SHRResource& resource,
+		const D3D12_CLEAR_VALUE* clrValue = nullptr);
+
+	void SetFrameFenceValue(UINT64 fenceValue);
+	//also releases allocators drained for m_idleFrameLimit frames
+	void CleanupSystem(UINT64 completedFenceValue);
+
+	//new heaps are checked against pBudget, which may ask this system to release its drained heaps
+	void SetMemoryBudget(SHRMemoryBudget* pBudget);
+	void TrimSystem(uint32_t heapType);
+
+	//requests and retired blocks are recorded while pTrace is recording
+	void SetTraceRecorder(SHRAllocationTraceRecorder* pTrace);
+
+	//sum over the allocators, requests no allocator could serve are counted as failed
+	SHRAllocatorStats GetStats();
+
+public:
+	std::vector<std::unique_ptr<SHRFreeListAllocator>> m_allocators;
+	uint32_t m_idleFrameLimit = SHR_ALLOCATOR_DEFAULT_IDLE_FRAME_LIMIT;
+
+private:
+	ID3D12Device* m_pDevice = nullptr;
+	UINT64 m_frameFenceValue = 0;
+
+	SHRMemoryBudget* m_pBudget = nullptr;
+	SHRAllocationTraceRecorder* m_pTrace = nullptr;
+	UINT64 m_failedCount = 0;
 };
 
 //class SHRMemorySystem
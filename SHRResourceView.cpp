@@ -1,6 +1,6 @@
 #include "SHRResourceView.h"
 
-SHRResourceView::SHRResourceView(SHRRenderContext& renderContext, SHRResourceViewType type, SHRResource* pResource) : m_type(type), m_pResource(pResource->m_pSHRD3dResource.get())
+SHRResourceView::SHRResourceView(SHRRenderContext& renderContext, SHRResourceViewType type, SHRResource* pResource) : m_type(type), m_pResource(pResource ? pResource->m_pSHRD3dResource.get() : nullptr)
 {
 	if (type == SHRResourceViewType::IBV || type == SHRResourceViewType::VBV)
 	{
@@ -32,33 +32,76 @@ void SHRResourceView::Destory()
 	m_heapSlotAllocator->DeallocateSlot(m_viewLocation);
 }
 
-SHRConstantBufferView::SHRConstantBufferView(SHRRenderContext& renderContext, D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, SHRResource* pResouce) : SHRResourceView(renderContext, SHRResourceViewType::CBV, pResouce)
+//bytes per element of a typed buffer view, 0 for formats a buffer view cannot have
+static UINT GetBufferFormatSize(DXGI_FORMAT format)
+{
+	if (format >= DXGI_FORMAT_R32G32B32A32_TYPELESS && format <= DXGI_FORMAT_R32G32B32A32_SINT) return 16;
+	if (format >= DXGI_FORMAT_R32G32B32_TYPELESS && format <= DXGI_FORMAT_R32G32B32_SINT) return 12;
+	if (format >= DXGI_FORMAT_R16G16B16A16_TYPELESS && format <= DXGI_FORMAT_X32_TYPELESS_G8X24_UINT) return 8;
+	if (format >= DXGI_FORMAT_R10G10B10A2_TYPELESS && format <= DXGI_FORMAT_X24_TYPELESS_G8_UINT) return 4;
+	if (format >= DXGI_FORMAT_R8G8_TYPELESS && format <= DXGI_FORMAT_R16_SINT) return 2;
+	if (format >= DXGI_FORMAT_R8_TYPELESS && format <= DXGI_FORMAT_A8_UNORM) return 1;
+	if (format == DXGI_FORMAT_R9G9B9E5_SHAREDEXP) return 4;
+	if (format == DXGI_FORMAT_B5G6R5_UNORM || format == DXGI_FORMAT_B5G5R5A1_UNORM || format == DXGI_FORMAT_B4G4R4A4_UNORM) return 2;
+	if (format >= DXGI_FORMAT_B8G8R8A8_UNORM && format <= DXGI_FORMAT_B8G8R8X8_UNORM_SRGB) return 4;
+	return 0;
+}
+
+UINT64 SHRResourceView::GetFirstElementInResource(UINT structureByteStride, BOOL isRaw, DXGI_FORMAT format)
+{
+	if (!m_pResource || m_pResource->m_offsetInResource == 0) return 0;
+
+	//raw views count in 32 bit words, structured ones in the stride, typed ones in the format size
+	UINT64 elementSize = isRaw ? 4 : structureByteStride ? structureByteStride : GetBufferFormatSize(format);
+	if (elementSize == 0 || m_pResource->m_offsetInResource % elementSize != 0)
+	{
+		ThrowIfFailed(E_INVALIDARG);
+	}
+	return m_pResource->m_offsetInResource / elementSize;
+}
+
+SHRConstantBufferView::SHRConstantBufferView(SHRRenderContext& renderContext, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, SHRResource* pResouce) : SHRResourceView(renderContext, SHRResourceViewType::CBV, pResouce)
 {
 	CreateConstantBufferView(renderContext, desc);
 }
 
-void SHRConstantBufferView::CreateConstantBufferView(SHRRenderContext& renderContext, D3D12_CONSTANT_BUFFER_VIEW_DESC& desc)
+void SHRConstantBufferView::CreateConstantBufferView(SHRRenderContext& renderContext, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc)
 {
-	renderContext.GetDevice()->CreateConstantBufferView(&desc, m_viewLocation.slotHandle);
+	D3D12_CONSTANT_BUFFER_VIEW_DESC viewDesc = desc;
+	if (m_pResource)
+	{
+		viewDesc.BufferLocation += m_pResource->m_offsetInResource;
+	}
+	renderContext.GetDevice()->CreateConstantBufferView(&viewDesc, m_viewLocation.slotHandle);
 }
 
-SHRShaderResourceView::SHRShaderResourceView(SHRRenderContext& renderContext, D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource) : SHRResourceView(renderContext, SHRResourceViewType::SRV, pResource)
+SHRShaderResourceView::SHRShaderResourceView(SHRRenderContext& renderContext, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource) : SHRResourceView(renderContext, SHRResourceViewType::SRV, pResource)
 {
 	CreateShaderResourceView(renderContext, desc, pResource);
 }
 
-void SHRShaderResourceView::CreateShaderResourceView(SHRRenderContext& renderContext, D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource)
+void SHRShaderResourceView::CreateShaderResourceView(SHRRenderContext& renderContext, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource)
 {
-	renderContext.GetDevice()->CreateShaderResourceView(m_pResource->m_pResource.Get(), &desc, m_viewLocation.slotHandle);
+	D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = desc;
+	if (viewDesc.ViewDimension == D3D12_SRV_DIMENSION_BUFFER)
+	{
+		viewDesc.Buffer.FirstElement += GetFirstElementInResource(viewDesc.Buffer.StructureByteStride, viewDesc.Buffer.Flags & D3D12_BUFFER_SRV_FLAG_RAW, viewDesc.Format);
+	}
+	renderContext.GetDevice()->CreateShaderResourceView(m_pResource->m_pResource.Get(), &viewDesc, m_viewLocation.slotHandle);
 }
-SHRUnorderedAccessView::SHRUnorderedAccessView(SHRRenderContext& renderContext, D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource) : SHRResourceView(renderContext, SHRResourceViewType::UAV, pResource)
+SHRUnorderedAccessView::SHRUnorderedAccessView(SHRRenderContext& renderContext, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource) : SHRResourceView(renderContext, SHRResourceViewType::UAV, pResource)
 {
 	CreateShaderResourceView(renderContext, desc, pResource);
 }
 
-void SHRUnorderedAccessView::CreateShaderResourceView(SHRRenderContext& renderContext, D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource)
+void SHRUnorderedAccessView::CreateShaderResourceView(SHRRenderContext& renderContext, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource)
 {
-	renderContext.GetDevice()->CreateUnorderedAccessView(m_pResource->m_pResource.Get(), nullptr, &desc, m_viewLocation.slotHandle);
+	D3D12_UNORDERED_ACCESS_VIEW_DESC viewDesc = desc;
+	if (viewDesc.ViewDimension == D3D12_UAV_DIMENSION_BUFFER)
+	{
+		viewDesc.Buffer.FirstElement += GetFirstElementInResource(viewDesc.Buffer.StructureByteStride, viewDesc.Buffer.Flags & D3D12_BUFFER_UAV_FLAG_RAW, viewDesc.Format);
+	}
+	renderContext.GetDevice()->CreateUnorderedAccessView(m_pResource->m_pResource.Get(), nullptr, &viewDesc, m_viewLocation.slotHandle);
 }
 
 SHRRenderTargetView::SHRRenderTargetView(SHRRenderContext& renderContext, D3D12_RENDER_TARGET_VIEW_DESC& desc, SHRResource* pResource) : SHRResourceView(renderContext, SHRResourceViewType::RTV, pResource)
@@ -101,9 +144,16 @@ SHRVertexBufferView::SHRVertexBufferView(SHRRenderContext& renderContext, UINT v
 	CreateVertexBufferView(pResource, vertexSize, totalSize);
 }
 
+SHRVertexBufferView::SHRVertexBufferView(SHRRenderContext& renderContext, UINT vertexSize, UINT totalSize, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) : SHRResourceView(renderContext, SHRResourceViewType::VBV, nullptr)
+{
+	m_vertexBufferView.BufferLocation = bufferLocation;
+	m_vertexBufferView.StrideInBytes = vertexSize;
+	m_vertexBufferView.SizeInBytes = totalSize;
+}
+
 void SHRVertexBufferView::CreateVertexBufferView(SHRResource* pResource, UINT vertexSize, UINT totalSize)
 {
-	m_vertexBufferView.BufferLocation = m_pResource->m_pResource->GetGPUVirtualAddress();
+	m_vertexBufferView.BufferLocation = m_pResource->m_resourceGPUAddress;
 	m_vertexBufferView.StrideInBytes = vertexSize;
 	m_vertexBufferView.SizeInBytes = totalSize;
 }
@@ -115,7 +165,7 @@ SHRIndexBufferView::SHRIndexBufferView(SHRRenderContext& renderContext, UINT tot
 
 void SHRIndexBufferView::CreateIndexBufferView(SHRResource* pResource, UINT totalSize)
 {
-	m_indexBufferView.BufferLocation = m_pResource->m_pResource->GetGPUVirtualAddress();
+	m_indexBufferView.BufferLocation = m_pResource->m_resourceGPUAddress;
 	m_indexBufferView.SizeInBytes = totalSize;
 	m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
 }
\ No newline at end of file
@@ -25,6 +25,10 @@ public:
 
 	D3D12_CPU_DESCRIPTOR_HANDLE GetViewHandle() { return m_viewLocation.slotHandle; }
 
+protected:
+	//element index of the sub-allocated range start, buffer srv/uav descs are relative to the range
+	UINT64 GetFirstElementInResource(UINT structureByteStride, BOOL isRaw, DXGI_FORMAT format);
+
 private:
 	void Destory();
 
@@ -38,31 +42,32 @@ public:
 class SHRConstantBufferView : public SHRResourceView
 {
 public:
-	SHRConstantBufferView(SHRRenderContext& renderContext, D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, SHRResource* pResource);
+	//desc.BufferLocation is a GPU address of the D3D12 resource, a sub-allocated range moves it by the range offset
+	SHRConstantBufferView(SHRRenderContext& renderContext, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, SHRResource* pResource);
 	virtual ~SHRConstantBufferView() = default;
 
 protected:
-	void CreateConstantBufferView(SHRRenderContext& renderContext, D3D12_CONSTANT_BUFFER_VIEW_DESC& desc);
+	void CreateConstantBufferView(SHRRenderContext& renderContext, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc);
 };
 
 class SHRShaderResourceView : public SHRResourceView
 {
 public:
-	SHRShaderResourceView(SHRRenderContext& renderContext, D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource);
+	SHRShaderResourceView(SHRRenderContext& renderContext, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource);
 	virtual ~SHRShaderResourceView() = default;
 
 protected:
-	void CreateShaderResourceView(SHRRenderContext& renderContext, D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource);
+	void CreateShaderResourceView(SHRRenderContext& renderContext, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, SHRResource* pResource);
 };
 
 class SHRUnorderedAccessView : public SHRResourceView
 {
 public:
-	SHRUnorderedAccessView(SHRRenderContext& renderContext, D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource);
+	SHRUnorderedAccessView(SHRRenderContext& renderContext, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource);
 	virtual ~SHRUnorderedAccessView() = default;
 
 protected:
-	void CreateShaderResourceView(SHRRenderContext& renderContext, D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource);
+	void CreateShaderResourceView(SHRRenderContext& renderContext, const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc, SHRResource* pResource);
 };
 
 class SHRRenderTargetView : public SHRResourceView
@@ -100,6 +105,8 @@ class SHRVertexBufferView : public SHRResourceView
 {
 public:
 	SHRVertexBufferView(SHRRenderContext& renderContext, UINT vertexSize, UINT totalSize, SHRResource* pResource);
+	//views into transient upload memory that is not owned by a SHRResource
+	SHRVertexBufferView(SHRRenderContext& renderContext, UINT vertexSize, UINT totalSize, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation);
 	virtual ~SHRVertexBufferView() = default;
 
 	D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() { return m_vertexBufferView; }
@@ -0,0 +1,49 @@
+#include "SHRRingAllocationManager.h"
+
+SHRRingAllocationManager::SHRRingAllocationManager(uint64_t size)
+{
+	Initialize(size);
+}
+
+void SHRRingAllocationManager::Initialize(uint64_t size)
+{
+	m_size = size;
+	m_head = 0;
+	m_usedSize = 0;
+	m_frameUsedSize = 0;
+	m_frameUsedSizes = SHRFencedQueue<uint64_t>();
+}
+
+uint64_t SHRRingAllocationManager::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || size > m_size) return SHR_RING_INVALID_OFFSET;
+
+	uint64_t offset = (m_head + alignment - 1) & ~(alignment - 1);
+	if (offset + size > m_size)
+	{
+		//not enough room before the end of the ring, restart from zero
+		offset = 0;
+	}
+
+	uint64_t consumedSize = (offset >= m_head ? offset - m_head : m_size - m_head) + size;
+	if (m_usedSize + consumedSize > m_size) return SHR_RING_INVALID_OFFSET;
+
+	m_head = offset + size == m_size ? 0 : offset + size;
+	m_usedSize += consumedSize;
+	m_frameUsedSize += consumedSize;
+	return offset;
+}
+
+void SHRRingAllocationManager::FinishFrame(uint64_t fenceValue)
+{
+	m_frameUsedSizes.Push(m_frameUsedSize, fenceValue);
+	m_frameUsedSize = 0;
+}
+
+void SHRRingAllocationManager::Retire(uint64_t completedFenceValue)
+{
+	m_frameUsedSizes.Retire(completedFenceValue, [this](uint64_t usedSize) { m_usedSize -= usedSize; });
+
+	//nothing live, start over at zero so a request as large as the ring fits again
+	if (m_usedSize == 0) m_head = 0;
+}
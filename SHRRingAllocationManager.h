@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SHRFencedQueue.h"
+
+#define SHR_RING_INVALID_OFFSET UINT64_MAX
+
+//bump allocation over a circular range, space is handed back a whole frame at a time once its fence completes.
+//every allocation is contiguous, a tail too small for the request is skipped and charged to the current frame
+class SHRRingAllocationManager
+{
+public:
+	SHRRingAllocationManager() = default;
+	SHRRingAllocationManager(uint64_t size);
+	~SHRRingAllocationManager() = default;
+
+	void Initialize(uint64_t size);
+
+	uint64_t Allocate(uint64_t size, uint64_t alignment = 1);		//return SHR_RING_INVALID_OFFSET when the ring is full
+	void FinishFrame(uint64_t fenceValue);							//everything allocated since the last call is retired with fenceValue
+	void Retire(uint64_t completedFenceValue);
+
+	uint64_t GetFreeSize() const { return m_size - m_usedSize; }
+
+public:
+	uint64_t m_size = 0;
+	uint64_t m_head = 0;
+	uint64_t m_usedSize = 0;
+	uint64_t m_frameUsedSize = 0;
+
+	//bytes consumed by each finished frame, padding included
+	SHRFencedQueue<uint64_t> m_frameUsedSizes;
+};
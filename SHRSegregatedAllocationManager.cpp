@@ -0,0 +1,321 @@
+#include "SHRSegregatedAllocationManager.h"
+#include "SHRBitUtils.h"
+
+#include <algorithm>
+
+//the fl & sl bitmaps are 32 bit
+static_assert(SHR_SEGREGATED_FL_INDEX_COUNT >= 1 && SHR_SEGREGATED_FL_INDEX_COUNT <= 32, "fl index count must fit the 32 bit fl bitmap");
+static_assert(SHR_SEGREGATED_SL_INDEX_COUNT_LOG2 >= 1 && SHR_SEGREGATED_SL_INDEX_COUNT_LOG2 <= 5, "sl index count must fit the 32 bit sl bitmaps");
+
+SHRSegregatedAllocationManager::SHRSegregatedAllocationManager(SHRHeapProvider* pProvider, uint64_t blockSize, uint64_t heapGrowSize, uint64_t alignment)
+{
+	Initialize(pProvider, blockSize, heapGrowSize, alignment);
+}
+
+void SHRSegregatedAllocationManager::Initialize(SHRHeapProvider* pProvider, uint64_t blockSize, uint64_t heapGrowSize, uint64_t alignment)
+{
+	m_pProvider = pProvider;
+	m_blockSize = blockSize;
+	m_heapGrowSize = std::max(heapGrowSize, blockSize);
+	m_alignment = alignment;
+
+	m_blocks.clear();
+	m_unusedBlockNodes.clear();
+	m_heapIndices.clear();
+	m_heapFirstBlocks.clear();
+	m_heapIdleFrames.clear();
+
+	m_flBitmap = 0;
+	for (uint32_t fl = 0; fl < SHR_SEGREGATED_FL_INDEX_COUNT; fl++)
+	{
+		m_slBitmaps[fl] = 0;
+		for (uint32_t sl = 0; sl < SHR_SEGREGATED_SL_INDEX_COUNT; sl++)
+		{
+			m_freeHeads[fl][sl] = -1;
+		}
+	}
+}
+
+std::pair<int32_t, uint32_t> SHRSegregatedAllocationManager::CanAllocate(uint64_t size)
+{
+	uint64_t allocSize = (size + m_blockSize - 1) / m_blockSize * m_blockSize;
+
+	int32_t block = FindFreeBlock(allocSize);
+	if (block == -1)
+	{
+		//no free block is large enough, grow by a new heap unless the budget refuses it
+		if (!m_pProvider->CanCreateHeap(std::max(m_heapGrowSize, allocSize))) return { -1,0 };
+		//taken directly, a heap sized exactly to a request sits below the class FindFreeBlock rounds it up to
+		block = static_cast<int32_t>(CreateHeap(allocSize));
+	}
+
+	return { static_cast<int32_t>(m_blocks[block].heapIndex), static_cast<uint32_t>(block) };
+}
+
+void SHRSegregatedAllocationManager::AllocateBlock(uint32_t block, uint64_t size, SHRResource* pResource)
+{
+	uint64_t allocSize = (size + m_blockSize - 1) / m_blockSize * m_blockSize;
+
+	RemoveFreeBlock(block);
+
+	//split the tail off as a new free block
+	if (m_blocks[block].size - allocSize >= m_blockSize)
+	{
+		uint32_t rest = CreateBlockNode();
+		Block& usedBlock = m_blocks[block];
+		Block& restBlock = m_blocks[rest];
+
+		restBlock.offset = usedBlock.offset + allocSize;
+		restBlock.size = usedBlock.size - allocSize;
+		restBlock.heapIndex = usedBlock.heapIndex;
+		restBlock.prevPhysical = block;
+		restBlock.nextPhysical = usedBlock.nextPhysical;
+		restBlock.pResource = nullptr;
+		if (usedBlock.nextPhysical != -1) m_blocks[usedBlock.nextPhysical].prevPhysical = rest;
+
+		usedBlock.nextPhysical = rest;
+		usedBlock.size = allocSize;
+
+		InsertFreeBlock(rest);
+	}
+
+	Block& usedBlock = m_blocks[block];
+	usedBlock.pResource = pResource;
+	m_pProvider->OnAllocate(usedBlock.heapIndex, usedBlock.offset, usedBlock.size);
+}
+
+void SHRSegregatedAllocationManager::DeallocateBlock(uint32_t block)
+{
+	m_blocks[block].pResource = nullptr;
+	m_pProvider->OnFree(m_blocks[block].heapIndex, m_blocks[block].offset, m_blocks[block].size);
+
+	int32_t prev = m_blocks[block].prevPhysical;
+	if (prev != -1 && m_blocks[prev].free)
+	{
+		RemoveFreeBlock(prev);
+		MergeBlocks(prev, block);
+		block = prev;
+	}
+
+	int32_t next = m_blocks[block].nextPhysical;
+	if (next != -1 && m_blocks[next].free)
+	{
+		RemoveFreeBlock(next);
+		MergeBlocks(block, next);
+	}
+
+	InsertFreeBlock(block);
+}
+
+uint32_t SHRSegregatedAllocationManager::CreateHeap(uint64_t minSize)
+{
+	uint64_t size = std::max(m_heapGrowSize, minSize);
+	uint32_t heapIndex = m_pProvider->CreateHeap(size, m_alignment);
+	m_heapIndices.push_back(heapIndex);
+
+	uint32_t node = CreateBlockNode();
+	m_heapFirstBlocks.push_back(node);
+	m_heapIdleFrames.push_back(0);
+	Block& block = m_blocks[node];
+	block.offset = 0;
+	block.size = size;
+	block.heapIndex = heapIndex;
+	block.prevPhysical = -1;
+	block.nextPhysical = -1;
+	block.pResource = nullptr;
+
+	InsertFreeBlock(node);
+	return node;
+}
+
+uint64_t SHRSegregatedAllocationManager::GetFreeSize() const
+{
+	uint64_t freeSize = 0;
+	for (uint32_t fl = 0; fl < SHR_SEGREGATED_FL_INDEX_COUNT; fl++)
+	{
+		for (uint32_t sl = 0; sl < SHR_SEGREGATED_SL_INDEX_COUNT; sl++)
+		{
+			for (int32_t block = m_freeHeads[fl][sl]; block != -1; block = m_blocks[block].nextFree)
+			{
+				freeSize += m_blocks[block].size;
+			}
+		}
+	}
+	return freeSize;
+}
+
+uint64_t SHRSegregatedAllocationManager::GetLargestFreeBlock() const
+{
+	if (m_flBitmap == 0) return 0;
+
+	//the largest block is in the highest non-empty bucket, sizes inside a bucket still differ
+	uint32_t fl = SHRFindLastSet(m_flBitmap);
+	uint32_t sl = SHRFindLastSet(m_slBitmaps[fl]);
+	uint64_t largest = 0;
+	for (int32_t block = m_freeHeads[fl][sl]; block != -1; block = m_blocks[block].nextFree)
+	{
+		if (m_blocks[block].size > largest) largest = m_blocks[block].size;
+	}
+	return largest;
+}
+
+void SHRSegregatedAllocationManager::TrimHeaps(uint32_t idleFrameLimit)
+{
+	for (uint32_t heap = 0; heap < m_heapIndices.size();)
+	{
+		m_heapIdleFrames[heap] = IsHeapEmpty(heap) ? m_heapIdleFrames[heap] + 1 : 0;
+		if (m_heapIdleFrames[heap] >= idleFrameLimit)
+		{
+			ReleaseHeap(heap);
+			continue;
+		}
+		heap++;
+	}
+}
+
+void SHRSegregatedAllocationManager::ReleaseEmptyHeaps()
+{
+	for (uint32_t heap = 0; heap < m_heapIndices.size();)
+	{
+		if (IsHeapEmpty(heap))
+		{
+			ReleaseHeap(heap);
+			continue;
+		}
+		heap++;
+	}
+}
+
+bool SHRSegregatedAllocationManager::IsHeapEmpty(uint32_t heap) const
+{
+	const Block& firstBlock = m_blocks[m_heapFirstBlocks[heap]];
+	return firstBlock.free && firstBlock.nextPhysical == -1;
+}
+
+void SHRSegregatedAllocationManager::ReleaseHeap(uint32_t heap)
+{
+	uint32_t block = m_heapFirstBlocks[heap];
+	RemoveFreeBlock(block);
+	ReleaseBlockNode(block);
+	m_pProvider->ReleaseHeap(m_heapIndices[heap]);
+
+	//swap with the last heap, heaps are only found through their blocks
+	m_heapIndices[heap] = m_heapIndices.back();
+	m_heapFirstBlocks[heap] = m_heapFirstBlocks.back();
+	m_heapIdleFrames[heap] = m_heapIdleFrames.back();
+	m_heapIndices.pop_back();
+	m_heapFirstBlocks.pop_back();
+	m_heapIdleFrames.pop_back();
+}
+
+void SHRSegregatedAllocationManager::MappingInsert(uint64_t units, uint32_t& fl, uint32_t& sl)
+{
+	if (units < SHR_SEGREGATED_SL_INDEX_COUNT)
+	{
+		fl = 0;
+		sl = static_cast<uint32_t>(units);
+	}
+	else
+	{
+		uint32_t lastBit = SHRFindLastSet(units);
+		sl = static_cast<uint32_t>(units >> (lastBit - SHR_SEGREGATED_SL_INDEX_COUNT_LOG2)) ^ SHR_SEGREGATED_SL_INDEX_COUNT;
+		fl = lastBit - (SHR_SEGREGATED_SL_INDEX_COUNT_LOG2 - 1);
+	}
+}
+
+void SHRSegregatedAllocationManager::MappingSearch(uint64_t units, uint32_t& fl, uint32_t& sl)
+{
+	//round up to the next class so that every block in the found list fits
+	if (units >= SHR_SEGREGATED_SL_INDEX_COUNT)
+	{
+		units += (1ULL << (SHRFindLastSet(units) - SHR_SEGREGATED_SL_INDEX_COUNT_LOG2)) - 1;
+	}
+	MappingInsert(units, fl, sl);
+}
+
+int32_t SHRSegregatedAllocationManager::FindFreeBlock(uint64_t size)
+{
+	uint32_t fl, sl;
+	MappingSearch(size / m_blockSize, fl, sl);
+	if (fl >= SHR_SEGREGATED_FL_INDEX_COUNT) return -1;
+
+	uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+	if (slMap == 0)
+	{
+		uint32_t flMap = fl + 1 < SHR_SEGREGATED_FL_INDEX_COUNT ? m_flBitmap & (~0u << (fl + 1)) : 0;
+		if (flMap == 0) return -1;
+
+		fl = SHRFindFirstSet(flMap);
+		slMap = m_slBitmaps[fl];
+	}
+	sl = SHRFindFirstSet(slMap);
+
+	return m_freeHeads[fl][sl];
+}
+
+void SHRSegregatedAllocationManager::InsertFreeBlock(uint32_t block)
+{
+	uint32_t fl, sl;
+	MappingInsert(m_blocks[block].size / m_blockSize, fl, sl);
+
+	Block& freeBlock = m_blocks[block];
+	freeBlock.free = 1;
+	freeBlock.prevFree = -1;
+	freeBlock.nextFree = m_freeHeads[fl][sl];
+	if (freeBlock.nextFree != -1) m_blocks[freeBlock.nextFree].prevFree = block;
+	m_freeHeads[fl][sl] = block;
+
+	m_flBitmap |= 1u << fl;
+	m_slBitmaps[fl] |= 1u << sl;
+}
+
+void SHRSegregatedAllocationManager::RemoveFreeBlock(uint32_t block)
+{
+	uint32_t fl, sl;
+	MappingInsert(m_blocks[block].size / m_blockSize, fl, sl);
+
+	Block& freeBlock = m_blocks[block];
+	if (freeBlock.prevFree != -1)
+		m_blocks[freeBlock.prevFree].nextFree = freeBlock.nextFree;
+	else
+		m_freeHeads[fl][sl] = freeBlock.nextFree;
+	if (freeBlock.nextFree != -1) m_blocks[freeBlock.nextFree].prevFree = freeBlock.prevFree;
+
+	freeBlock.free = 0;
+	freeBlock.prevFree = freeBlock.nextFree = -1;
+
+	if (m_freeHeads[fl][sl] == -1)
+	{
+		m_slBitmaps[fl] &= ~(1u << sl);
+		if (m_slBitmaps[fl] == 0) m_flBitmap &= ~(1u << fl);
+	}
+}
+
+void SHRSegregatedAllocationManager::MergeBlocks(uint32_t left, uint32_t right)
+{
+	Block& leftBlock = m_blocks[left];
+	Block& rightBlock = m_blocks[right];
+
+	leftBlock.size += rightBlock.size;
+	leftBlock.nextPhysical = rightBlock.nextPhysical;
+	if (rightBlock.nextPhysical != -1) m_blocks[rightBlock.nextPhysical].prevPhysical = left;
+
+	ReleaseBlockNode(right);
+}
+
+uint32_t SHRSegregatedAllocationManager::CreateBlockNode()
+{
+	if (!m_unusedBlockNodes.empty())
+	{
+		uint32_t node = m_unusedBlockNodes.back();
+		m_unusedBlockNodes.pop_back();
+		return node;
+	}
+	m_blocks.push_back({});
+	return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+void SHRSegregatedAllocationManager::ReleaseBlockNode(uint32_t block)
+{
+	m_unusedBlockNodes.push_back(block);
+}
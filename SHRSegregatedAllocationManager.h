@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "SHRHeapProvider.h"
+
+//both counts can be overridden at build time, e.g. by Tools/SHRAllocationReplay to compare layer layouts
+#ifndef SHR_SEGREGATED_FL_INDEX_COUNT
+#define SHR_SEGREGATED_FL_INDEX_COUNT 32
+#endif
+#ifndef SHR_SEGREGATED_SL_INDEX_COUNT_LOG2
+#define SHR_SEGREGATED_SL_INDEX_COUNT_LOG2 4
+#endif
+#define SHR_SEGREGATED_SL_INDEX_COUNT (1 << SHR_SEGREGATED_SL_INDEX_COUNT_LOG2)
+
+class SHRResource;
+
+//two level segregated fit over a growing set of heaps, sizes are counted in blockSize units
+class SHRSegregatedAllocationManager
+{
+public:
+	struct Block
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t heapIndex;
+		int32_t prevPhysical;
+		int32_t nextPhysical;
+		int32_t prevFree;
+		int32_t nextFree;
+		uint32_t free;
+		SHRResource* pResource;
+	};
+
+public:
+	SHRSegregatedAllocationManager() = default;
+	SHRSegregatedAllocationManager(SHRHeapProvider* pProvider, uint64_t blockSize, uint64_t heapGrowSize, uint64_t alignment);
+	~SHRSegregatedAllocationManager() = default;
+
+	void Initialize(SHRHeapProvider* pProvider, uint64_t blockSize, uint64_t heapGrowSize, uint64_t alignment);
+
+	std::pair<int32_t, uint32_t> CanAllocate(uint64_t size);					//return {heap, block}
+	void AllocateBlock(uint32_t block, uint64_t size, SHRResource* pResource);
+	void DeallocateBlock(uint32_t block);
+
+	uint64_t GetBlockOffset(uint32_t block) const { return m_blocks[block].offset; }
+
+	uint64_t GetFreeSize() const;
+	uint64_t GetLargestFreeBlock() const;
+
+	//heaps left entirely free for idleFrameLimit calls in a row are released, call once per frame
+	void TrimHeaps(uint32_t idleFrameLimit);
+	//releases every entirely free heap right away
+	void ReleaseEmptyHeaps();
+
+private:
+	uint32_t CreateHeap(uint64_t minSize);		//return the free block spanning the new heap
+	bool IsHeapEmpty(uint32_t heap) const;
+	void ReleaseHeap(uint32_t heap);
+
+	void MappingInsert(uint64_t units, uint32_t& fl, uint32_t& sl);
+	void MappingSearch(uint64_t units, uint32_t& fl, uint32_t& sl);
+	int32_t FindFreeBlock(uint64_t size);
+	void InsertFreeBlock(uint32_t block);
+	void RemoveFreeBlock(uint32_t block);
+	void MergeBlocks(uint32_t left, uint32_t right);
+
+	uint32_t CreateBlockNode();
+	void ReleaseBlockNode(uint32_t block);
+
+public:
+	std::vector<Block> m_blocks;
+	std::vector<uint32_t> m_unusedBlockNodes;
+	std::vector<uint32_t> m_heapIndices;
+	//parallel to m_heapIndices, the block at offset 0 keeps its node for the lifetime of the heap
+	std::vector<uint32_t> m_heapFirstBlocks;
+	std::vector<uint32_t> m_heapIdleFrames;
+
+	uint32_t m_flBitmap = 0;
+	uint32_t m_slBitmaps[SHR_SEGREGATED_FL_INDEX_COUNT] = {};
+	int32_t m_freeHeads[SHR_SEGREGATED_FL_INDEX_COUNT][SHR_SEGREGATED_SL_INDEX_COUNT] = {};
+
+	uint64_t m_blockSize = 0;
+	uint64_t m_heapGrowSize = 0;
+	uint64_t m_alignment = 0;
+
+private:
+	SHRHeapProvider* m_pProvider = nullptr;
+};
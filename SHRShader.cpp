@@ -1,75 +1,29 @@
 #include "SHRShader.h"
 #include <d3d12shader.h>
 
-std::unordered_map<std::wstring, SHRShader> g_globalShaderMap;
+SHRShaderCache g_shaderCache;
+SHRShaderCompiler g_shaderCompiler;
 
-Microsoft::WRL::ComPtr<IDxcResult> CompileShaderWithDXC(const std::wstring& shaderSourcePath, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring> defines = {})
+SHRShader::SHRShader(const std::wstring& name, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring> defines)
 {
-	Microsoft::WRL::ComPtr<IDxcUtils> pUtils;
-	Microsoft::WRL::ComPtr<IDxcCompiler3> pCompiler;
-	Microsoft::WRL::ComPtr<IDxcIncludeHandler> pIncludeHandler;
-
-	ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&pUtils)));
-	ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&pCompiler)));
-	ThrowIfFailed(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
-
-	Microsoft::WRL::ComPtr<IDxcBlobEncoding> pSourceCode = nullptr;
-	ThrowIfFailed(pUtils->LoadFile(shaderSourcePath.c_str(), nullptr, &pSourceCode));
-	DxcBuffer sourceCode;
-	sourceCode.Encoding = DXC_CP_ACP;
-	sourceCode.Ptr = pSourceCode->GetBufferPointer();
-	sourceCode.Size = pSourceCode->GetBufferSize();
-
-	std::vector<LPCWSTR> arguments =
-	{
-		shaderSourcePath.c_str(),
-		L"-E", entryPoint.c_str(),
-		L"-T", target.c_str(),
-		L"-Qstrip_debug",
-		L"-Qstrip_reflect",
-	};
-
-	for (auto& flag : compileFlags)
-	{
-		arguments.push_back(flag.c_str());
-	}
+	using namespace Microsoft::WRL;
 
-	std::vector<std::wstring> defineStorage;
-	for (auto& define : defines)
-	{
-		std::wstring defineArg = define.first;
-		if (!define.second.empty())
-		{
-			defineArg += L"=" + define.second;
-		}
+	IDxcUtils* pUtils = g_shaderCompiler.GetThreadContext().pUtils.Get();
 
-		defineStorage.push_back(defineArg);
-		arguments.push_back(L"-D");
-		arguments.push_back(defineStorage.back().c_str());
-	}
+	//hashed from the same blobs the compile below is handed, the source hash is shared by every permutation of the file
+	std::shared_ptr<const SHRShaderSourceSnapshot> pSource = g_shaderCompiler.GetSourceSnapshot(GetSourcePath(name));
 
-	Microsoft::WRL::ComPtr<IDxcResult> pResult;
-	ThrowIfFailed(pCompiler->Compile(&sourceCode, arguments.data(), arguments.size(), pIncludeHandler.Get(), IID_PPV_ARGS(&pResult)));
+	//a warm start takes bytecode & reflection from disk and never runs the compiler
+	uint64_t cacheKey = SHRComputeShaderCacheKey(pSource->hash, entryPoint, target, compileFlags, defines);
+	bool cacheable = g_shaderCache.m_enabled;
+	if (cacheable && LoadFromCache(pUtils, cacheKey)) return;
 
-	Microsoft::WRL::ComPtr<IDxcBlobUtf8> pErrors;
-	pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr);
-	if (pErrors && pErrors->GetStringLength() != 0)
-	{
-		OutputDebugStringA(pErrors->GetStringPointer());
-	}
+	ComPtr<IDxcResult> pResult = g_shaderCompiler.Compile(*pSource, entryPoint, target, compileFlags, defines);
 
-	return pResult;
-}
-
-SHRShader::SHRShader(const std::wstring& name, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring> defines)
-{
-	using namespace Microsoft::WRL;
-
-	ComPtr<IDxcUtils> pUtils;
-	ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&pUtils)));
-
-	std::wstring path = L"./Shaders/" + name + L".hlsl";
-	ComPtr<IDxcResult> pResult = CompileShaderWithDXC(path, entryPoint, target, compileFlags, defines);
+	//errors went to the debug output already
+	HRESULT status = S_OK;
+	ThrowIfFailed(pResult->GetStatus(&status));
+	ThrowIfFailed(status);
 
 	ThrowIfFailed(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&m_shaderBlob), nullptr));
 
@@ -184,4 +138,62 @@ SHRShader::SHRShader(const std::wstring& name, const std::wstring& entryPoint, c
 		m_vsInputElements.push_back(element);
 	}
 
+	if (cacheable) StoreToCache(cacheKey);
+}
+
+bool SHRShader::LoadFromCache(IDxcUtils* pUtils, uint64_t key)
+{
+	SHRShaderCacheEntry entry;
+	if (!g_shaderCache.Load(key, entry)) return false;
+
+	Microsoft::WRL::ComPtr<IDxcBlobEncoding> pBlob;
+	ThrowIfFailed(pUtils->CreateBlob(entry.bytecode.data(), static_cast<UINT32>(entry.bytecode.size()), DXC_CP_ACP, &pBlob));
+	m_shaderBlob = pBlob;
+
+	memcpy(shaderHash, entry.shaderHash, sizeof(shaderHash));
+
+	for (auto& resource : entry.resources)
+	{
+		ShaderResourceReflection reflection;
+		reflection.resourceName = resource.name;
+		reflection.type = static_cast<SHRResourceViewType>(resource.type);
+		reflection.bindPoint = resource.bindPoint;
+		reflection.bindCount = resource.bindCount;
+		reflection.space = resource.space;
+		m_shaderResourceReflections.push_back(reflection);
+	}
+
+	for (auto& inputElement : entry.inputElements)
+	{
+		VSInputElement element;
+		element.semanticName = inputElement.semanticName;
+		element.semanticIndex = inputElement.semanticIndex;
+		element.Format = static_cast<DXGI_FORMAT>(inputElement.format);
+		m_vsInputElements.push_back(element);
+	}
+
+	return true;
+}
+
+void SHRShader::StoreToCache(uint64_t key)
+{
+	SHRShaderCacheEntry entry;
+
+	const uint8_t* pBytecode = static_cast<const uint8_t*>(m_shaderBlob->GetBufferPointer());
+	entry.bytecode.assign(pBytecode, pBytecode + m_shaderBlob->GetBufferSize());
+
+	memcpy(entry.shaderHash, shaderHash, sizeof(shaderHash));
+
+	for (auto& reflection : m_shaderResourceReflections)
+	{
+		entry.resources.push_back({ reflection.resourceName, static_cast<uint32_t>(reflection.type), reflection.bindPoint, reflection.bindCount, reflection.space });
+	}
+
+	for (auto& element : m_vsInputElements)
+	{
+		entry.inputElements.push_back({ element.semanticName, element.semanticIndex, static_cast<uint32_t>(element.Format) });
+	}
+
+	//a failed write only costs the next start a compile
+	g_shaderCache.Store(key, entry);
 }
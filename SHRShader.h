@@ -12,6 +12,8 @@
 #include "dxc/dxcapi.h"
 #include "SHRUtils.h"
 #include "SHRResourceView.h"
+#include "SHRShaderCache.h"
+#include "SHRShaderCompiler.h"
 
 enum class SHRShaderType : uint8_t
 {
@@ -49,13 +51,19 @@ public:
 public:
 	SHRShader(const std::wstring& name, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::wstring>& compileFlags = {}, const std::unordered_map<std::wstring, std::wstring> defines = {});
 
+	static std::wstring GetSourcePath(const std::wstring& name) { return L"./Shaders/" + name + L".hlsl"; }
+
+private:
+	bool LoadFromCache(IDxcUtils* pUtils, uint64_t key);
+	void StoreToCache(uint64_t key);
+
 public:
 	Microsoft::WRL::ComPtr<IDxcBlob> m_shaderBlob;
 
 	std::vector<ShaderResourceReflection> m_shaderResourceReflections;
 	std::vector<VSInputElement> m_vsInputElements;
 
-	BYTE shaderHash[16];
+	BYTE shaderHash[16] = {};
 };
 
 class SHRShaderResoureLayout
@@ -99,5 +107,6 @@ public:
 	std::vector<SHRShader::ShaderResourceReflection>* m_pShaderResourceReflections;
 };
 
-extern std::unordered_map<std::wstring, SHRShader> g_globalShaderMap;
+extern SHRShaderCache g_shaderCache;
+extern SHRShaderCompiler g_shaderCompiler;
 
@@ -0,0 +1,293 @@
+#include "SHRShaderCache.h"
+#include "SHRHash.h"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cwchar>
+#include <thread>
+
+#define SHR_SHADER_CACHE_MAX_NAME_LENGTH 1024
+
+struct SHRShaderCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t bytecodeSize;
+	uint32_t resourceCount;
+	uint32_t inputElementCount;
+};
+
+static bool ReadFileText(const std::filesystem::path& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+	return true;
+}
+
+//name of an #include directive on this line, empty when there is none
+static std::string GetIncludeName(const std::string& line)
+{
+	size_t pos = line.find_first_not_of(" \t");
+	if (pos == std::string::npos || line[pos] != '#') return {};
+
+	pos = line.find_first_not_of(" \t", pos + 1);
+	if (pos == std::string::npos || line.compare(pos, 7, "include") != 0) return {};
+
+	size_t begin = line.find_first_of("\"<", pos + 7);
+	if (begin == std::string::npos) return {};
+
+	size_t end = line.find(line[begin] == '"' ? '"' : '>', begin + 1);
+	if (end == std::string::npos) return {};
+
+	return line.substr(begin + 1, end - begin - 1);
+}
+
+static bool IsVisited(const std::vector<std::filesystem::path>& includes, const std::filesystem::path& path)
+{
+	for (auto& include : includes)
+	{
+		if (include == path) return true;
+	}
+	return false;
+}
+
+static void ResolveIncludes(const std::filesystem::path& filePath, const std::string& text, const std::filesystem::path& rootDirectory, const SHRShaderSourceReader& readSource, std::vector<std::filesystem::path>& includes)
+{
+	std::istringstream stream(text);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		std::string name = GetIncludeName(line);
+		if (name.empty()) continue;
+
+		//a file is found when readSource can read it, so a reader that is not backed by the disk resolves the same way.
+		//a header guarded by #pragma once is only read once, so are the ones visited here
+		std::filesystem::path includePath;
+		std::string includeText;
+		bool visited = false;
+		for (const std::filesystem::path& candidate : { filePath.parent_path() / name, rootDirectory / name })
+		{
+			std::error_code ec;
+			std::filesystem::path candidatePath = std::filesystem::weakly_canonical(candidate, ec);
+			if (ec) candidatePath = candidate.lexically_normal();
+
+			visited = IsVisited(includes, candidatePath);
+			if (visited) break;
+			if (readSource(candidatePath, includeText))
+			{
+				includePath = candidatePath;
+				break;
+			}
+		}
+		if (visited || includePath.empty()) continue;
+
+		includes.push_back(includePath);
+		ResolveIncludes(includePath, includeText, rootDirectory, readSource, includes);
+	}
+}
+
+void SHRResolveShaderIncludes(const std::filesystem::path& sourcePath, std::vector<std::filesystem::path>& includes, const SHRShaderSourceReader& readSource)
+{
+	includes.clear();
+
+	SHRShaderSourceReader reader = readSource ? readSource : SHRShaderSourceReader(ReadFileText);
+	std::string text;
+	if (!reader(sourcePath, text)) return;
+
+	ResolveIncludes(sourcePath, text, sourcePath.parent_path(), reader, includes);
+}
+
+//length first, so "ab" + "c" and "a" + "bc" do not collide
+static uint64_t HashString(const std::wstring& text, uint64_t hash)
+{
+	uint64_t length = text.size();
+	hash = SHRHashBytes(&length, sizeof(length), hash);
+	return SHRHashBytes(text.data(), text.size() * sizeof(wchar_t), hash);
+}
+
+static uint64_t HashString(const std::string& text, uint64_t hash)
+{
+	uint64_t length = text.size();
+	hash = SHRHashBytes(&length, sizeof(length), hash);
+	return SHRHashBytes(text.data(), text.size(), hash);
+}
+
+bool SHRHashShaderSources(const std::filesystem::path& sourcePath, const SHRShaderSourceReader& readSource, uint64_t& hash)
+{
+	std::string source;
+	if (!readSource(sourcePath, source)) return false;
+
+	uint32_t version = SHR_SHADER_CACHE_VERSION;
+	hash = SHRHashBytes(&version, sizeof(version));
+	hash = HashString(source, hash);
+
+	std::vector<std::filesystem::path> includes;
+	SHRResolveShaderIncludes(sourcePath, includes, readSource);
+	for (auto& include : includes)
+	{
+		std::string text;
+		readSource(include, text);
+		hash = HashString(include.filename().wstring(), hash);
+		hash = HashString(text, hash);
+	}
+
+	return true;
+}
+
+uint64_t SHRComputeShaderCacheKey(uint64_t sourceHash, const std::wstring& entryPoint, const std::wstring& target,
+	const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring>& defines)
+{
+	uint64_t hash = HashString(entryPoint, sourceHash);
+	hash = HashString(target, hash);
+	for (auto& flag : compileFlags)
+	{
+		hash = HashString(flag, hash);
+	}
+
+	//the iteration order of an unordered_map is not stable across runs
+	std::map<std::wstring, std::wstring> sortedDefines(defines.begin(), defines.end());
+	for (auto& define : sortedDefines)
+	{
+		hash = HashString(define.first, hash);
+		hash = HashString(define.second, hash);
+	}
+
+	return hash;
+}
+
+SHRShaderCache::SHRShaderCache(const std::filesystem::path& directory) : m_directory(directory)
+{
+}
+
+std::filesystem::path SHRShaderCache::GetEntryPath(uint64_t key) const
+{
+	wchar_t name[17];
+	swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(key));
+	return m_directory / (std::wstring(name) + SHR_SHADER_CACHE_EXTENSION);
+}
+
+template<typename T>
+static bool ReadValue(std::ifstream& file, T& value)
+{
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static bool ReadString(std::ifstream& file, std::string& text)
+{
+	uint32_t length = 0;
+	if (!ReadValue(file, length) || length > SHR_SHADER_CACHE_MAX_NAME_LENGTH) return false;
+
+	text.resize(length);
+	return length == 0 || static_cast<bool>(file.read(&text[0], length));
+}
+
+template<typename T>
+static void WriteValue(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void WriteString(std::ofstream& file, const std::string& text)
+{
+	WriteValue(file, static_cast<uint32_t>(text.size()));
+	file.write(text.data(), text.size());
+}
+
+bool SHRShaderCache::Load(uint64_t key, SHRShaderCacheEntry& entry)
+{
+	if (!m_enabled) return false;
+
+	std::filesystem::path path = GetEntryPath(key);
+	std::error_code ec;
+	uint64_t fileSize = std::filesystem::file_size(path, ec);
+
+	std::ifstream file(path, std::ios::binary);
+	SHRShaderCacheHeader header = {};
+	if (ec || !file.is_open() || !ReadValue(file, header) || header.magic != SHR_SHADER_CACHE_MAGIC || header.version != SHR_SHADER_CACHE_VERSION || header.key != key
+		|| header.bytecodeSize > fileSize || header.resourceCount > fileSize || header.inputElementCount > fileSize)	//a corrupt count must not size the vectors
+	{
+		m_missCount++;
+		return false;
+	}
+
+	bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(entry.shaderHash), sizeof(entry.shaderHash)));
+
+	entry.bytecode.resize(valid ? header.bytecodeSize : 0);
+	if (valid && header.bytecodeSize) valid = static_cast<bool>(file.read(reinterpret_cast<char*>(entry.bytecode.data()), header.bytecodeSize));
+
+	entry.resources.resize(valid ? header.resourceCount : 0);
+	for (size_t i = 0; valid && i < entry.resources.size(); i++)
+	{
+		SHRShaderCacheResource& resource = entry.resources[i];
+		valid = ReadString(file, resource.name) && ReadValue(file, resource.type) && ReadValue(file, resource.bindPoint)
+			&& ReadValue(file, resource.bindCount) && ReadValue(file, resource.space);
+	}
+
+	entry.inputElements.resize(valid ? header.inputElementCount : 0);
+	for (size_t i = 0; valid && i < entry.inputElements.size(); i++)
+	{
+		SHRShaderCacheInputElement& element = entry.inputElements[i];
+		valid = ReadString(file, element.semanticName) && ReadValue(file, element.semanticIndex) && ReadValue(file, element.format);
+	}
+
+	valid ? m_hitCount++ : m_missCount++;
+	return valid;
+}
+
+bool SHRShaderCache::Store(uint64_t key, const SHRShaderCacheEntry& entry)
+{
+	if (!m_enabled) return false;
+
+	std::error_code ec;
+	std::filesystem::create_directories(m_directory, ec);
+
+	std::filesystem::path path = GetEntryPath(key);
+	//two threads compiling the same permutation each write their own file, the last rename wins
+	wchar_t suffix[32];
+	swprintf(suffix, 32, L".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::filesystem::path tempPath = path;
+	tempPath += suffix;
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		SHRShaderCacheHeader header = { SHR_SHADER_CACHE_MAGIC, SHR_SHADER_CACHE_VERSION, key, entry.bytecode.size(),
+			static_cast<uint32_t>(entry.resources.size()), static_cast<uint32_t>(entry.inputElements.size()) };
+		WriteValue(file, header);
+		file.write(reinterpret_cast<const char*>(entry.shaderHash), sizeof(entry.shaderHash));
+		file.write(reinterpret_cast<const char*>(entry.bytecode.data()), entry.bytecode.size());
+
+		for (auto& resource : entry.resources)
+		{
+			WriteString(file, resource.name);
+			WriteValue(file, resource.type);
+			WriteValue(file, resource.bindPoint);
+			WriteValue(file, resource.bindCount);
+			WriteValue(file, resource.space);
+		}
+
+		for (auto& element : entry.inputElements)
+		{
+			WriteString(file, element.semanticName);
+			WriteValue(file, element.semanticIndex);
+			WriteValue(file, element.format);
+		}
+
+		if (!file) return false;
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
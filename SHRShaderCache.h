@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <functional>
+#include <atomic>
+
+#define SHR_SHADER_CACHE_MAGIC 0x43524853		//"SHRC"
+#define SHR_SHADER_CACHE_VERSION 1				//bump when the entry layout or the compile arguments change
+#define SHR_SHADER_CACHE_DEFAULT_DIRECTORY L"./ShaderCache/"
+#define SHR_SHADER_CACHE_EXTENSION L".shrc"
+
+//reflection as it is written to disk, the types are the raw SHRResourceViewType & DXGI_FORMAT values
+struct SHRShaderCacheResource
+{
+	std::string name;
+	uint32_t type;
+	uint32_t bindPoint;
+	uint32_t bindCount;
+	uint32_t space;
+};
+
+struct SHRShaderCacheInputElement
+{
+	std::string semanticName;
+	uint32_t semanticIndex;
+	uint32_t format;
+};
+
+struct SHRShaderCacheEntry
+{
+	std::vector<uint8_t> bytecode;
+	uint8_t shaderHash[16];
+	std::vector<SHRShaderCacheResource> resources;
+	std::vector<SHRShaderCacheInputElement> inputElements;
+};
+
+//text of one shader file, false when it can not be read
+typedef std::function<bool(const std::filesystem::path& path, std::string& text)> SHRShaderSourceReader;
+
+//every file pulled in by #include, depth first in the order the compiler sees them. quoted & angled includes are looked up
+//next to the including file first, then next to sourcePath. includes that can not be found are skipped, the compiler reports them.
+//files are read from disk unless readSource is given, a file is found when readSource can read it
+void SHRResolveShaderIncludes(const std::filesystem::path& sourcePath, std::vector<std::filesystem::path>& includes, const SHRShaderSourceReader& readSource = nullptr);
+
+//hash of the source & include text, read through readSource so it is the same text the compiler is handed.
+//returns false when the source can not be read
+bool SHRHashShaderSources(const std::filesystem::path& sourcePath, const SHRShaderSourceReader& readSource, uint64_t& hash);
+
+//hash of everything that changes the bytecode: sourceHash from SHRHashShaderSources, entry point, target, flags and defines
+uint64_t SHRComputeShaderCacheKey(uint64_t sourceHash, const std::wstring& entryPoint, const std::wstring& target,
+	const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring>& defines);
+
+//content addressed bytecode store, one file per key. no compiler involved so it runs anywhere.
+//Load & Store may be called from several compile threads at once
+class SHRShaderCache
+{
+public:
+	SHRShaderCache(const std::filesystem::path& directory = SHR_SHADER_CACHE_DEFAULT_DIRECTORY);
+	~SHRShaderCache() = default;
+
+	//false on a miss or a file that is truncated, of another version or of another key
+	bool Load(uint64_t key, SHRShaderCacheEntry& entry);
+	//written to a temporary file first, a reader never sees half an entry
+	bool Store(uint64_t key, const SHRShaderCacheEntry& entry);
+
+	std::filesystem::path GetEntryPath(uint64_t key) const;
+
+public:
+	std::filesystem::path m_directory;
+	bool m_enabled = true;
+
+	std::atomic<uint64_t> m_hitCount = 0;
+	std::atomic<uint64_t> m_missCount = 0;
+};
@@ -0,0 +1,116 @@
+#include "SHRShaderCompileQueue.h"
+
+SHRShaderBatch::SHRShaderBatch(uint32_t totalCount, ProgressCallback callback) : m_totalCount(totalCount), m_callback(callback)
+{
+	m_future = m_promise.get_future().share();
+	if (m_totalCount == 0) m_promise.set_value(true);
+}
+
+std::vector<SHRShaderBatch::Failure> SHRShaderBatch::GetFailures() const
+{
+	std::lock_guard<std::mutex> lock(m_failureMutex);
+	return m_failures;
+}
+
+void SHRShaderBatch::OnFinished(uint64_t key, HRESULT error)
+{
+	if (FAILED(error))
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_failureMutex);
+			m_failures.push_back({ key, error });
+		}
+		m_failedCount++;
+	}
+	else
+	{
+		m_completedCount++;
+	}
+
+	//only the last permutation to finish sees the full count
+	bool isLast = ++m_finishedCount == m_totalCount;
+
+	if (m_callback) m_callback(*this);
+	if (isLast) m_promise.set_value(m_failedCount == 0);
+}
+
+SHRShaderCompileQueue::SHRShaderCompileQueue(uint32_t workerCount)
+{
+	if (workerCount == 0) workerCount = std::thread::hardware_concurrency();
+	if (workerCount == 0) workerCount = 1;	//hardware_concurrency may not know
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&SHRShaderCompileQueue::WorkerLoop, this);
+	}
+}
+
+SHRShaderCompileQueue::~SHRShaderCompileQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+std::shared_ptr<SHRShaderBatch> SHRShaderCompileQueue::Submit(const std::vector<SHRShaderPermutationDesc>& permutations, SHRShaderRegistry& registry,
+	SHRShaderBatch::ProgressCallback callback)
+{
+	std::shared_ptr<SHRShaderBatch> pBatch = std::make_shared<SHRShaderBatch>(static_cast<uint32_t>(permutations.size()), callback);
+
+	for (auto& permutation : permutations)
+	{
+		Push([pBatch, permutation, &registry]()
+		{
+			HRESULT error = S_OK;
+			try
+			{
+				std::shared_ptr<SHRShader> pShader = std::make_shared<SHRShader>(permutation.name, permutation.entryPoint, permutation.target, permutation.compileFlags, permutation.defines);
+				registry.Publish(permutation, pShader);
+			}
+			catch (const COMException& exception)
+			{
+				error = exception.Error();
+			}
+			catch (...)
+			{
+				error = E_FAIL;
+			}
+			pBatch->OnFinished(permutation.key, error);
+		});
+	}
+
+	return pBatch;
+}
+
+void SHRShaderCompileQueue::Push(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_condition.notify_one();
+}
+
+void SHRShaderCompileQueue::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_jobs.empty()) return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+		job();
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <atomic>
+
+#include "SHRShaderRegistry.h"
+
+//permutations submitted together, counters are updated by the workers as each one finishes
+class SHRShaderBatch
+{
+public:
+	struct Failure
+	{
+		uint64_t key;
+		HRESULT error;
+	};
+
+	//called on the worker that finished a permutation, keep it short
+	typedef std::function<void(const SHRShaderBatch& batch)> ProgressCallback;
+
+public:
+	SHRShaderBatch(uint32_t totalCount, ProgressCallback callback);
+
+	uint32_t GetFinishedCount() const { return m_finishedCount; }
+	float GetProgress() const { return m_totalCount ? float(GetFinishedCount()) / float(m_totalCount) : 1.0f; }
+
+	//blocks until every permutation is finished, true when none failed
+	bool Wait() const { return m_future.get(); }
+	std::vector<Failure> GetFailures() const;
+
+	void OnFinished(uint64_t key, HRESULT error);
+
+public:
+	const uint32_t m_totalCount;
+	std::atomic<uint32_t> m_completedCount = 0;
+	std::atomic<uint32_t> m_failedCount = 0;
+
+	std::shared_future<bool> m_future;
+
+private:
+	ProgressCallback m_callback;
+	std::promise<bool> m_promise;
+	std::atomic<uint32_t> m_finishedCount = 0;
+
+	mutable std::mutex m_failureMutex;
+	std::vector<Failure> m_failures;
+};
+
+//worker pool compiling shader permutations, each worker keeps its own DXC instances in g_shaderCompiler
+class SHRShaderCompileQueue
+{
+public:
+	SHRShaderCompileQueue(uint32_t workerCount = 0);	//0 takes one worker per hardware thread
+	~SHRShaderCompileQueue();							//finishes the queued jobs before the workers exit
+
+	//every permutation becomes one job, the shader is published in registry once compiled
+	std::shared_ptr<SHRShaderBatch> Submit(const std::vector<SHRShaderPermutationDesc>& permutations, SHRShaderRegistry& registry,
+		SHRShaderBatch::ProgressCallback callback = nullptr);
+
+	void Push(std::function<void()> job);
+
+private:
+	void WorkerLoop();
+
+public:
+	std::vector<std::thread> m_workers;
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::function<void()>> m_jobs;
+	bool m_stopping = false;
+};
@@ -0,0 +1,197 @@
+#include "SHRShaderCompiler.h"
+#include "SHRShaderCache.h"
+
+#include <filesystem>
+
+HRESULT STDMETHODCALLTYPE SHRShaderIncludeHandler::LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource)
+{
+	if (!pFilename || !ppIncludeSource) return E_POINTER;
+	*ppIncludeSource = nullptr;
+
+	//the text the cache key was hashed from
+	if (m_pSnapshot)
+	{
+		auto it = m_pSnapshot->includes.find(SHRShaderCompiler::GetSourceKey(pFilename));
+		if (it != m_pSnapshot->includes.end())
+		{
+			*ppIncludeSource = it->second.Get();
+			(*ppIncludeSource)->AddRef();
+			return S_OK;
+		}
+	}
+
+	Microsoft::WRL::ComPtr<IDxcBlobEncoding> pSource;
+	HRESULT hr = m_pCompiler->LoadSource(pFilename, &pSource);
+	if (FAILED(hr)) return hr;
+
+	*ppIncludeSource = pSource.Detach();
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SHRShaderIncludeHandler::QueryInterface(REFIID riid, void** ppvObject)
+{
+	if (!ppvObject) return E_POINTER;
+
+	if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+	{
+		*ppvObject = static_cast<IDxcIncludeHandler*>(this);
+		AddRef();
+		return S_OK;
+	}
+
+	*ppvObject = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SHRShaderIncludeHandler::AddRef()
+{
+	return ++m_refCount;
+}
+
+ULONG STDMETHODCALLTYPE SHRShaderIncludeHandler::Release()
+{
+	ULONG refCount = --m_refCount;
+	if (refCount == 0) delete this;
+	return refCount;
+}
+
+SHRShaderCompiler::ThreadContext& SHRShaderCompiler::GetThreadContext()
+{
+	std::lock_guard<std::mutex> lock(m_threadContextMutex);
+
+	std::unique_ptr<ThreadContext>& pContext = m_threadContexts[std::this_thread::get_id()];
+	if (!pContext)
+	{
+		pContext = std::make_unique<ThreadContext>();
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&pContext->pUtils)));
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&pContext->pCompiler)));
+		pContext->pIncludeHandler.Attach(new SHRShaderIncludeHandler(this));
+	}
+	return *pContext;
+}
+
+std::wstring SHRShaderCompiler::GetSourceKey(const std::wstring& path)
+{
+	std::error_code ec;
+	std::filesystem::path key = std::filesystem::weakly_canonical(path, ec);
+	return ec ? std::filesystem::path(path).lexically_normal().wstring() : key.wstring();
+}
+
+HRESULT SHRShaderCompiler::LoadSource(const std::wstring& path, IDxcBlobEncoding** ppSource)
+{
+	std::wstring key = GetSourceKey(path);
+
+	{
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
+		auto it = m_sources.find(key);
+		if (it != m_sources.end()) return it->second.CopyTo(ppSource);
+	}
+
+	//read outside the lock, two threads racing on one file both read it and the first one in wins
+	Microsoft::WRL::ComPtr<IDxcBlobEncoding> pSource;
+	HRESULT hr = GetThreadContext().pUtils->LoadFile(path.c_str(), nullptr, &pSource);
+	if (FAILED(hr)) return hr;
+
+	std::lock_guard<std::mutex> lock(m_sourceMutex);
+	return m_sources.emplace(key, pSource).first->second.CopyTo(ppSource);
+}
+
+std::shared_ptr<const SHRShaderSourceSnapshot> SHRShaderCompiler::GetSourceSnapshot(const std::wstring& path)
+{
+	std::wstring key = GetSourceKey(path);
+	uint64_t generation = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_sourceMutex);
+		auto it = m_snapshots.find(key);
+		if (it != m_snapshots.end()) return it->second;
+		generation = m_sourceGeneration;
+	}
+
+	std::shared_ptr<SHRShaderSourceSnapshot> pSnapshot = std::make_shared<SHRShaderSourceSnapshot>();
+	pSnapshot->path = path;
+	ThrowIfFailed(LoadSource(path, &pSnapshot->pSource));
+
+	//the includes are resolved & hashed from the blobs the compile is handed, not from the files on disk
+	SHRShaderSourceReader readSource = [&](const std::filesystem::path& filePath, std::string& text)
+	{
+		Microsoft::WRL::ComPtr<IDxcBlobEncoding> pBlob;
+		std::wstring fileKey = GetSourceKey(filePath.wstring());
+		if (fileKey == key) pBlob = pSnapshot->pSource;
+		else
+		{
+			if (FAILED(LoadSource(filePath.wstring(), &pBlob))) return false;
+			pSnapshot->includes.emplace(fileKey, pBlob);
+		}
+
+		text.assign(static_cast<const char*>(pBlob->GetBufferPointer()), pBlob->GetBufferSize());
+		return true;
+	};
+	SHRHashShaderSources(path, readSource, pSnapshot->hash);
+
+	std::lock_guard<std::mutex> lock(m_sourceMutex);
+	if (generation != m_sourceGeneration) return pSnapshot;
+	return m_snapshots.emplace(key, pSnapshot).first->second;
+}
+
+void SHRShaderCompiler::ClearSources()
+{
+	std::lock_guard<std::mutex> lock(m_sourceMutex);
+	m_sources.clear();
+	m_snapshots.clear();
+	m_sourceGeneration++;
+}
+
+Microsoft::WRL::ComPtr<IDxcResult> SHRShaderCompiler::Compile(const SHRShaderSourceSnapshot& source, const std::wstring& entryPoint, const std::wstring& target,
+	const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring>& defines)
+{
+	ThreadContext& context = GetThreadContext();
+
+	DxcBuffer sourceCode;
+	sourceCode.Encoding = DXC_CP_ACP;
+	sourceCode.Ptr = source.pSource->GetBufferPointer();
+	sourceCode.Size = source.pSource->GetBufferSize();
+
+	std::vector<LPCWSTR> arguments =
+	{
+		source.path.c_str(),
+		L"-E", entryPoint.c_str(),
+		L"-T", target.c_str(),
+		L"-Qstrip_debug",
+		L"-Qstrip_reflect",
+	};
+
+	for (auto& flag : compileFlags)
+	{
+		arguments.push_back(flag.c_str());
+	}
+
+	std::vector<std::wstring> defineStorage;
+	defineStorage.reserve(defines.size());	//arguments point into the strings, they must not move
+	for (auto& define : defines)
+	{
+		std::wstring defineArg = define.first;
+		if (!define.second.empty())
+		{
+			defineArg += L"=" + define.second;
+		}
+
+		defineStorage.push_back(defineArg);
+		arguments.push_back(L"-D");
+		arguments.push_back(defineStorage.back().c_str());
+	}
+
+	Microsoft::WRL::ComPtr<IDxcResult> pResult;
+	context.pIncludeHandler->m_pSnapshot = &source;
+	HRESULT hr = context.pCompiler->Compile(&sourceCode, arguments.data(), static_cast<UINT32>(arguments.size()), context.pIncludeHandler.Get(), IID_PPV_ARGS(&pResult));
+	context.pIncludeHandler->m_pSnapshot = nullptr;
+	ThrowIfFailed(hr);
+
+	Microsoft::WRL::ComPtr<IDxcBlobUtf8> pErrors;
+	pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr);
+	if (pErrors && pErrors->GetStringLength() != 0)
+	{
+		OutputDebugStringA(pErrors->GetStringPointer());
+	}
+
+	return pResult;
+}
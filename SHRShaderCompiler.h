@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+
+#include <windows.h>
+#include <wrl.h>
+
+#include "dxc/dxcapi.h"
+#include "SHRUtils.h"
+
+class SHRShaderCompiler;
+struct SHRShaderSourceSnapshot;
+
+//resolves #include through the compiled snapshot, then the compiler's source cache, instead of reading the file again for every permutation
+class SHRShaderIncludeHandler : public IDxcIncludeHandler
+{
+public:
+	SHRShaderIncludeHandler(SHRShaderCompiler* pCompiler) : m_pCompiler(pCompiler) {}
+
+	HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource);
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject);
+	ULONG STDMETHODCALLTYPE AddRef();
+	ULONG STDMETHODCALLTYPE Release();
+
+public:
+	SHRShaderCompiler* m_pCompiler;
+	const SHRShaderSourceSnapshot* m_pSnapshot = nullptr;		//set for the duration of a Compile
+
+private:
+	std::atomic<ULONG> m_refCount = 1;
+};
+
+//a main file & every include it resolves to, read once through the source cache. a compile of the snapshot is only
+//handed these blobs, so a cache key taken from hash always matches the bytecode even when the files change meanwhile
+struct SHRShaderSourceSnapshot
+{
+	std::wstring path;
+	uint64_t hash = 0;
+	Microsoft::WRL::ComPtr<IDxcBlobEncoding> pSource;
+	std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<IDxcBlobEncoding>> includes;		//by SHRShaderCompiler::GetSourceKey
+};
+
+//owns the DXC instances, one set per compiling thread, and the source text every compile shares
+class SHRShaderCompiler
+{
+public:
+	struct ThreadContext
+	{
+		Microsoft::WRL::ComPtr<IDxcUtils> pUtils;
+		Microsoft::WRL::ComPtr<IDxcCompiler3> pCompiler;
+		Microsoft::WRL::ComPtr<SHRShaderIncludeHandler> pIncludeHandler;
+	};
+
+public:
+	SHRShaderCompiler() = default;
+	~SHRShaderCompiler() = default;
+
+	//instances of the calling thread, created on its first use. DXC objects are not shared between threads
+	ThreadContext& GetThreadContext();
+
+	//"./Shaders/a.hlsl", "Shaders\\a.hlsl" & the absolute path are the same file
+	static std::wstring GetSourceKey(const std::wstring& path);
+
+	//each file is read once, later loads of the same path hand out the same blob
+	HRESULT LoadSource(const std::wstring& path, IDxcBlobEncoding** ppSource);
+	//shared by every permutation of the file until the next ClearSources
+	std::shared_ptr<const SHRShaderSourceSnapshot> GetSourceSnapshot(const std::wstring& path);
+	//the next compiles read their files again, e.g. after a shader file was edited
+	void ClearSources();
+
+	Microsoft::WRL::ComPtr<IDxcResult> Compile(const SHRShaderSourceSnapshot& source, const std::wstring& entryPoint, const std::wstring& target,
+		const std::vector<std::wstring>& compileFlags, const std::unordered_map<std::wstring, std::wstring>& defines = {});
+
+public:
+	std::unordered_map<std::thread::id, std::unique_ptr<ThreadContext>> m_threadContexts;
+	std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<IDxcBlobEncoding>> m_sources;
+	std::unordered_map<std::wstring, std::shared_ptr<const SHRShaderSourceSnapshot>> m_snapshots;
+	uint64_t m_sourceGeneration = 0;		//bumped by ClearSources, a snapshot read across it is not kept
+
+private:
+	std::mutex m_threadContextMutex;
+	std::mutex m_sourceMutex;		//guards m_sources, m_snapshots & m_sourceGeneration
+};
@@ -0,0 +1,45 @@
+#include "SHRShaderDependencyGraph.h"
+#include "SHRShaderCache.h"
+
+void SHRCollectShaderDependencies(const std::filesystem::path& sourcePath, std::vector<std::filesystem::path>& files)
+{
+	SHRResolveShaderIncludes(sourcePath, files);
+
+	std::error_code ec;
+	files.insert(files.begin(), std::filesystem::weakly_canonical(sourcePath, ec));
+}
+
+void SHRShaderDependencyGraph::SetDependencies(uint64_t key, const std::vector<std::filesystem::path>& files)
+{
+	RemoveDependencies(key);
+
+	for (auto& file : files)
+	{
+		m_dependents[file].insert(key);
+	}
+	m_dependencies[key] = files;
+}
+
+void SHRShaderDependencyGraph::RemoveDependencies(uint64_t key)
+{
+	auto it = m_dependencies.find(key);
+	if (it == m_dependencies.end()) return;
+
+	for (auto& file : it->second)
+	{
+		auto dependents = m_dependents.find(file);
+		if (dependents == m_dependents.end()) continue;
+
+		dependents->second.erase(key);
+		if (dependents->second.empty()) m_dependents.erase(dependents);
+	}
+	m_dependencies.erase(it);
+}
+
+void SHRShaderDependencyGraph::GetDependents(const std::filesystem::path& file, std::vector<uint64_t>& keys) const
+{
+	auto it = m_dependents.find(file);
+	if (it == m_dependents.end()) return;
+
+	keys.insert(keys.end(), it->second.begin(), it->second.end());
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <filesystem>
+
+//canonical source path followed by every file it includes, directly or not
+void SHRCollectShaderDependencies(const std::filesystem::path& sourcePath, std::vector<std::filesystem::path>& files);
+
+//which permutations read which files. a permutation keeps the whole include closure of its source,
+//so the permutations affected by a change are one lookup away
+class SHRShaderDependencyGraph
+{
+public:
+	//replaces the files key depended on before, includes may have been added or removed since
+	void SetDependencies(uint64_t key, const std::vector<std::filesystem::path>& files);
+	void RemoveDependencies(uint64_t key);
+
+	void GetDependents(const std::filesystem::path& file, std::vector<uint64_t>& keys) const;
+
+public:
+	std::map<std::filesystem::path, std::set<uint64_t>> m_dependents;
+	std::unordered_map<uint64_t, std::vector<std::filesystem::path>> m_dependencies;
+};
@@ -0,0 +1,98 @@
+#include "SHRShaderFileWatcher.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+static std::filesystem::file_time_type GetWriteTime(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+	return ec ? std::filesystem::file_time_type::min() : time;
+}
+
+SHRShaderFileWatcher::SHRShaderFileWatcher(bool useNotifications)
+{
+#if defined(__linux__)
+	if (useNotifications) m_notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	m_lastPollTime = std::chrono::steady_clock::now();
+}
+
+SHRShaderFileWatcher::~SHRShaderFileWatcher()
+{
+#if defined(__linux__)
+	if (m_notifyHandle != -1) close(m_notifyHandle);
+#endif
+}
+
+void SHRShaderFileWatcher::Watch(const std::filesystem::path& path)
+{
+	if (m_files.count(path)) return;
+	m_files[path] = GetWriteTime(path);
+
+#if defined(__linux__)
+	if (m_notifyHandle == -1) return;
+
+	//adding a directory twice hands back the same descriptor
+	std::filesystem::path directory = path.parent_path();
+	int watchHandle = inotify_add_watch(m_notifyHandle, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (watchHandle != -1) m_directories[watchHandle] = directory;
+#endif
+}
+
+void SHRShaderFileWatcher::Poll(std::vector<std::filesystem::path>& changedFiles)
+{
+	changedFiles.clear();
+
+	if (IsUsingNotifications()) PollNotifications(changedFiles);
+	else PollWriteTimes(changedFiles);
+
+	std::sort(changedFiles.begin(), changedFiles.end());
+	changedFiles.erase(std::unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+}
+
+void SHRShaderFileWatcher::PollNotifications(std::vector<std::filesystem::path>& changedFiles)
+{
+#if defined(__linux__)
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t size = read(m_notifyHandle, buffer, sizeof(buffer));
+		if (size <= 0) break;	//EAGAIN once the queue is drained
+
+		for (ssize_t offset = 0; offset < size;)
+		{
+			const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + pEvent->len;
+
+			auto it = m_directories.find(pEvent->wd);
+			if (it == m_directories.end() || pEvent->len == 0) continue;
+
+			//the rest of the directory is not ours
+			std::filesystem::path path = it->second / pEvent->name;
+			if (m_files.count(path)) changedFiles.push_back(path);
+		}
+	}
+#endif
+}
+
+void SHRShaderFileWatcher::PollWriteTimes(std::vector<std::filesystem::path>& changedFiles)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_lastPollTime < std::chrono::milliseconds(SHR_SHADER_WATCH_POLL_INTERVAL_MS)) return;
+	m_lastPollTime = now;
+
+	for (auto& file : m_files)
+	{
+		std::filesystem::file_time_type writeTime = GetWriteTime(file.first);
+		if (writeTime == file.second) continue;
+
+		file.second = writeTime;
+		changedFiles.push_back(file.first);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <filesystem>
+
+#define SHR_SHADER_WATCH_POLL_INTERVAL_MS 250	//how often the polling fallback compares write times
+
+//reports shader files written since the last Poll. uses inotify where there is one and falls back to
+//comparing write times, editors that save by rename are seen either way
+class SHRShaderFileWatcher
+{
+public:
+	SHRShaderFileWatcher(bool useNotifications = true);
+	~SHRShaderFileWatcher();
+
+	//path is a canonical file path, watching it twice is harmless
+	void Watch(const std::filesystem::path& path);
+
+	//never blocks, each changed file is listed once
+	void Poll(std::vector<std::filesystem::path>& changedFiles);
+
+	bool IsUsingNotifications() const { return m_notifyHandle != -1; }
+
+private:
+	void PollNotifications(std::vector<std::filesystem::path>& changedFiles);
+	void PollWriteTimes(std::vector<std::filesystem::path>& changedFiles);
+
+public:
+	//last write time seen by the polling fallback
+	std::map<std::filesystem::path, std::filesystem::file_time_type> m_files;
+
+private:
+	int m_notifyHandle = -1;
+	//inotify watches directories, watch descriptor to directory
+	std::map<int, std::filesystem::path> m_directories;
+
+	std::chrono::steady_clock::time_point m_lastPollTime;
+};
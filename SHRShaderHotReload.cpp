@@ -0,0 +1,210 @@
+#include "SHRShaderHotReload.h"
+#include "SHRRenderContext.h"
+
+SHRShaderHotReload::SHRShaderHotReload(SHRRenderContext& renderContext, SHRShaderCompileQueue& compileQueue, SHRShaderRegistry& registry) :
+	m_renderContext(renderContext),
+	m_compileQueue(compileQueue),
+	m_registry(registry)
+{
+	//callback first, a permutation published in between is only tracked twice
+	m_registry.SetPublishCallback([this](const SHRShaderPermutationDesc& desc) { OnPublished(desc); });
+
+	std::vector<SHRShaderPermutationDesc> descs;
+	m_registry.GetPermutationDescs(descs);
+	for (auto& desc : descs)
+	{
+		OnPublished(desc);
+	}
+}
+
+SHRShaderHotReload::~SHRShaderHotReload()
+{
+	m_registry.SetPublishCallback(nullptr);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_reloadFinished.wait(lock, [this]() { return !m_isReloading || m_pFinishedReload; });
+}
+
+void SHRShaderHotReload::OnPublished(const SHRShaderPermutationDesc& desc)
+{
+	std::vector<std::filesystem::path> files;
+	SHRCollectShaderDependencies(SHRShader::GetSourcePath(desc.name), files);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_publishedDependencies.emplace_back(desc.key, std::move(files));
+}
+
+void SHRShaderHotReload::Update()
+{
+	m_retired.Retire(m_renderContext.GetFence()->GetCompletedValue(), [](Retired&) {});
+
+	std::unique_ptr<Reload> pReload;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pReload = std::move(m_pFinishedReload);
+	}
+
+	if (pReload)
+	{
+		ApplyReload(*pReload);
+		m_isReloading = false;
+	}
+
+	//after the swap, it publishes the reloaded permutations again with their current includes
+	std::vector<std::pair<uint64_t, std::vector<std::filesystem::path>>> dependencies;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		dependencies.swap(m_publishedDependencies);
+	}
+
+	for (auto& dependency : dependencies)
+	{
+		m_dependencyGraph.SetDependencies(dependency.first, dependency.second);
+		for (auto& file : dependency.second)
+		{
+			m_watcher.Watch(file);
+		}
+	}
+
+	std::vector<std::filesystem::path> changedFiles;
+	m_watcher.Poll(changedFiles);
+	for (auto& file : changedFiles)
+	{
+		std::vector<uint64_t> keys;
+		m_dependencyGraph.GetDependents(file, keys);
+		m_dirtyKeys.insert(keys.begin(), keys.end());
+	}
+
+	//one reload at a time, edits made meanwhile go into the next one so an older compile never lands last
+	if (!m_isReloading && !m_dirtyKeys.empty()) ScheduleReload();
+}
+
+void SHRShaderHotReload::ScheduleReload()
+{
+	std::vector<SHRShaderPermutationDesc> permutations;
+	std::vector<const SHRShader*> pOldShaders;
+	for (uint64_t key : m_dirtyKeys)
+	{
+		SHRShaderPermutationDesc desc;
+		std::shared_ptr<SHRShader> pShader = m_registry.Find(key);
+		if (!pShader || !m_registry.GetPermutationDesc(key, desc)) continue;
+
+		permutations.push_back(desc);
+		pOldShaders.push_back(pShader.get());
+	}
+	m_dirtyKeys.clear();
+
+	if (permutations.empty()) return;
+
+	//taken on the render thread, the only one touching the pass object cache
+	std::vector<SHRShaderPassDesc> passDescs;
+	SHRShaderPassObject::FindShaderPassDescs(pOldShaders, passDescs);
+
+	//edited files are read again instead of taken from the compiler's source cache
+	g_shaderCompiler.ClearSources();
+
+	//the old shaders stay in the registry until the reload is applied, so the pointers stay valid
+	m_isReloading = true;
+	m_compileQueue.Push([this, permutations, pOldShaders, passDescs]() { RunReload(permutations, pOldShaders, passDescs); });
+}
+
+void SHRShaderHotReload::RunReload(std::vector<SHRShaderPermutationDesc> permutations, std::vector<const SHRShader*> pOldShaders, std::vector<SHRShaderPassDesc> passDescs)
+{
+	std::unique_ptr<Reload> pReload = std::make_unique<Reload>();
+
+	//old shader to the one replacing it
+	std::vector<std::pair<const SHRShader*, const SHRShader*>> replacements;
+	for (size_t i = 0; i < permutations.size(); i++)
+	{
+		const SHRShaderPermutationDesc& desc = permutations[i];
+		try
+		{
+			std::shared_ptr<SHRShader> pShader = std::make_shared<SHRShader>(desc.name, desc.entryPoint, desc.target, desc.compileFlags, desc.defines);
+			std::vector<std::filesystem::path> dependencies;
+			SHRCollectShaderDependencies(SHRShader::GetSourcePath(desc.name), dependencies);
+			pReload->shaders.push_back({ desc, pShader, std::move(dependencies) });
+			replacements.emplace_back(pOldShaders[i], pShader.get());
+		}
+		catch (const COMException&)
+		{
+			//the errors went to the debug output, the old shader stays until the file compiles again
+		}
+	}
+
+	//the pipeline states are created here rather than on the first draw that needs them
+	for (auto& passDesc : passDescs)
+	{
+		SHRShaderPassDesc desc = passDesc;
+		bool replaced = false;
+		for (size_t i = 0; i < static_cast<uint8_t>(SHRShaderType::NumShaderTypes); i++)
+		{
+			for (auto& replacement : replacements)
+			{
+				if (desc.pShaders[i] != replacement.first) continue;
+				desc.pShaders[i] = replacement.second;
+				replaced = true;
+			}
+		}
+		if (!replaced) continue;
+
+		try
+		{
+			pReload->passes.push_back({ desc, std::make_unique<SHRShaderPassObject>(m_renderContext, desc) });
+		}
+		catch (const COMException&)
+		{
+			//left to GetShaderPassObject on first use
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pFinishedReload = std::move(pReload);
+	m_reloadFinished.notify_all();
+}
+
+void SHRShaderHotReload::ApplyReload(Reload& reload)
+{
+	std::vector<std::shared_ptr<SHRShader>> pOldShaders;
+	for (auto& shader : reload.shaders)
+	{
+		std::shared_ptr<SHRShader> pOldShader = m_registry.Find(shader.desc.key);
+		if (pOldShader) pOldShaders.push_back(pOldShader);
+
+		//without the callback, it would read the includes again on the render thread
+		m_registry.Publish(shader.desc, shader.pShader, false);
+	}
+
+	//queued behind what was published before, so Update applies the reloaded includes last
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& shader : reload.shaders)
+		{
+			m_publishedDependencies.emplace_back(shader.desc.key, std::move(shader.dependencies));
+		}
+	}
+
+	std::vector<const SHRShader*> pStaleShaders;
+	for (auto& pShader : pOldShaders)
+	{
+		pStaleShaders.push_back(pShader.get());
+	}
+
+	//pass objects created with an old shader since the reload started are not rebuilt here, they are created again on first use
+	std::vector<std::shared_ptr<SHRShaderPassObject>> removed;
+	SHRShaderPassObject::RemoveShaderPassObjects(pStaleShaders, removed);
+	for (auto& pass : reload.passes)
+	{
+		SHRShaderPassObject::InsertShaderPassObject(pass.desc, std::move(pass.pPassObject), removed);
+	}
+
+	//frames recorded up to now may still use them on the GPU
+	uint64_t fenceValue = m_renderContext.GetGPUFenceValue();
+	for (auto& pPassObject : removed)
+	{
+		m_retired.Push({ nullptr, pPassObject }, fenceValue);
+	}
+	for (auto& pShader : pOldShaders)
+	{
+		m_retired.Push({ pShader, nullptr }, fenceValue);
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+#include "SHRFencedQueue.h"
+#include "SHRShaderFileWatcher.h"
+#include "SHRShaderDependencyGraph.h"
+#include "SHRShaderCompileQueue.h"
+#include "SHRShaderPassObject.h"
+
+#ifndef SHR_SHADER_HOT_RELOAD
+#if defined(_DEBUG)
+#define SHR_SHADER_HOT_RELOAD 1
+#else
+#define SHR_SHADER_HOT_RELOAD 0
+#endif
+#endif
+
+//recompiles the permutations that read an edited shader file on the compile queue, rebuilds the pass objects
+//that use them there too, and swaps both in at the start of a frame. a permutation that fails to compile keeps its old shader
+class SHRShaderHotReload
+{
+public:
+	SHRShaderHotReload(SHRRenderContext& renderContext, SHRShaderCompileQueue& compileQueue, SHRShaderRegistry& registry = g_shaderRegistry);
+	~SHRShaderHotReload();		//waits for a reload still on the compile queue
+
+	//render thread, at frame start before any pass object or shader is looked up
+	void Update();
+
+private:
+	struct ReloadedShader
+	{
+		SHRShaderPermutationDesc desc;
+		std::shared_ptr<SHRShader> pShader;
+		std::vector<std::filesystem::path> dependencies;		//its includes, read on the compile worker
+	};
+
+	struct RebuiltPass
+	{
+		SHRShaderPassDesc desc;
+		std::unique_ptr<SHRShaderPassObject> pPassObject;
+	};
+
+	//result of one reload job, applied as a whole so a pass never mixes old & new shaders of one edit
+	struct Reload
+	{
+		std::vector<ReloadedShader> shaders;
+		std::vector<RebuiltPass> passes;
+	};
+
+	//shaders & pass objects swapped out, released once the frames that may still use them retire
+	struct Retired
+	{
+		std::shared_ptr<SHRShader> pShader;
+		std::shared_ptr<SHRShaderPassObject> pPassObject;
+	};
+
+	void OnPublished(const SHRShaderPermutationDesc& desc);
+	void ScheduleReload();
+	void RunReload(std::vector<SHRShaderPermutationDesc> permutations, std::vector<const SHRShader*> pOldShaders, std::vector<SHRShaderPassDesc> passDescs);
+	void ApplyReload(Reload& reload);
+
+public:
+	SHRShaderFileWatcher m_watcher;
+	SHRShaderDependencyGraph m_dependencyGraph;
+
+	//edited permutations waiting for the reload in flight to land
+	std::unordered_set<uint64_t> m_dirtyKeys;
+	bool m_isReloading = false;
+
+	SHRFencedQueue<Retired> m_retired;
+
+private:
+	SHRRenderContext& m_renderContext;
+	SHRShaderCompileQueue& m_compileQueue;
+	SHRShaderRegistry& m_registry;
+
+	//filled by the publishing threads & the compile queue, drained by Update
+	std::mutex m_mutex;
+	std::condition_variable m_reloadFinished;
+	std::vector<std::pair<uint64_t, std::vector<std::filesystem::path>>> m_publishedDependencies;
+	std::unique_ptr<Reload> m_pFinishedReload;
+};
@@ -1,5 +1,7 @@
 #include "SHRShaderPassObject.h"
 
+#include <algorithm>
+
 template <typename T>
 void hash_combine(size_t& seed, const T& value) {
 	std::hash<T> hasher;
@@ -178,6 +180,46 @@ SHRShaderPassObject* SHRShaderPassObject::GetShaderPassObject(SHRRenderContext&
 	return g_passObjectCache[desc].get();
 }
 
+static bool UsesAnyShader(const SHRShaderPassDesc& desc, const std::vector<const SHRShader*>& pShaders)
+{
+	for (size_t i = 0; i < static_cast<uint8_t>(SHRShaderType::NumShaderTypes); i++)
+	{
+		if (desc.pShaders[i] && std::find(pShaders.begin(), pShaders.end(), desc.pShaders[i]) != pShaders.end()) return true;
+	}
+	return false;
+}
+
+void SHRShaderPassObject::FindShaderPassDescs(const std::vector<const SHRShader*>& pShaders, std::vector<SHRShaderPassDesc>& descs)
+{
+	for (auto& passObject : g_passObjectCache)
+	{
+		if (UsesAnyShader(passObject.first, pShaders)) descs.push_back(passObject.first);
+	}
+}
+
+void SHRShaderPassObject::RemoveShaderPassObjects(const std::vector<const SHRShader*>& pShaders, std::vector<std::shared_ptr<SHRShaderPassObject>>& removed)
+{
+	for (auto it = g_passObjectCache.begin(); it != g_passObjectCache.end();)
+	{
+		if (UsesAnyShader(it->first, pShaders))
+		{
+			removed.push_back(std::move(it->second));
+			it = g_passObjectCache.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+void SHRShaderPassObject::InsertShaderPassObject(const SHRShaderPassDesc& desc, std::unique_ptr<SHRShaderPassObject> pPassObject, std::vector<std::shared_ptr<SHRShaderPassObject>>& removed)
+{
+	std::unique_ptr<SHRShaderPassObject>& pCached = g_passObjectCache[desc];
+	if (pCached) removed.push_back(std::move(pCached));
+	pCached = std::move(pPassObject);
+}
+
 SHRShaderPassObject::SHRShaderPassObject(SHRRenderContext& renderContext, const SHRShaderPassDesc& desc) : m_renderContext(renderContext)
 {
 	for (size_t i = 0; i < static_cast<uint8_t>(SHRShaderType::NumShaderTypes); i++)
@@ -281,9 +323,15 @@ void SHRShaderPassObject::InitializeInputLayout()
 	}
 }
 
-void SHRShaderPassObject::BindRootParameters(const SHRShaderResouceBinding& resoucebindings)
+void SHRShaderPassObject::BindRootParameters(SHRShaderResouceBinding& resoucebindings)
 {
 	ID3D12GraphicsCommandList* cmdList = m_renderContext.GetCmdList();
+	SHRDescriptorCache* descriptorCache = m_renderContext.GetDescriptorCache();
+
+	//the heap grew after the tables were cached, their offsets point into the replaced one
+	if (resoucebindings.m_resoureCache.heapVersion != descriptorCache->m_heapVersion) resoucebindings.CommitResouce(descriptorCache);
+	//tables set before SetDescriptorHeaps are undefined after it, every table of the binding is set again below
+	if (descriptorCache->m_boundHeapVersion != descriptorCache->m_heapVersion) descriptorCache->SetDescriptorHeaps(cmdList);
 
 	for (size_t i = 0; i < resoucebindings.m_resoureCache.numTable; i++)
 	{
@@ -302,9 +350,8 @@ void SHRShaderPassObject::BindRootParameters(const SHRShaderResouceBinding& reso
 		else
 		{
 			//rootTable
-			SHRDescriptorCache* descriptorCache = m_renderContext.GetDescriptorCache();
 			D3D12_GPU_DESCRIPTOR_HANDLE baseHandle = resouce.type == SHRResourceViewType::Sampler ? descriptorCache->GetSamplerHeapBaseHandle() : descriptorCache->GetCbvSrvUavHeapBaseHandle();
-			UINT incrementSize = resouce.type == SHRResourceViewType::Sampler ? descriptorCache->m_samplerIncrementSize : descriptorCache->m_cbvSrvUavOffset;
+			UINT incrementSize = resouce.type == SHRResourceViewType::Sampler ? descriptorCache->m_samplerIncrementSize : descriptorCache->m_cbvSrvUavIncrementSize;
 
 			cmdList->SetGraphicsRootDescriptorTable(i, CD3DX12_GPU_DESCRIPTOR_HANDLE(baseHandle, rootTable.offsetFromHeapStart, incrementSize));
 		}
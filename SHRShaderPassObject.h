@@ -111,12 +111,20 @@ public:
 	SHRShaderPassObject(SHRRenderContext& renderContext, const SHRShaderPassDesc& desc);
 	static SHRShaderPassObject* GetShaderPassObject(SHRRenderContext& renderContext, const SHRShaderPassDesc& desc);
 
+	//descs of the cached pass objects built with any of pShaders
+	static void FindShaderPassDescs(const std::vector<const SHRShader*>& pShaders, std::vector<SHRShaderPassDesc>& descs);
+	//takes the pass objects built with any of pShaders out of the cache, the caller keeps them until the GPU is done with them
+	static void RemoveShaderPassObjects(const std::vector<const SHRShader*>& pShaders, std::vector<std::shared_ptr<SHRShaderPassObject>>& removed);
+	//a pass object already cached for desc is appended to removed
+	static void InsertShaderPassObject(const SHRShaderPassDesc& desc, std::unique_ptr<SHRShaderPassObject> pPassObject, std::vector<std::shared_ptr<SHRShaderPassObject>>& removed);
+
 private:
 	void InitializeShaderResoureLayout();
 	void InitializeInputLayout();
 	void InitializePipelineState(const SHRShaderPassDesc& desc);
 
-	void BindRootParameters(const SHRShaderResouceBinding& resoucebindings);
+	//commits the binding again when its tables were cached in a heap the descriptor cache has replaced since
+	void BindRootParameters(SHRShaderResouceBinding& resoucebindings);
 
 public:
 	std::vector<const SHRShader*> m_pPassShader;
@@ -124,7 +132,7 @@ public:
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_pRootSignature;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_inputLayout;
-	ID3D12PipelineState* m_pPipelineState;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pPipelineState;
 
 private:
 	SHRRenderContext& m_renderContext;
@@ -0,0 +1,91 @@
+#include "SHRShaderProgram.h"
+
+//length first, so "ab" + "c" and "a" + "bc" do not collide
+static uint64_t HashString(const std::wstring& text, uint64_t hash)
+{
+	return SHRHashBytes(text.data(), text.size() * sizeof(wchar_t), SHRHashCombine(hash, text.size()));
+}
+
+SHRShaderProgram::SHRShaderProgram(const std::wstring& name, const std::wstring& entryPoint, const std::wstring& target,
+	const std::vector<std::string>& keywords, const std::vector<std::wstring>& compileFlags) :
+	m_name(name),
+	m_entryPoint(entryPoint),
+	m_target(target),
+	m_compileFlags(compileFlags),
+	m_keywords(keywords)
+{
+	if (m_keywords.size() > SHR_SHADER_MAX_KEYWORD_COUNT)
+	{
+		ThrowIfFailed(E_INVALIDARG);
+	}
+
+	for (auto& keyword : m_keywords)
+	{
+		m_keywordHashes.push_back(SHRHashString(keyword.c_str()));
+	}
+
+	//flags are part of the key, a debug & a release build of the same variant do not collide
+	m_programHash = HashString(m_name, SHR_FNV_OFFSET_BASIS);
+	m_programHash = HashString(m_entryPoint, m_programHash);
+	m_programHash = HashString(m_target, m_programHash);
+	for (auto& flag : m_compileFlags)
+	{
+		m_programHash = HashString(flag, m_programHash);
+	}
+}
+
+SHRShaderKeywordMask SHRShaderProgram::GetKeywordBit(uint64_t keywordHash) const
+{
+	for (size_t i = 0; i < m_keywordHashes.size(); i++)
+	{
+		if (m_keywordHashes[i] == keywordHash) return 1ULL << i;
+	}
+	return 0;
+}
+
+SHRShaderKeywordMask SHRShaderProgram::GetKeywordMask(const std::vector<std::string>& keywords) const
+{
+	SHRShaderKeywordMask mask = 0;
+	for (auto& keyword : keywords)
+	{
+		mask |= GetKeywordBit(SHRHashString(keyword.c_str()));
+	}
+	return mask;
+}
+
+SHRShaderPermutationDesc SHRShaderProgram::GetPermutationDesc(SHRShaderKeywordMask mask) const
+{
+	SHRShaderPermutationDesc desc = { GetPermutationKey(mask), m_name, m_entryPoint, m_target, m_compileFlags };
+
+	//keywords that are off stay undefined, #ifdef & #if both read them as off
+	for (size_t i = 0; i < m_keywords.size(); i++)
+	{
+		if (mask & (1ULL << i)) desc.defines[std::wstring(m_keywords[i].begin(), m_keywords[i].end())] = L"1";
+	}
+	return desc;
+}
+
+std::shared_ptr<SHRShader> SHRShaderProgram::GetVariant(SHRShaderKeywordMask mask)
+{
+	uint64_t key = GetPermutationKey(mask);
+
+	std::shared_ptr<SHRShader> pShader = g_shaderRegistry.Find(key);
+	if (pShader) return pShader;
+
+	std::lock_guard<std::mutex> lock(m_compileMutex);
+	pShader = g_shaderRegistry.Find(key);
+	if (pShader) return pShader;
+
+	SHRShaderPermutationDesc desc = GetPermutationDesc(mask);
+	pShader = std::make_shared<SHRShader>(desc.name, desc.entryPoint, desc.target, desc.compileFlags, desc.defines);
+	g_shaderRegistry.Publish(desc, pShader);
+	return pShader;
+}
+
+void SHRShaderProgram::GetPrecompilePermutations(std::vector<SHRShaderPermutationDesc>& permutations) const
+{
+	for (auto mask : m_precompileMasks)
+	{
+		if (!g_shaderRegistry.Find(GetPermutationKey(mask))) permutations.push_back(GetPermutationDesc(mask));
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "SHRShaderRegistry.h"
+
+#define SHR_SHADER_MAX_KEYWORD_COUNT 64
+
+//bit i is keyword i of the program, 0 is the variant without any keyword
+typedef uint64_t SHRShaderKeywordMask;
+
+//one entry point of a shader file and the keywords it is compiled with. every keyword combination is a variant,
+//compiled on first request or up front from the precompile list and kept in g_shaderRegistry
+class SHRShaderProgram
+{
+public:
+	SHRShaderProgram(const std::wstring& name, const std::wstring& entryPoint, const std::wstring& target,
+		const std::vector<std::string>& keywords = {}, const std::vector<std::wstring>& compileFlags = {});
+
+	//keywordHash is SHRHashString of the keyword, 0 when the program does not declare it
+	SHRShaderKeywordMask GetKeywordBit(uint64_t keywordHash) const;
+	SHRShaderKeywordMask GetKeywordMask(const std::vector<std::string>& keywords) const;
+
+	uint64_t GetPermutationKey(SHRShaderKeywordMask mask) const { return SHRHashCombine(m_programHash, mask); }
+
+	//registry lookup, the first request of a variant compiles it on the calling thread
+	std::shared_ptr<SHRShader> GetVariant(SHRShaderKeywordMask mask);
+
+	void AddPrecompileVariant(SHRShaderKeywordMask mask) { m_precompileMasks.push_back(mask); }
+	//variants of the precompile list that are not in the registry yet, to be submitted to a compile queue
+	void GetPrecompilePermutations(std::vector<SHRShaderPermutationDesc>& permutations) const;
+
+	SHRShaderPermutationDesc GetPermutationDesc(SHRShaderKeywordMask mask) const;
+
+public:
+	std::wstring m_name;
+	std::wstring m_entryPoint;
+	std::wstring m_target;
+	std::vector<std::wstring> m_compileFlags;
+
+	std::vector<std::string> m_keywords;
+	std::vector<uint64_t> m_keywordHashes;
+	uint64_t m_programHash;
+
+	std::vector<SHRShaderKeywordMask> m_precompileMasks;
+
+private:
+	//one lazy compile at a time, a second thread asking for the same variant waits and finds it published
+	std::mutex m_compileMutex;
+};
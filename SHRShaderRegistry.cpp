@@ -0,0 +1,57 @@
+#include "SHRShaderRegistry.h"
+
+SHRShaderRegistry g_shaderRegistry;
+
+std::shared_ptr<SHRShader> SHRShaderRegistry::Find(uint64_t key) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+	auto it = m_shaders.find(key);
+	return it != m_shaders.end() ? it->second.pShader : nullptr;
+}
+
+void SHRShaderRegistry::Publish(const SHRShaderPermutationDesc& desc, std::shared_ptr<SHRShader> pShader, bool notify)
+{
+	PublishCallback callback;
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		m_shaders[desc.key] = { desc, std::move(pShader) };
+		if (notify) callback = m_publishCallback;
+	}
+
+	//outside the lock, the callback may look shaders up
+	if (callback) callback(desc);
+}
+
+bool SHRShaderRegistry::GetPermutationDesc(uint64_t key, SHRShaderPermutationDesc& desc) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+	auto it = m_shaders.find(key);
+	if (it == m_shaders.end()) return false;
+
+	desc = it->second.desc;
+	return true;
+}
+
+void SHRShaderRegistry::GetPermutationDescs(std::vector<SHRShaderPermutationDesc>& descs) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+	for (auto& shader : m_shaders)
+	{
+		descs.push_back(shader.second.desc);
+	}
+}
+
+void SHRShaderRegistry::SetPublishCallback(PublishCallback callback)
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	m_publishCallback = callback;
+}
+
+size_t SHRShaderRegistry::GetCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	return m_shaders.size();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <shared_mutex>
+#include <functional>
+#include <unordered_map>
+
+#include "SHRShader.h"
+#include "SHRHash.h"
+
+//one compile of a shader file, published in the registry under key
+struct SHRShaderPermutationDesc
+{
+	uint64_t key;					//SHRHashString of a name, or SHRShaderProgram::GetPermutationKey
+	std::wstring name;				//file under ./Shaders/ without extension, as SHRShader takes it
+	std::wstring entryPoint;
+	std::wstring target;
+	std::vector<std::wstring> compileFlags;
+	std::unordered_map<std::wstring, std::wstring> defines;
+};
+
+//compiled shaders by 64 bit key, compile workers publish while the render thread looks up
+class SHRShaderRegistry
+{
+public:
+	//called on the publishing thread once the shader can be found
+	typedef std::function<void(const SHRShaderPermutationDesc& desc)> PublishCallback;
+
+	struct Entry
+	{
+		SHRShaderPermutationDesc desc;
+		std::shared_ptr<SHRShader> pShader;
+	};
+
+public:
+	SHRShaderRegistry() = default;
+	~SHRShaderRegistry() = default;
+
+	//nullptr until the key is published, the shader stays alive for as long as the caller holds it
+	std::shared_ptr<SHRShader> Find(uint64_t key) const;
+	//replaces an earlier shader of the same key, desc is kept to compile the permutation again.
+	//notify false skips the publish callback, for a caller that already tracks the shader
+	void Publish(const SHRShaderPermutationDesc& desc, std::shared_ptr<SHRShader> pShader, bool notify = true);
+
+	bool GetPermutationDesc(uint64_t key, SHRShaderPermutationDesc& desc) const;
+	void GetPermutationDescs(std::vector<SHRShaderPermutationDesc>& descs) const;
+
+	void SetPublishCallback(PublishCallback callback);
+
+	size_t GetCount() const;
+
+private:
+	mutable std::shared_mutex m_mutex;
+	std::unordered_map<uint64_t, Entry> m_shaders;
+	PublishCallback m_publishCallback;
+};
+
+extern SHRShaderRegistry g_shaderRegistry;
@@ -25,12 +25,16 @@ SHRShaderResouceBinding::SHRShaderResouceBinding(const std::vector<SHRShaderReso
 	SHRShaderResouceCache::ResourceView* pResource = &m_resoureCache.cachedResouce.front();
 
 	m_resoureCache.cachedRootTable.resize(paramCount);
+	UINT maxTableSize = 0;
 	for (size_t i = 0; i < paramCount; i++)
 	{
 		m_resoureCache.cachedRootTable[i].numResouce = numResouces[i];
 		m_resoureCache.cachedRootTable[i].pResouce = pResource;
 		pResource += numResouces[i];
+		maxTableSize = max(maxTableSize, numResouces[i]);
 	}
+
+	m_scratchHandles.resize(maxTableSize);
 }
 
 void SHRShaderResouceBinding::SetResouce(const std::string& name, const std::vector<SHRShaderResourceView>& resouce)
@@ -56,26 +60,57 @@ void SHRShaderResouceBinding::SetResouce(const std::string& name, const std::vec
 
 void SHRShaderResouceBinding::CommitResouce(SHRDescriptorCache* GPUDescriptorCache)
 {
+	CacheRootTables(GPUDescriptorCache);
+	GPUDescriptorCache->FlushCopies();
+}
+
+void SHRShaderResouceBinding::CommitResouces(SHRDescriptorCache* GPUDescriptorCache, SHRShaderResouceBinding* const* ppBindings, UINT bindingCount)
+{
+	for (UINT i = 0; i < bindingCount; i++)
+	{
+		ppBindings[i]->CacheRootTables(GPUDescriptorCache);
+	}
+
+	//same for a binding that grew the heap under the bindings cached before it
+	UINT staleIndex = 0;
+	while (staleIndex < bindingCount)
+	{
+		SHRShaderResouceBinding* pBinding = ppBindings[staleIndex++];
+		if (pBinding->m_resoureCache.heapVersion == GPUDescriptorCache->m_heapVersion) continue;
+
+		//it may grow the heap again, so the check starts over
+		pBinding->CacheRootTables(GPUDescriptorCache);
+		staleIndex = 0;
+	}
+	GPUDescriptorCache->FlushCopies();
+}
+
+void SHRShaderResouceBinding::CacheRootTables(SHRDescriptorCache* GPUDescriptorCache)
+{
+	m_resoureCache.heapVersion = GPUDescriptorCache->m_heapVersion;
+
 	for (SHRShaderResouceCache::RootTable& rootTable : m_resoureCache.cachedRootTable)
 	{
 		SHRShaderResouceCache::ResourceView & resouce= rootTable.GetResouce(0);
 		if (resouce.viewHandle.ptr == 0) continue;
 		
-		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles(rootTable.numResouce);
 		for (size_t i = 0; i < rootTable.numResouce; i++)
 		{
-			handles[i] = rootTable.GetResouce(i).viewHandle;
+			m_scratchHandles[i] = rootTable.GetResouce(i).viewHandle;
 		}
 
 		if (resouce.type != SHRResourceViewType::Sampler)
 		{
-			auto [offset, gpuHandle] = GPUDescriptorCache->CacheCbvSrvUavDescriptor(handles);
+			auto [offset, gpuHandle] = GPUDescriptorCache->CacheCbvSrvUavDescriptor(m_scratchHandles.data(), rootTable.numResouce);
 			rootTable.offsetFromHeapStart = offset;
 		}
 		else
 		{
-			auto [offset, gpuHandle] = GPUDescriptorCache->CacheSamplerDescriptor(handles);
+			auto [offset, gpuHandle] = GPUDescriptorCache->CacheSamplerDescriptor(m_scratchHandles.data(), rootTable.numResouce);
 			rootTable.offsetFromHeapStart = offset;
 		}
 	}
+
+	//a table that grew the heap left the ones cached before it in the replaced heap
+	if (m_resoureCache.heapVersion != GPUDescriptorCache->m_heapVersion) CacheRootTables(GPUDescriptorCache);
 }
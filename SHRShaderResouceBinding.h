@@ -29,6 +29,8 @@ public:
 public:
 	//table & rootview need cache slot
 	UINT numTable;
+	//SHRDescriptorCache::m_heapVersion the table offsets were cached in
+	UINT64 heapVersion = UINT64_MAX;
 	std::vector<RootTable> cachedRootTable;
 	std::vector<ResourceView> cachedResouce;
 };
@@ -41,9 +43,18 @@ public:
 	void SetResouce(const std::string& name, const std::vector<SHRShaderResourceView>& resouce);
 
 	void CommitResouce(SHRDescriptorCache* GPUDescriptorCache);
+	//commits a whole batch of bindings with a single CopyDescriptors per heap type
+	static void CommitResouces(SHRDescriptorCache* GPUDescriptorCache, SHRShaderResouceBinding* const* ppBindings, UINT bindingCount);
+
+private:
+	void CacheRootTables(SHRDescriptorCache* GPUDescriptorCache);
 
 public:
 	const std::vector<SHRShaderResoureLayout>& m_resourceLayout;
 	SHRShaderResouceCache m_resoureCache;
+
+private:
+	//sized for the largest table so committing never allocates
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_scratchHandles;
 };
 
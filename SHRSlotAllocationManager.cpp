@@ -0,0 +1,124 @@
+#include "SHRSlotAllocationManager.h"
+#include "SHRBitUtils.h"
+
+SHRSlotAllocationManager::SHRSlotAllocationManager(uint32_t slotCount)
+{
+	Initialize(slotCount);
+}
+
+void SHRSlotAllocationManager::Initialize(uint32_t slotCount)
+{
+	m_slotCount = slotCount;
+	m_freeCount = 0;
+
+	uint32_t wordCount = (slotCount + 63) / 64;
+	m_freeBits.assign(wordCount, 0);
+	m_summaryBits.assign((wordCount + 63) / 64, 0);
+
+	MarkRange(0, slotCount, true);
+}
+
+uint32_t SHRSlotAllocationManager::AllocateSlot()
+{
+	for (size_t i = 0; i < m_summaryBits.size(); i++)
+	{
+		if (m_summaryBits[i] == 0) continue;
+
+		uint32_t word = static_cast<uint32_t>(i * 64 + SHRFindFirstSet(m_summaryBits[i]));
+		uint32_t index = word * 64 + SHRFindFirstSet(m_freeBits[word]);
+		MarkRange(index, 1, false);
+		return index;
+	}
+
+	return SHR_SLOT_INVALID_INDEX;
+}
+
+uint32_t SHRSlotAllocationManager::AllocateRange(uint32_t count)
+{
+	if (count == 0 || count > m_freeCount) return SHR_SLOT_INVALID_INDEX;
+	if (count == 1) return AllocateSlot();
+
+	//walk the free runs until one is long enough
+	uint32_t begin = FindFree(0);
+	while (begin != SHR_SLOT_INVALID_INDEX && m_slotCount - begin >= count)
+	{
+		uint32_t end = FindUsed(begin);
+		if (end - begin >= count)
+		{
+			MarkRange(begin, count, false);
+			return begin;
+		}
+		begin = FindFree(end);
+	}
+
+	return SHR_SLOT_INVALID_INDEX;
+}
+
+void SHRSlotAllocationManager::DeallocateRange(uint32_t first, uint32_t count)
+{
+	MarkRange(first, count, true);
+}
+
+void SHRSlotAllocationManager::MarkRange(uint32_t first, uint32_t count, bool free)
+{
+	uint32_t index = first;
+	uint32_t end = first + count;
+	while (index < end)
+	{
+		uint32_t word = index >> 6;
+		uint32_t bit = index & 63;
+		uint32_t bitCount = end - index < 64 - bit ? end - index : 64 - bit;
+		uint64_t mask = (bitCount == 64 ? ~0ULL : ((1ULL << bitCount) - 1)) << bit;
+
+		if (free) m_freeBits[word] |= mask;
+		else m_freeBits[word] &= ~mask;
+
+		uint64_t summaryMask = 1ULL << (word & 63);
+		if (m_freeBits[word]) m_summaryBits[word >> 6] |= summaryMask;
+		else m_summaryBits[word >> 6] &= ~summaryMask;
+
+		index += bitCount;
+	}
+
+	if (free) m_freeCount += count;
+	else m_freeCount -= count;
+}
+
+uint32_t SHRSlotAllocationManager::FindFree(uint32_t from) const
+{
+	if (from >= m_slotCount) return SHR_SLOT_INVALID_INDEX;
+
+	uint32_t word = from >> 6;
+	uint64_t bits = m_freeBits[word] & (~0ULL << (from & 63));
+	if (bits) return word * 64 + SHRFindFirstSet(bits);
+
+	//the summary skips whole words that are fully used
+	word++;
+	for (uint32_t summary = word >> 6; summary < m_summaryBits.size(); summary++)
+	{
+		uint64_t summaryBits = m_summaryBits[summary];
+		if (summary == word >> 6) summaryBits &= ~0ULL << (word & 63);
+		if (summaryBits == 0) continue;
+
+		uint32_t freeWord = summary * 64 + SHRFindFirstSet(summaryBits);
+		return freeWord * 64 + SHRFindFirstSet(m_freeBits[freeWord]);
+	}
+
+	return SHR_SLOT_INVALID_INDEX;
+}
+
+uint32_t SHRSlotAllocationManager::FindUsed(uint32_t from) const
+{
+	//bits past m_slotCount are never set, so they read as used
+	uint32_t word = from >> 6;
+	uint64_t bits = ~m_freeBits[word] & (~0ULL << (from & 63));
+	while (bits == 0)
+	{
+		word++;
+		if (word >= m_freeBits.size()) return m_slotCount;
+		bits = ~m_freeBits[word];
+	}
+
+	uint32_t index = word * 64 + SHRFindFirstSet(bits);
+	return index < m_slotCount ? index : m_slotCount;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define SHR_SLOT_INVALID_INDEX UINT32_MAX
+
+//free slots of a fixed size heap as a two level bitmap, a set bit means free.
+//each summary bit tells whether the matching 64 slot word still has a free slot
+class SHRSlotAllocationManager
+{
+public:
+	SHRSlotAllocationManager() = default;
+	SHRSlotAllocationManager(uint32_t slotCount);
+	~SHRSlotAllocationManager() = default;
+
+	void Initialize(uint32_t slotCount);
+
+	uint32_t AllocateSlot();							//return SHR_SLOT_INVALID_INDEX when the heap is full
+	uint32_t AllocateRange(uint32_t count);				//first slot of count contiguous slots
+	void DeallocateSlot(uint32_t index) { DeallocateRange(index, 1); }
+	void DeallocateRange(uint32_t first, uint32_t count);
+
+	bool IsFree(uint32_t index) const { return (m_freeBits[index >> 6] >> (index & 63)) & 1; }
+	uint32_t GetUsedCount() const { return m_slotCount - m_freeCount; }
+
+private:
+	void MarkRange(uint32_t first, uint32_t count, bool free);
+	uint32_t FindFree(uint32_t from) const;
+	uint32_t FindUsed(uint32_t from) const;
+
+public:
+	std::vector<uint64_t> m_freeBits;
+	std::vector<uint64_t> m_summaryBits;
+
+	uint32_t m_slotCount = 0;
+	uint32_t m_freeCount = 0;
+};
@@ -0,0 +1,29 @@
+#include "SHRUploadRingBuffer.h"
+#include "SHRResourceAllocator.h"
+
+SHRUploadRingBuffer::SHRUploadRingBuffer(SHRBuddySystem* pBufferAllocator, UINT64 size)
+{
+	SHRAllocationResult result = pBufferAllocator->AllocateSHRResouce(D3D12_HEAP_TYPE_UPLOAD, CD3DX12_RESOURCE_DESC::Buffer(size), D3D12_RESOURCE_STATE_GENERIC_READ, size, m_buffer, nullptr);
+	if (result != SHRAllocationResult::Success)
+	{
+		//m_buffer has no resource to map, the ring cannot work without it
+		OutputDebugStringA(result == SHRAllocationResult::OutOfBudget ? "SHRUploadRingBuffer: the upload ring is over the memory budget\n"
+			: "SHRUploadRingBuffer: the upload ring could not be allocated\n");
+		ThrowIfFailed(result == SHRAllocationResult::Unsupported ? E_INVALIDARG : E_OUTOFMEMORY);
+	}
+
+	//upload heaps may stay mapped for the lifetime of the resource
+	m_pCPUAddress = reinterpret_cast<UINT8*>(m_buffer.Map(0));
+	m_gpuAddress = m_buffer.m_pSHRD3dResource->m_resourceGPUAddress;
+
+	m_manager.Initialize(size);
+}
+
+SHRUploadAllocation SHRUploadRingBuffer::Allocate(UINT64 size, UINT64 alignment)
+{
+	UINT64 offset = m_manager.Allocate(size, alignment);
+	if (offset == SHR_RING_INVALID_OFFSET)
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	return { m_pCPUAddress + offset, m_gpuAddress + offset };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "d3dx12.h"
+#include "SHRUtils.h"
+#include "SHRResource.h"
+#include "SHRRingAllocationManager.h"
+
+#define SHR_UPLOAD_RING_BUFFER_DEFAULT_SIZE 4096 * 1024  //KB = 4MB
+
+class SHRBuddySystem;
+
+struct SHRUploadAllocation
+{
+	void* pCPUAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+};
+
+//a single persistently mapped upload buffer sub-allocated as a ring, allocating never calls into the driver
+class SHRUploadRingBuffer
+{
+public:
+	SHRUploadRingBuffer(SHRBuddySystem* pBufferAllocator, UINT64 size = SHR_UPLOAD_RING_BUFFER_DEFAULT_SIZE);
+	~SHRUploadRingBuffer() = default;
+
+	SHRUploadAllocation Allocate(UINT64 size, UINT64 alignment = 16);
+
+	void FinishFrame(UINT64 fenceValue) { m_manager.FinishFrame(fenceValue); }
+	void Retire(UINT64 completedFenceValue) { m_manager.Retire(completedFenceValue); }
+
+public:
+	SHRResource m_buffer;
+	UINT8* m_pCPUAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress;
+
+	SHRRingAllocationManager m_manager;
+};
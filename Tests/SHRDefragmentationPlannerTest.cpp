@@ -0,0 +1,178 @@
+//SHRDefragmentationPlanner without a device: heaps & blocks are plain numbers, pUserData tags each block so the moves
+//can be traced back to the block they came from
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "SHRDefragmentationPlanner.h"
+#include "SHRTest.h"
+
+#define SHR_TEST_HEAP_SIZE 1024
+
+static void* GetTag(uintptr_t tag)
+{
+	return reinterpret_cast<void*>(tag);
+}
+
+static bool IsEvacuated(const SHRDefragmentationPlanner& planner, uint32_t heap)
+{
+	return std::find(planner.m_evacuatedHeaps.begin(), planner.m_evacuatedHeaps.end(), heap) != planner.m_evacuatedHeaps.end();
+}
+
+static void TestSparseHeapSelection()
+{
+	SHRDefragmentationPlanner planner(0.25f, SHR_TEST_HEAP_SIZE * 4);
+	uint32_t dense = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t sparse = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t empty = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t halfFull = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+
+	planner.AddBlock(dense, 768, GetTag(1));
+	planner.AddBlock(sparse, 64, GetTag(2));
+	planner.AddBlock(sparse, 128, GetTag(3));
+	planner.AddBlock(halfFull, 512, GetTag(4));
+	planner.Plan();
+
+	//only the heap under the threshold is emptied, an empty heap has nothing to move
+	SHR_CHECK_EQUAL(planner.m_evacuatedHeaps.size(), 1);
+	SHR_CHECK(IsEvacuated(planner, sparse));
+	SHR_CHECK(!IsEvacuated(planner, empty));
+	SHR_CHECK_EQUAL(planner.m_plannedBytes, 64 + 128);
+
+	//largest block first, both into the densest heap that has room
+	SHR_CHECK_EQUAL(planner.m_moves.size(), 2);
+	if (planner.m_moves.size() == 2)
+	{
+		SHR_CHECK(planner.m_moves[0].pUserData == GetTag(3));
+		SHR_CHECK(planner.m_moves[1].pUserData == GetTag(2));
+		for (const SHRDefragmentationPlanner::Move& move : planner.m_moves)
+		{
+			SHR_CHECK_EQUAL(move.srcHeap, sparse);
+			SHR_CHECK_EQUAL(move.dstHeap, dense);
+		}
+	}
+
+	//Reset drops the heaps, a plan of nothing moves nothing
+	planner.Reset();
+	planner.Plan();
+	SHR_CHECK(planner.m_heaps.empty());
+	SHR_CHECK(planner.m_moves.empty());
+	SHR_CHECK(planner.m_evacuatedHeaps.empty());
+}
+
+static void TestDestinationIsNotEvacuated()
+{
+	SHRDefragmentationPlanner planner(0.25f, SHR_TEST_HEAP_SIZE * 4);
+	uint32_t sparsest = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t sparse = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+
+	planner.AddBlock(sparsest, 32, GetTag(1));
+	planner.AddBlock(sparse, 128, GetTag(2));
+	planner.Plan();
+
+	//the sparsest goes first and packs into the other one, which then has to stay
+	SHR_CHECK_EQUAL(planner.m_evacuatedHeaps.size(), 1);
+	SHR_CHECK(IsEvacuated(planner, sparsest));
+	SHR_CHECK_EQUAL(planner.m_moves.size(), 1);
+	SHR_CHECK(planner.m_moves.size() == 1 && planner.m_moves[0].dstHeap == sparse);
+}
+
+static void TestFrameByteBudget()
+{
+	SHRDefragmentationPlanner planner(0.25f, 200);
+	uint32_t dense = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t small = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t large = planner.AddHeap(0, SHR_TEST_HEAP_SIZE * 2);		//sparser than medium, so it comes up before it
+	uint32_t medium = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+
+	planner.AddBlock(dense, 512, GetTag(1));
+	planner.AddBlock(small, 64, GetTag(2));
+	planner.AddBlock(large, 250, GetTag(3));
+	planner.AddBlock(medium, 128, GetTag(4));
+	planner.Plan();
+
+	//a heap over the remaining budget is skipped whole, a later one that still fits is taken
+	SHR_CHECK(IsEvacuated(planner, small));
+	SHR_CHECK(IsEvacuated(planner, medium));
+	SHR_CHECK(!IsEvacuated(planner, large));
+	SHR_CHECK_EQUAL(planner.m_plannedBytes, 64 + 128);
+	SHR_CHECK(planner.m_plannedBytes <= planner.m_frameByteBudget);
+
+	uint64_t movedBytes = 0;
+	for (const SHRDefragmentationPlanner::Move& move : planner.m_moves)
+	{
+		SHR_CHECK(move.srcHeap != large);
+		movedBytes += move.size;
+	}
+	SHR_CHECK_EQUAL(movedBytes, planner.m_plannedBytes);
+
+	//the next frame plans again from what is left
+	planner.Reset();
+	dense = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	large = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	planner.AddBlock(dense, 512 + 64 + 128, GetTag(1));
+	planner.AddBlock(large, 250, GetTag(3));
+	planner.Plan();
+	SHR_CHECK(planner.m_evacuatedHeaps.empty());
+
+	planner.m_frameByteBudget = 250;
+	planner.Plan();
+	SHR_CHECK(IsEvacuated(planner, large));
+}
+
+static void TestSameClassDestinations()
+{
+	SHRDefragmentationPlanner planner(0.25f, SHR_TEST_HEAP_SIZE * 4);
+	uint32_t otherClass = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t sparse = planner.AddHeap(1, SHR_TEST_HEAP_SIZE);
+
+	planner.AddBlock(otherClass, 512, GetTag(1));
+	planner.AddBlock(sparse, 64, GetTag(2));
+	planner.AddBlock(sparse, 64, GetTag(3));
+	planner.Plan();
+
+	//the only heap with room is of another class, nothing moves
+	SHR_CHECK(planner.m_evacuatedHeaps.empty());
+	SHR_CHECK(planner.m_moves.empty());
+
+	//a heap of the same class takes the blocks, the denser one of the other class is still never picked
+	uint32_t sameClass = planner.AddHeap(1, SHR_TEST_HEAP_SIZE);
+	planner.AddBlock(sameClass, 300, GetTag(4));
+	planner.Plan();
+
+	SHR_CHECK(IsEvacuated(planner, sparse));
+	SHR_CHECK_EQUAL(planner.m_moves.size(), 2);
+	for (const SHRDefragmentationPlanner::Move& move : planner.m_moves)
+	{
+		SHR_CHECK_EQUAL(move.dstHeap, sameClass);
+		SHR_CHECK_EQUAL(planner.m_heaps[move.dstHeap].heapClass, planner.m_heaps[move.srcHeap].heapClass);
+	}
+}
+
+static void TestHeapMovedWholeOrNotAtAll()
+{
+	SHRDefragmentationPlanner planner(0.25f, SHR_TEST_HEAP_SIZE * 4);
+	uint32_t dense = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+	uint32_t sparse = planner.AddHeap(0, SHR_TEST_HEAP_SIZE);
+
+	//the first block fits the free bytes of the dense heap, the second no longer does
+	planner.AddBlock(dense, SHR_TEST_HEAP_SIZE - 200, GetTag(1));
+	planner.AddBlock(sparse, 150, GetTag(2));
+	planner.AddBlock(sparse, 100, GetTag(3));
+	planner.Plan();
+
+	SHR_CHECK(planner.m_evacuatedHeaps.empty());
+	SHR_CHECK(planner.m_moves.empty());
+	SHR_CHECK_EQUAL(planner.m_plannedBytes, 0);
+}
+
+int main()
+{
+	TestSparseHeapSelection();
+	TestDestinationIsNotEvacuated();
+	TestFrameByteBudget();
+	TestSameClassDestinations();
+	TestHeapMovedWholeOrNotAtAll();
+	return SHRTestResult("SHRDefragmentationPlannerTest");
+}
@@ -0,0 +1,128 @@
+//SHRFencedQueue driven by a fake fence: the CPU signals a value per frame, the GPU completes them later and in order,
+//as ID3D12Fence::GetCompletedValue would report them
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "SHRFencedQueue.h"
+#include "SHRTest.h"
+
+#define SHR_TEST_FRAME_COUNT 3		//frames in flight, as in SHRRenderEngine
+
+class FakeFence
+{
+public:
+	uint64_t Signal() { return ++m_signaledValue; }
+	void Complete(uint64_t value) { if (value > m_completedValue && value <= m_signaledValue) m_completedValue = value; }
+	uint64_t GetCompletedValue() const { return m_completedValue; }
+
+public:
+	uint64_t m_signaledValue = 0;
+	uint64_t m_completedValue = 0;
+};
+
+static void TestReleasedOnlyOnceCompleted()
+{
+	FakeFence fence;
+	SHRFencedQueue<int> queue;
+	std::vector<int> released;
+	auto release = [&released](int item) { released.push_back(item); };
+
+	uint64_t frameFence = fence.m_signaledValue + 1;
+	queue.Push(1, frameFence);
+	queue.Push(2, frameFence);
+	SHR_CHECK_EQUAL(fence.Signal(), frameFence);
+
+	//nothing is released while the frame is still on the GPU
+	queue.Retire(fence.GetCompletedValue(), release);
+	SHR_CHECK(released.empty());
+	SHR_CHECK_EQUAL(queue.Size(), 2);
+	SHR_CHECK_EQUAL(queue.GetOldestFenceValue(), frameFence);
+
+	fence.Complete(frameFence);
+	queue.Retire(fence.GetCompletedValue(), release);
+	SHR_CHECK_EQUAL(released.size(), 2);
+	SHR_CHECK(released.size() == 2 && released[0] == 1 && released[1] == 2);
+	SHR_CHECK(queue.Empty());
+	SHR_CHECK_EQUAL(queue.GetOldestFenceValue(), UINT64_MAX);
+
+	//a second retire at the same value releases nothing twice
+	queue.Retire(fence.GetCompletedValue(), release);
+	SHR_CHECK_EQUAL(released.size(), 2);
+}
+
+static void TestFramesInFlight()
+{
+	FakeFence fence;
+	SHRFencedQueue<uint64_t> queue;
+	std::vector<uint64_t> released;
+
+	//each frame frees one item tagged with its own fence value, the GPU trails SHR_TEST_FRAME_COUNT frames behind
+	const uint64_t frameCount = 32;
+	for (uint64_t frame = 0; frame < frameCount; frame++)
+	{
+		uint64_t frameFence = fence.m_signaledValue + 1;
+		queue.Push(frame, frameFence);
+		fence.Signal();
+
+		if (fence.m_signaledValue > SHR_TEST_FRAME_COUNT) fence.Complete(fence.m_signaledValue - SHR_TEST_FRAME_COUNT);
+
+		queue.Retire(fence.GetCompletedValue(), [&](uint64_t item)
+			{
+				//an item never goes back before the frame that freed it completed
+				SHR_CHECK(item + 1 <= fence.GetCompletedValue());
+				released.push_back(item);
+			});
+
+		SHR_CHECK_EQUAL(queue.Size(), std::min<uint64_t>(frame + 1, SHR_TEST_FRAME_COUNT));
+	}
+
+	SHR_CHECK_EQUAL(released.size(), frameCount - SHR_TEST_FRAME_COUNT);
+	for (size_t i = 0; i < released.size(); i++)
+	{
+		SHR_CHECK_EQUAL(released[i], i);
+	}
+
+	//shutdown waits for the GPU, then everything left goes back
+	queue.RetireAll([&released](uint64_t item) { released.push_back(item); });
+	SHR_CHECK(queue.Empty());
+	SHR_CHECK_EQUAL(released.size(), frameCount);
+	SHR_CHECK(released.size() == frameCount && released.back() == frameCount - 1);
+}
+
+static void TestPartialCompletion()
+{
+	FakeFence fence;
+	SHRFencedQueue<int> queue;
+	int releasedCount = 0;
+	auto release = [&releasedCount](int) { releasedCount++; };
+
+	//several frames worth of frees, the GPU completes them one at a time and skips none
+	for (int frame = 0; frame < 4; frame++)
+	{
+		uint64_t frameFence = fence.m_signaledValue + 1;
+		for (int i = 0; i <= frame; i++) queue.Push(frame, frameFence);
+		fence.Signal();
+	}
+	SHR_CHECK_EQUAL(queue.Size(), 1 + 2 + 3 + 4);
+
+	fence.Complete(2);
+	queue.Retire(fence.GetCompletedValue(), release);
+	SHR_CHECK_EQUAL(releasedCount, 1 + 2);
+	SHR_CHECK_EQUAL(queue.GetOldestFenceValue(), 3);
+
+	//a value passed by the completed one releases everything up to it
+	fence.Complete(4);
+	queue.Retire(fence.GetCompletedValue(), release);
+	SHR_CHECK_EQUAL(releasedCount, 1 + 2 + 3 + 4);
+	SHR_CHECK(queue.Empty());
+}
+
+int main()
+{
+	TestReleasedOnlyOnceCompleted();
+	TestFramesInFlight();
+	TestPartialCompletion();
+	return SHRTestResult("SHRFencedQueueTest");
+}
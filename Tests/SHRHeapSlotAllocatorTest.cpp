@@ -0,0 +1,210 @@
+//SHRHeapSlotAllocator on SHRNullDevice: threads churn single slots through their magazines and ranges through the lock,
+//every slot handed out is claimed in an owner table so a slot given to two holders at once fails the test
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <random>
+
+#include "SHRNullDevice.h"
+#include "SHRHeapSlotAllocator.h"
+#include "SHRTest.h"
+
+#define SHR_TEST_HEAP_SIZE 256
+#define SHR_TEST_MAX_HEAP_COUNT 1024
+#define SHR_TEST_THREAD_COUNT 8
+#define SHR_TEST_ITERATION_COUNT 20000
+#define SHR_TEST_MAX_RANGE 8
+#define SHR_TEST_MAX_LIVE 64			//held per thread before the oldest is freed
+
+//0 while free, else the id of the thread holding the slot
+class SlotOwners
+{
+public:
+	SlotOwners() : m_owners(SHR_TEST_MAX_HEAP_COUNT * SHR_TEST_HEAP_SIZE) {}
+
+	void Claim(const SHRHeapSlotAllocator::HeapSlot& slot, UINT count, uint32_t owner)
+	{
+		uint64_t heap = SHRNullDevice::GetHeapOrdinal(slot.slotHandle);
+		uint64_t first = SHRNullDevice::GetSlotIndex(slot.slotHandle);
+		SHR_CHECK(heap < SHR_TEST_MAX_HEAP_COUNT);
+		SHR_CHECK(first + count <= SHR_TEST_HEAP_SIZE);		//a range never crosses into the next heap
+		if (heap >= SHR_TEST_MAX_HEAP_COUNT || first + count > SHR_TEST_HEAP_SIZE) return;
+
+		for (UINT i = 0; i < count; i++)
+		{
+			uint32_t previous = m_owners[heap * SHR_TEST_HEAP_SIZE + first + i].exchange(owner);
+			SHR_CHECK_EQUAL(previous, 0);
+		}
+	}
+
+	void Release(const SHRHeapSlotAllocator::HeapSlot& slot, UINT count, uint32_t owner)
+	{
+		uint64_t heap = SHRNullDevice::GetHeapOrdinal(slot.slotHandle);
+		uint64_t first = SHRNullDevice::GetSlotIndex(slot.slotHandle);
+		if (heap >= SHR_TEST_MAX_HEAP_COUNT || first + count > SHR_TEST_HEAP_SIZE) return;
+
+		for (UINT i = 0; i < count; i++)
+		{
+			uint32_t previous = m_owners[heap * SHR_TEST_HEAP_SIZE + first + i].exchange(0);
+			SHR_CHECK_EQUAL(previous, owner);
+		}
+	}
+
+private:
+	std::vector<std::atomic<uint32_t>> m_owners;
+};
+
+static void CheckAllSlotsReturned(const SHRHeapSlotAllocator& allocator)
+{
+	for (UINT i = 0; i < allocator.heapMap.size(); i++)
+	{
+		SHR_CHECK_EQUAL(allocator.GetHeapOccupancy(i).first, 0);
+	}
+}
+
+static void TestConcurrentChurn()
+{
+	SHRNullDevice device;
+	SHRHeapSlotAllocator allocator(&device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, SHR_TEST_HEAP_SIZE);
+	SlotOwners owners;
+	uint64_t generation = SHRHeapSlotAllocator::GetFreeGeneration();
+	std::atomic<uint64_t> freeCount = 0;
+
+	std::vector<std::thread> threads;
+	for (uint32_t thread = 0; thread < SHR_TEST_THREAD_COUNT; thread++)
+	{
+		threads.emplace_back([&, thread]()
+			{
+				uint32_t owner = thread + 1;
+				std::mt19937 random(owner);
+				std::vector<std::pair<SHRHeapSlotAllocator::HeapSlot, UINT>> live;
+				uint64_t threadFreeCount = 0;
+
+				for (uint32_t i = 0; i < SHR_TEST_ITERATION_COUNT; i++)
+				{
+					bool full = live.size() >= SHR_TEST_MAX_LIVE;
+					if (!live.empty() && (full || random() % 3 == 0))
+					{
+						//random order, so magazines & heaps see frees out of allocation order
+						size_t index = random() % live.size();
+						std::pair<SHRHeapSlotAllocator::HeapSlot, UINT> entry = live[index];
+						live[index] = live.back();
+						live.pop_back();
+
+						owners.Release(entry.first, entry.second, owner);
+						if (entry.second == 1) allocator.DeallocateSlot(entry.first);
+						else allocator.DeallocateRange(entry.first, entry.second);
+						threadFreeCount++;
+						continue;
+					}
+
+					UINT count = random() % 4 == 0 ? 2 + random() % (SHR_TEST_MAX_RANGE - 1) : 1;
+					SHRHeapSlotAllocator::HeapSlot slot = count == 1 ? allocator.AllocateSlot() : allocator.AllocateRange(count);
+					owners.Claim(slot, count, owner);
+					live.emplace_back(slot, count);
+				}
+
+				for (auto& entry : live)
+				{
+					owners.Release(entry.first, entry.second, owner);
+					if (entry.second == 1) allocator.DeallocateSlot(entry.first);
+					else allocator.DeallocateRange(entry.first, entry.second);
+					threadFreeCount++;
+				}
+				freeCount += threadFreeCount;
+
+				//the magazine goes back when the thread exits
+			});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	CheckAllSlotsReturned(allocator);
+	SHR_CHECK_EQUAL(device.m_createdHeapCount.load(), allocator.heapMap.size());
+	SHR_CHECK(SHRHeapSlotAllocator::GetFreeGeneration() - generation >= freeCount.load());
+}
+
+static void TestThreadCacheFlush()
+{
+	SHRNullDevice device;
+	SHRHeapSlotAllocator allocator(&device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, SHR_TEST_HEAP_SIZE);
+	SlotOwners owners;
+
+	std::vector<SHRHeapSlotAllocator::HeapSlot> slots;
+	for (uint32_t i = 0; i < SHR_SLOT_MAGAZINE_SIZE * 3; i++)
+	{
+		slots.push_back(allocator.AllocateSlot());
+		owners.Claim(slots.back(), 1, 1);
+	}
+
+	uint64_t generation = SHRHeapSlotAllocator::GetFreeGeneration();
+	for (auto& slot : slots)
+	{
+		owners.Release(slot, 1, 1);
+		allocator.DeallocateSlot(slot);
+	}
+	SHR_CHECK_EQUAL(SHRHeapSlotAllocator::GetFreeGeneration() - generation, slots.size());
+
+	//slots sitting in the magazine still count as used until it is flushed
+	SHR_CHECK(allocator.GetHeapOccupancy(0).first > 0);
+	SHR_CHECK(allocator.GetHeapOccupancy(0).first <= SHR_SLOT_MAGAZINE_SIZE);
+	allocator.FlushThreadCache();
+	CheckAllSlotsReturned(allocator);
+
+	//a range of a whole heap fits, one more slot does not
+	SHRHeapSlotAllocator::HeapSlot range = allocator.AllocateRange(SHR_TEST_HEAP_SIZE);
+	owners.Claim(range, SHR_TEST_HEAP_SIZE, 1);
+	owners.Release(range, SHR_TEST_HEAP_SIZE, 1);
+	allocator.DeallocateRange(range, SHR_TEST_HEAP_SIZE);
+
+	bool thrown = false;
+	try
+	{
+		allocator.AllocateRange(SHR_TEST_HEAP_SIZE + 1);
+	}
+	catch (const COMException& exception)
+	{
+		thrown = exception.Error() == E_INVALIDARG;
+	}
+	SHR_CHECK(thrown);
+	CheckAllSlotsReturned(allocator);
+}
+
+static void TestThreadOutlivesAllocator()
+{
+	SHRNullDevice device;
+	std::unique_ptr<SHRHeapSlotAllocator> pAllocator = std::make_unique<SHRHeapSlotAllocator>(&device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, SHR_TEST_HEAP_SIZE);
+	std::atomic<int> stage = 0;
+
+	//the thread fills its magazine, then exits only after the allocator is gone and must not drain into it
+	std::thread thread([&]()
+		{
+			SHRHeapSlotAllocator::HeapSlot slot = pAllocator->AllocateSlot();
+			pAllocator->DeallocateSlot(slot);
+			stage = 1;
+			while (stage != 2) std::this_thread::yield();
+		});
+
+	while (stage != 1) std::this_thread::yield();
+	pAllocator.reset();
+	stage = 2;
+	thread.join();
+
+	//a new allocator, possibly at the same address, starts out with every slot free
+	SHRHeapSlotAllocator allocator(&device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, SHR_TEST_HEAP_SIZE);
+	CheckAllSlotsReturned(allocator);
+}
+
+int main()
+{
+	TestConcurrentChurn();
+	TestThreadCacheFlush();
+	TestThreadOutlivesAllocator();
+	return SHRTestResult("SHRHeapSlotAllocatorTest");
+}
@@ -0,0 +1,249 @@
+//SHRMemoryBudget with SHRSegregatedAllocationManager on SHRNullHeapProvider: every heap the manager grows by is asked
+//for and reported to the budget, as SHRD3D12HeapProvider does with real heaps
+
+#include <cstdint>
+#include <vector>
+
+#include "SHRHeapProvider.h"
+#include "SHRMemoryBudget.h"
+#include "SHRSegregatedAllocationManager.h"
+#include "SHRTest.h"
+
+#define SHR_TEST_HEAP_TYPE 1			//D3D12_HEAP_TYPE_DEFAULT
+#define SHR_TEST_OTHER_HEAP_TYPE 2		//D3D12_HEAP_TYPE_UPLOAD
+#define SHR_TEST_BLOCK_SIZE 256
+#define SHR_TEST_HEAP_SIZE 1024
+
+//return the block, -1 when the budget refused a new heap
+static int32_t Allocate(SHRSegregatedAllocationManager& manager, uint64_t size)
+{
+	auto [heap, block] = manager.CanAllocate(size);
+	if (heap == -1) return -1;
+
+	manager.AllocateBlock(block, size, nullptr);
+	return static_cast<int32_t>(block);
+}
+
+static void TestRefusePolicy()
+{
+	SHRMemoryBudget budget(SHRMemoryBudgetPolicy::Refuse);
+	budget.SetBudget(SHR_TEST_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 3);
+	uint32_t trimCount = 0;
+	budget.AddTrimCallback([&trimCount](uint32_t) { trimCount++; });
+
+	SHRNullHeapProvider provider;
+	provider.SetBudget(&budget, SHR_TEST_HEAP_TYPE);
+	SHRSegregatedAllocationManager manager(&provider, SHR_TEST_BLOCK_SIZE, SHR_TEST_HEAP_SIZE, SHR_TEST_BLOCK_SIZE);
+
+	std::vector<int32_t> blocks;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		blocks.push_back(Allocate(manager, SHR_TEST_HEAP_SIZE));
+		SHR_CHECK(blocks.back() != -1);
+	}
+
+	//a fourth heap is over budget, the policy refuses it without asking anyone to trim
+	SHR_CHECK_EQUAL(Allocate(manager, SHR_TEST_BLOCK_SIZE), -1);
+	SHR_CHECK_EQUAL(Allocate(manager, SHR_TEST_HEAP_SIZE), -1);
+	SHR_CHECK_EQUAL(trimCount, 0);
+
+	const SHRMemoryBudget::Usage& usage = budget.GetUsage(SHR_TEST_HEAP_TYPE);
+	SHR_CHECK_EQUAL(usage.refusedCount, 2);
+	SHR_CHECK_EQUAL(usage.heapCount, 3);
+	SHR_CHECK_EQUAL(usage.committedBytes, SHR_TEST_HEAP_SIZE * 3);
+	SHR_CHECK_EQUAL(provider.m_heaps.size(), 3);
+
+	//other heap types have no budget set and are unlimited
+	SHR_CHECK(budget.RequestCommit(SHR_TEST_OTHER_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 100));
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_OTHER_HEAP_TYPE).refusedCount, 0);
+
+	//space freed inside a heap is reused without a new heap
+	manager.DeallocateBlock(blocks[0]);
+	SHR_CHECK(Allocate(manager, SHR_TEST_HEAP_SIZE) != -1);
+	SHR_CHECK_EQUAL(usage.refusedCount, 2);
+}
+
+static void TestTrimThenFit()
+{
+	SHRMemoryBudget budget(SHRMemoryBudgetPolicy::Trim);
+	budget.SetBudget(SHR_TEST_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 2 + SHR_TEST_BLOCK_SIZE);
+
+	SHRNullHeapProvider provider;
+	provider.SetBudget(&budget, SHR_TEST_HEAP_TYPE);
+	SHRSegregatedAllocationManager manager(&provider, SHR_TEST_BLOCK_SIZE, SHR_TEST_HEAP_SIZE, SHR_TEST_BLOCK_SIZE);
+
+	std::vector<uint32_t> trimmedTypes;
+	budget.AddTrimCallback([&](uint32_t heapType)
+		{
+			trimmedTypes.push_back(heapType);
+			manager.ReleaseEmptyHeaps();
+		});
+
+	int32_t first = Allocate(manager, SHR_TEST_HEAP_SIZE);
+	int32_t second = Allocate(manager, SHR_TEST_HEAP_SIZE);
+	SHR_CHECK(first != -1 && second != -1);
+
+	//nothing is idle, the trim runs but frees nothing and the heap is refused
+	SHR_CHECK_EQUAL(Allocate(manager, SHR_TEST_HEAP_SIZE * 2), -1);
+	SHR_CHECK_EQUAL(trimmedTypes.size(), 1);
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_HEAP_TYPE).refusedCount, 1);
+
+	//the idle heap is released first, then the larger one fits
+	manager.DeallocateBlock(first);
+	SHR_CHECK_EQUAL(Allocate(manager, SHR_TEST_HEAP_SIZE), first);		//a free heap is reused before any trim
+	manager.DeallocateBlock(first);
+	SHR_CHECK(Allocate(manager, SHR_TEST_HEAP_SIZE + SHR_TEST_BLOCK_SIZE) != -1);
+
+	const SHRMemoryBudget::Usage& usage = budget.GetUsage(SHR_TEST_HEAP_TYPE);
+	SHR_CHECK_EQUAL(trimmedTypes.size(), 2);
+	SHR_CHECK(trimmedTypes.size() == 2 && trimmedTypes[1] == SHR_TEST_HEAP_TYPE);
+	SHR_CHECK_EQUAL(usage.refusedCount, 1);
+	SHR_CHECK_EQUAL(usage.heapCount, 2);
+	SHR_CHECK_EQUAL(usage.committedBytes, SHR_TEST_HEAP_SIZE * 2 + SHR_TEST_BLOCK_SIZE);
+	SHR_CHECK_EQUAL(usage.peakCommittedBytes, SHR_TEST_HEAP_SIZE * 2 + SHR_TEST_BLOCK_SIZE);
+	SHR_CHECK_EQUAL(provider.m_committedBytes, usage.committedBytes);
+}
+
+static void TestTrimIsNotReentered()
+{
+	SHRMemoryBudget budget(SHRMemoryBudgetPolicy::Trim);
+	budget.SetBudget(SHR_TEST_HEAP_TYPE, SHR_TEST_HEAP_SIZE);
+	budget.OnCommit(SHR_TEST_HEAP_TYPE, SHR_TEST_HEAP_SIZE);
+
+	//a trim that asks for a heap of its own is refused there instead of trimming again
+	uint32_t firstCount = 0;
+	uint32_t secondCount = 0;
+	bool nestedResult = true;
+	budget.AddTrimCallback([&](uint32_t heapType)
+		{
+			firstCount++;
+			nestedResult = budget.RequestCommit(heapType, SHR_TEST_BLOCK_SIZE);
+		});
+	budget.AddTrimCallback([&](uint32_t heapType)
+		{
+			secondCount++;
+			budget.OnRelease(heapType, SHR_TEST_HEAP_SIZE);
+		});
+
+	SHR_CHECK(budget.RequestCommit(SHR_TEST_HEAP_TYPE, SHR_TEST_BLOCK_SIZE));
+	SHR_CHECK_EQUAL(firstCount, 1);
+	SHR_CHECK_EQUAL(secondCount, 1);
+	SHR_CHECK(!nestedResult);
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_HEAP_TYPE).refusedCount, 1);
+
+	//the guard is cleared again, the next request over budget trims once more and stops at the first that helps
+	budget.OnCommit(SHR_TEST_HEAP_TYPE, SHR_TEST_HEAP_SIZE);
+	SHR_CHECK(budget.RequestCommit(SHR_TEST_HEAP_TYPE, SHR_TEST_BLOCK_SIZE));
+	SHR_CHECK_EQUAL(firstCount, 2);
+	SHR_CHECK_EQUAL(secondCount, 2);
+}
+
+static void TestIdleHeapRelease()
+{
+	SHRMemoryBudget budget;
+	SHRNullHeapProvider provider;
+	provider.SetBudget(&budget, SHR_TEST_HEAP_TYPE);
+	SHRSegregatedAllocationManager manager(&provider, SHR_TEST_BLOCK_SIZE, SHR_TEST_HEAP_SIZE, SHR_TEST_BLOCK_SIZE);
+
+	int32_t kept = Allocate(manager, SHR_TEST_HEAP_SIZE);
+	int32_t idle = Allocate(manager, SHR_TEST_HEAP_SIZE);
+	SHR_CHECK(kept != -1 && idle != -1);
+	manager.DeallocateBlock(idle);
+
+	//the empty heap survives two frames and goes on the third
+	manager.TrimHeaps(3);
+	manager.TrimHeaps(3);
+	SHR_CHECK_EQUAL(manager.m_heapIndices.size(), 2);
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_HEAP_TYPE).heapCount, 2);
+	manager.TrimHeaps(3);
+	SHR_CHECK_EQUAL(manager.m_heapIndices.size(), 1);
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_HEAP_TYPE).heapCount, 1);
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_HEAP_TYPE).committedBytes, SHR_TEST_HEAP_SIZE);
+
+	//a heap used again in between starts counting from zero
+	manager.DeallocateBlock(kept);
+	manager.TrimHeaps(3);
+	manager.TrimHeaps(3);
+	kept = Allocate(manager, SHR_TEST_BLOCK_SIZE);
+	SHR_CHECK(kept != -1);
+	manager.TrimHeaps(3);
+	manager.DeallocateBlock(kept);
+	manager.TrimHeaps(3);
+	manager.TrimHeaps(3);
+	SHR_CHECK_EQUAL(manager.m_heapIndices.size(), 1);
+	manager.TrimHeaps(3);
+	SHR_CHECK_EQUAL(manager.m_heapIndices.size(), 0);
+	SHR_CHECK_EQUAL(budget.GetUsage(SHR_TEST_HEAP_TYPE).committedBytes, 0);
+	SHR_CHECK_EQUAL(provider.m_committedBytes, 0);
+}
+
+static void TestResidencyThresholds()
+{
+	struct Crossing
+	{
+		uint32_t heapType;
+		uint64_t thresholdBytes;
+		uint64_t committedBytes;
+		bool exceeded;
+	};
+
+	SHRMemoryBudget budget;
+	std::vector<Crossing> crossings;
+	budget.SetResidencyCallback([&crossings](uint32_t heapType, uint64_t thresholdBytes, uint64_t committedBytes, bool exceeded)
+		{
+			crossings.push_back({ heapType, thresholdBytes, committedBytes, exceeded });
+		});
+	budget.AddResidencyThreshold(SHR_TEST_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 2);
+	budget.AddResidencyThreshold(SHR_TEST_OTHER_HEAP_TYPE, SHR_TEST_HEAP_SIZE);
+
+	SHRNullHeapProvider provider;
+	provider.SetBudget(&budget, SHR_TEST_HEAP_TYPE);
+	SHRSegregatedAllocationManager manager(&provider, SHR_TEST_BLOCK_SIZE, SHR_TEST_HEAP_SIZE, SHR_TEST_BLOCK_SIZE);
+
+	//crossing upwards fires once, further heaps above the threshold do not
+	std::vector<int32_t> blocks;
+	for (uint32_t i = 0; i < 3; i++) blocks.push_back(Allocate(manager, SHR_TEST_HEAP_SIZE));
+	SHR_CHECK_EQUAL(crossings.size(), 1);
+	if (crossings.size() == 1)
+	{
+		SHR_CHECK_EQUAL(crossings[0].heapType, SHR_TEST_HEAP_TYPE);
+		SHR_CHECK_EQUAL(crossings[0].thresholdBytes, SHR_TEST_HEAP_SIZE * 2);
+		SHR_CHECK_EQUAL(crossings[0].committedBytes, SHR_TEST_HEAP_SIZE * 2);
+		SHR_CHECK(crossings[0].exceeded);
+	}
+
+	//dropping back below fires once the other way
+	for (int32_t block : blocks) manager.DeallocateBlock(block);
+	manager.ReleaseEmptyHeaps();
+	SHR_CHECK_EQUAL(crossings.size(), 2);
+	if (crossings.size() == 2)
+	{
+		SHR_CHECK_EQUAL(crossings[1].heapType, SHR_TEST_HEAP_TYPE);
+		SHR_CHECK_EQUAL(crossings[1].committedBytes, SHR_TEST_HEAP_SIZE);
+		SHR_CHECK(!crossings[1].exceeded);
+	}
+
+	//a threshold added while already above it starts out exceeded and only reports the drop
+	budget.OnCommit(SHR_TEST_OTHER_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 2);
+	SHR_CHECK_EQUAL(crossings.size(), 3);
+	budget.AddResidencyThreshold(SHR_TEST_OTHER_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 2);
+	budget.OnCommit(SHR_TEST_OTHER_HEAP_TYPE, SHR_TEST_HEAP_SIZE);
+	SHR_CHECK_EQUAL(crossings.size(), 3);
+	budget.OnRelease(SHR_TEST_OTHER_HEAP_TYPE, SHR_TEST_HEAP_SIZE * 3);
+	SHR_CHECK_EQUAL(crossings.size(), 5);
+	for (size_t i = 3; i < crossings.size(); i++)
+	{
+		SHR_CHECK_EQUAL(crossings[i].heapType, SHR_TEST_OTHER_HEAP_TYPE);
+		SHR_CHECK(!crossings[i].exceeded);
+	}
+}
+
+int main()
+{
+	TestRefusePolicy();
+	TestTrimThenFit();
+	TestTrimIsNotReentered();
+	TestIdleHeapRelease();
+	TestResidencyThresholds();
+	return SHRTestResult("SHRMemoryBudgetTest");
+}
@@ -0,0 +1,125 @@
+//SHRRingAllocationManager driven by a fake fence: every frame allocates, finishes with the value the CPU signals
+//and retires what the GPU completed, as SHRUploadRingBuffer & SHRDescriptorCache do with the real fence
+
+#include <cstdint>
+
+#include "SHRRingAllocationManager.h"
+#include "SHRTest.h"
+
+#define SHR_TEST_RING_SIZE 1024
+
+class FakeFence
+{
+public:
+	uint64_t Signal() { return ++m_signaledValue; }
+	void Complete(uint64_t value) { if (value > m_completedValue && value <= m_signaledValue) m_completedValue = value; }
+	uint64_t GetCompletedValue() const { return m_completedValue; }
+
+public:
+	uint64_t m_signaledValue = 0;
+	uint64_t m_completedValue = 0;
+};
+
+static void TestFullRing()
+{
+	FakeFence fence;
+	SHRRingAllocationManager ring(SHR_TEST_RING_SIZE);
+
+	for (uint64_t i = 0; i < 4; i++)
+	{
+		SHR_CHECK_EQUAL(ring.Allocate(SHR_TEST_RING_SIZE / 4), i * SHR_TEST_RING_SIZE / 4);
+	}
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), 0);
+	SHR_CHECK_EQUAL(ring.Allocate(1), SHR_RING_INVALID_OFFSET);
+	ring.FinishFrame(fence.Signal());
+
+	//the frame is still on the GPU, nothing comes back
+	ring.Retire(fence.GetCompletedValue());
+	SHR_CHECK_EQUAL(ring.Allocate(1), SHR_RING_INVALID_OFFSET);
+
+	fence.Complete(fence.m_signaledValue);
+	ring.Retire(fence.GetCompletedValue());
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE);
+
+	//an empty ring serves a request of its whole size, one larger never fits
+	SHR_CHECK_EQUAL(ring.Allocate(SHR_TEST_RING_SIZE + 1), SHR_RING_INVALID_OFFSET);
+	SHR_CHECK_EQUAL(ring.Allocate(0), SHR_RING_INVALID_OFFSET);
+	SHR_CHECK_EQUAL(ring.Allocate(SHR_TEST_RING_SIZE), 0);
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), 0);
+}
+
+static void TestWrapAround()
+{
+	FakeFence fence;
+	SHRRingAllocationManager ring(SHR_TEST_RING_SIZE);
+
+	SHR_CHECK_EQUAL(ring.Allocate(600), 0);
+	ring.FinishFrame(fence.Signal());
+	SHR_CHECK_EQUAL(ring.Allocate(300), 600);
+	ring.FinishFrame(fence.Signal());
+
+	fence.Complete(1);
+	ring.Retire(fence.GetCompletedValue());
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE - 300);
+
+	//124 bytes are left before the end, the request restarts at zero and the skipped tail is charged to this frame
+	SHR_CHECK_EQUAL(ring.Allocate(200), 0);
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE - 300 - 124 - 200);
+	SHR_CHECK_EQUAL(ring.Allocate(300), 200);
+	SHR_CHECK_EQUAL(ring.Allocate(100), 500);
+
+	//the next bytes are still used by the second frame
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), 0);
+	SHR_CHECK_EQUAL(ring.Allocate(1), SHR_RING_INVALID_OFFSET);
+	ring.FinishFrame(fence.Signal());
+
+	//the second frame frees its 300 bytes, the skipped tail stays with the third
+	fence.Complete(2);
+	ring.Retire(fence.GetCompletedValue());
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), 300);
+	SHR_CHECK_EQUAL(ring.Allocate(300), 600);
+	ring.FinishFrame(fence.Signal());
+
+	fence.Complete(fence.m_signaledValue);
+	ring.Retire(fence.GetCompletedValue());
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE);
+	SHR_CHECK(ring.m_frameUsedSizes.Empty());
+}
+
+static void TestAlignmentPadding()
+{
+	FakeFence fence;
+	SHRRingAllocationManager ring(SHR_TEST_RING_SIZE);
+
+	SHR_CHECK_EQUAL(ring.Allocate(10), 0);
+	SHR_CHECK_EQUAL(ring.Allocate(16, 256), 256);
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE - 272);
+	SHR_CHECK_EQUAL(ring.Allocate(4, 4), 272);
+
+	//aligned past the end it has to wrap, and the bytes at zero are still in use
+	SHR_CHECK_EQUAL(ring.Allocate(600, 512), SHR_RING_INVALID_OFFSET);
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE - 276);
+	ring.FinishFrame(fence.Signal());
+
+	//padding is freed with the frame that paid for it
+	fence.Complete(fence.m_signaledValue);
+	ring.Retire(fence.GetCompletedValue());
+	SHR_CHECK_EQUAL(ring.GetFreeSize(), SHR_TEST_RING_SIZE);
+
+	//the ring is empty again and starts over at zero, the head left at 276 would have to wrap into the same bytes
+	SHR_CHECK_EQUAL(ring.Allocate(600, 512), 0);
+	for (uint64_t alignment = 1; alignment <= 128; alignment *= 2)
+	{
+		uint64_t offset = ring.Allocate(1, alignment);
+		SHR_CHECK(offset != SHR_RING_INVALID_OFFSET);
+		SHR_CHECK_EQUAL(offset % alignment, 0);
+	}
+}
+
+int main()
+{
+	TestFullRing();
+	TestWrapAround();
+	TestAlignmentPadding();
+	return SHRTestResult("SHRRingAllocationManagerTest");
+}
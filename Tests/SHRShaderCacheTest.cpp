@@ -0,0 +1,263 @@
+//SHRShaderCache & the cache key without a compiler: entries are written to a scratch directory and read back,
+//includes are resolved through a stub SHRShaderSourceReader that serves the shader text from memory
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <unordered_map>
+
+#include "SHRShaderCache.h"
+#include "SHRTest.h"
+
+#define SHR_TEST_KEY 0x0123456789abcdefULL
+#define SHR_TEST_OTHER_KEY 0xfedcba9876543210ULL
+#define SHR_TEST_VERSION_OFFSET 4		//magic, then version in SHRShaderCacheHeader
+
+//shader files that only exist in memory, every read is recorded
+class StubSources
+{
+public:
+	StubSources(const std::filesystem::path& root) : m_root(root) {}
+
+	void Add(const std::string& name, const std::string& text) { m_files[(m_root / name).lexically_normal()] = text; }
+
+	SHRShaderSourceReader GetReader()
+	{
+		return [this](const std::filesystem::path& path, std::string& text)
+		{
+			m_readPaths.push_back(path);
+			auto it = m_files.find(path.lexically_normal());
+			if (it == m_files.end()) return false;
+
+			text = it->second;
+			return true;
+		};
+	}
+
+public:
+	std::filesystem::path m_root;
+	std::map<std::filesystem::path, std::string> m_files;
+	std::vector<std::filesystem::path> m_readPaths;
+};
+
+static SHRShaderCacheEntry MakeEntry()
+{
+	SHRShaderCacheEntry entry;
+	for (uint32_t i = 0; i < 300; i++) entry.bytecode.push_back(static_cast<uint8_t>(i * 7));
+	for (uint32_t i = 0; i < 16; i++) entry.shaderHash[i] = static_cast<uint8_t>(0xa0 + i);
+	entry.resources.push_back({ "g_constants", 0, 0, 1, 0 });
+	entry.resources.push_back({ "g_textures", 1, 2, 8, 1 });
+	entry.resources.push_back({ "", 5, 0, 1, 0 });
+	entry.inputElements.push_back({ "POSITION", 0, 6 });
+	entry.inputElements.push_back({ "TEXCOORD", 1, 16 });
+	return entry;
+}
+
+static std::vector<char> ReadFileBytes(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteFileBytes(const std::filesystem::path& path, const std::vector<char>& bytes)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(bytes.data(), bytes.size());
+}
+
+static void TestRoundTrip(const std::filesystem::path& directory)
+{
+	SHRShaderCache cache(directory);
+	SHRShaderCacheEntry stored = MakeEntry();
+	SHR_CHECK(cache.Store(SHR_TEST_KEY, stored));
+	SHR_CHECK(std::filesystem::exists(cache.GetEntryPath(SHR_TEST_KEY)));
+
+	SHRShaderCacheEntry loaded;
+	SHR_CHECK(cache.Load(SHR_TEST_KEY, loaded));
+	SHR_CHECK(loaded.bytecode == stored.bytecode);
+	SHR_CHECK(memcmp(loaded.shaderHash, stored.shaderHash, sizeof(stored.shaderHash)) == 0);
+
+	SHR_CHECK_EQUAL(loaded.resources.size(), stored.resources.size());
+	for (size_t i = 0; i < loaded.resources.size() && i < stored.resources.size(); i++)
+	{
+		SHR_CHECK(loaded.resources[i].name == stored.resources[i].name);
+		SHR_CHECK_EQUAL(loaded.resources[i].type, stored.resources[i].type);
+		SHR_CHECK_EQUAL(loaded.resources[i].bindPoint, stored.resources[i].bindPoint);
+		SHR_CHECK_EQUAL(loaded.resources[i].bindCount, stored.resources[i].bindCount);
+		SHR_CHECK_EQUAL(loaded.resources[i].space, stored.resources[i].space);
+	}
+
+	SHR_CHECK_EQUAL(loaded.inputElements.size(), stored.inputElements.size());
+	for (size_t i = 0; i < loaded.inputElements.size() && i < stored.inputElements.size(); i++)
+	{
+		SHR_CHECK(loaded.inputElements[i].semanticName == stored.inputElements[i].semanticName);
+		SHR_CHECK_EQUAL(loaded.inputElements[i].semanticIndex, stored.inputElements[i].semanticIndex);
+		SHR_CHECK_EQUAL(loaded.inputElements[i].format, stored.inputElements[i].format);
+	}
+
+	//a store over an existing entry replaces it
+	stored.bytecode.resize(4);
+	SHR_CHECK(cache.Store(SHR_TEST_KEY, stored));
+	SHR_CHECK(cache.Load(SHR_TEST_KEY, loaded));
+	SHR_CHECK(loaded.bytecode == stored.bytecode);
+
+	SHR_CHECK_EQUAL(cache.m_hitCount.load(), 2);
+	SHR_CHECK_EQUAL(cache.m_missCount.load(), 0);
+
+	//no temporary file is left behind
+	size_t fileCount = 0;
+	for (auto& file : std::filesystem::directory_iterator(directory))
+	{
+		SHR_CHECK(file.path().extension() == SHR_SHADER_CACHE_EXTENSION);
+		fileCount++;
+	}
+	SHR_CHECK_EQUAL(fileCount, 1);
+}
+
+static void TestRejectedFiles(const std::filesystem::path& directory)
+{
+	SHRShaderCache cache(directory);
+	SHR_CHECK(cache.Store(SHR_TEST_KEY, MakeEntry()));
+	std::filesystem::path path = cache.GetEntryPath(SHR_TEST_KEY);
+	std::vector<char> bytes = ReadFileBytes(path);
+	SHR_CHECK(bytes.size() > SHR_TEST_VERSION_OFFSET + sizeof(uint32_t));
+
+	SHRShaderCacheEntry loaded;
+	SHR_CHECK(!cache.Load(SHR_TEST_OTHER_KEY, loaded));
+
+	//cut anywhere, the header, the bytecode or the middle of a name
+	uint64_t rejectedCount = 0;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		WriteFileBytes(path, std::vector<char>(bytes.begin(), bytes.begin() + size));
+		if (!cache.Load(SHR_TEST_KEY, loaded)) rejectedCount++;
+	}
+	SHR_CHECK_EQUAL(rejectedCount, bytes.size());
+
+	//another version
+	std::vector<char> otherVersion = bytes;
+	uint32_t version = SHR_SHADER_CACHE_VERSION + 1;
+	memcpy(&otherVersion[SHR_TEST_VERSION_OFFSET], &version, sizeof(version));
+	WriteFileBytes(path, otherVersion);
+	SHR_CHECK(!cache.Load(SHR_TEST_KEY, loaded));
+
+	//another key, the file of one entry copied over the name of another
+	WriteFileBytes(cache.GetEntryPath(SHR_TEST_OTHER_KEY), bytes);
+	SHR_CHECK(!cache.Load(SHR_TEST_OTHER_KEY, loaded));
+
+	//a count that does not fit the file must not be trusted to size anything
+	std::vector<char> hugeCount = bytes;
+	memset(&hugeCount[SHR_TEST_VERSION_OFFSET + sizeof(uint32_t) + sizeof(uint64_t)], 0xff, sizeof(uint64_t));
+	WriteFileBytes(path, hugeCount);
+	SHR_CHECK(!cache.Load(SHR_TEST_KEY, loaded));
+
+	//the intact file still loads, unless the cache is off
+	WriteFileBytes(path, bytes);
+	SHR_CHECK(cache.Load(SHR_TEST_KEY, loaded));
+	cache.m_enabled = false;
+	SHR_CHECK(!cache.Load(SHR_TEST_KEY, loaded));
+	SHR_CHECK(!cache.Store(SHR_TEST_KEY, loaded));
+
+	SHR_CHECK_EQUAL(cache.m_hitCount.load(), 1);
+	SHR_CHECK_EQUAL(cache.m_missCount.load(), 1 + bytes.size() + 3);
+}
+
+static void TestKeyStability()
+{
+	std::vector<std::wstring> flags = { L"-O3", L"-Zpr" };
+
+	std::unordered_map<std::wstring, std::wstring> defines;
+	defines[L"USE_SHADOWS"] = L"1";
+	defines[L"LIGHT_COUNT"] = L"4";
+	defines[L"QUALITY"] = L"HIGH";
+
+	//same defines, other insertion order and bucket count
+	std::unordered_map<std::wstring, std::wstring> reordered(64);
+	reordered[L"QUALITY"] = L"HIGH";
+	reordered[L"USE_SHADOWS"] = L"1";
+	reordered[L"LIGHT_COUNT"] = L"4";
+
+	uint64_t key = SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", flags, defines);
+	SHR_CHECK_EQUAL(SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", flags, reordered), key);
+	SHR_CHECK_EQUAL(SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", flags, defines), key);
+
+	//every input moves the key
+	reordered[L"LIGHT_COUNT"] = L"8";
+	SHR_CHECK(SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", flags, reordered) != key);
+	SHR_CHECK(SHRComputeShaderCacheKey(2, L"PSMain", L"ps_6_0", flags, defines) != key);
+	SHR_CHECK(SHRComputeShaderCacheKey(1, L"VSMain", L"ps_6_0", flags, defines) != key);
+	SHR_CHECK(SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_6", flags, defines) != key);
+	SHR_CHECK(SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", { L"-O3" }, defines) != key);
+
+	//a define name & value split differently is another define
+	std::unordered_map<std::wstring, std::wstring> split = { { L"AB", L"C" } };
+	std::unordered_map<std::wstring, std::wstring> otherSplit = { { L"A", L"BC" } };
+	SHR_CHECK(SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", flags, split) != SHRComputeShaderCacheKey(1, L"PSMain", L"ps_6_0", flags, otherSplit));
+}
+
+static void TestIncludeResolution(const std::filesystem::path& root)
+{
+	StubSources sources(root);
+	sources.Add("main.hlsl", "#include \"common.hlsl\"\n  #  include <lighting/brdf.hlsl>\n#include \"missing.hlsl\"\nfloat4 PSMain() : SV_Target { return 0; }\n");
+	sources.Add("common.hlsl", "#pragma once\nstatic const float PI = 3.14159f;\n");
+	//next to itself, then up a directory, then only found next to main.hlsl
+	sources.Add("lighting/brdf.hlsl", "#include \"../common.hlsl\"\n#include \"constants.hlsl\"\n");
+	sources.Add("constants.hlsl", "//#include \"commented.hlsl\" is not an include\n#define SHR_LIGHT_COUNT 4\n");
+
+	std::filesystem::path mainPath = root / "main.hlsl";
+	std::vector<std::filesystem::path> includes;
+	SHRResolveShaderIncludes(mainPath, includes, sources.GetReader());
+
+	//depth first, common.hlsl only once, missing.hlsl skipped
+	SHR_CHECK_EQUAL(includes.size(), 3);
+	if (includes.size() == 3)
+	{
+		SHR_CHECK(includes[0] == (root / "common.hlsl").lexically_normal());
+		SHR_CHECK(includes[1] == (root / "lighting/brdf.hlsl").lexically_normal());
+		SHR_CHECK(includes[2] == (root / "constants.hlsl").lexically_normal());
+	}
+	for (auto& path : sources.m_readPaths)
+	{
+		SHR_CHECK(path.filename() != "commented.hlsl");
+	}
+
+	//the hash reads through the same stub, only a change of text moves it
+	uint64_t hash = 0;
+	SHR_CHECK(SHRHashShaderSources(mainPath, sources.GetReader(), hash));
+	uint64_t sameHash = 0;
+	SHR_CHECK(SHRHashShaderSources(mainPath, sources.GetReader(), sameHash));
+	SHR_CHECK_EQUAL(sameHash, hash);
+
+	sources.Add("constants.hlsl", "#define SHR_LIGHT_COUNT 8\n");
+	uint64_t changedHash = 0;
+	SHR_CHECK(SHRHashShaderSources(mainPath, sources.GetReader(), changedHash));
+	SHR_CHECK(changedHash != hash);
+
+	//an unreadable source has no hash and no includes
+	uint64_t missingHash = 0;
+	SHR_CHECK(!SHRHashShaderSources(root / "other.hlsl", sources.GetReader(), missingHash));
+	SHRResolveShaderIncludes(root / "other.hlsl", includes, sources.GetReader());
+	SHR_CHECK(includes.empty());
+}
+
+int main()
+{
+	std::error_code ec;
+	std::filesystem::path tempDirectory = std::filesystem::weakly_canonical(std::filesystem::temp_directory_path(ec), ec);
+	std::filesystem::path directory = tempDirectory / "shr_shader_cache_test";
+	std::filesystem::remove_all(directory, ec);
+
+	TestRoundTrip(directory / "round_trip");
+	TestRejectedFiles(directory / "rejected");
+	TestKeyStability();
+	//never created, the stub is the only place these files exist
+	TestIncludeResolution(directory / "stub_sources");
+
+	std::filesystem::remove_all(directory, ec);
+	return SHRTestResult("SHRShaderCacheTest");
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdio>
+
+//minimal checks for the headless tests, a failed check is reported and the test keeps going so one run shows every failure
+static int g_shrTestFailureCount = 0;
+
+#define SHR_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			g_shrTestFailureCount++; \
+		} \
+	} while (0)
+
+//compared as unsigned 64 bit integers, enough for the counts, sizes & fence values checked here
+#define SHR_CHECK_EQUAL(actual, expected) \
+	do \
+	{ \
+		unsigned long long actualValue = (unsigned long long)(actual); \
+		unsigned long long expectedValue = (unsigned long long)(expected); \
+		if (actualValue != expectedValue) \
+		{ \
+			printf("%s(%d): check failed: %s == %s (%llu != %llu)\n", __FILE__, __LINE__, #actual, #expected, actualValue, expectedValue); \
+			g_shrTestFailureCount++; \
+		} \
+	} while (0)
+
+//return value of main
+inline int SHRTestResult(const char* name)
+{
+	if (g_shrTestFailureCount) printf("%s: %d checks failed\n", name, g_shrTestFailureCount);
+	else printf("%s: passed\n", name);
+	return g_shrTestFailureCount ? 1 : 0;
+}
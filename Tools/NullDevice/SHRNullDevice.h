@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+
+#include <windows.h>
+#include <d3d12.h>
+
+#define SHR_NULL_DEVICE_INCREMENT_SIZE 32
+#define SHR_NULL_DEVICE_HEAP_SPACING_LOG2 32		//heap i starts at (i + 1) << 32
+
+//descriptor heap without memory behind it, handles are only ever compared & offset
+class SHRNullDescriptorHeap : public ID3D12DescriptorHeap
+{
+public:
+	SHRNullDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc, SIZE_T heapStart) : m_desc(desc), m_heapStart(heapStart) {}
+
+	D3D12_DESCRIPTOR_HEAP_DESC STDMETHODCALLTYPE GetDesc() { return m_desc; }
+	D3D12_CPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetCPUDescriptorHandleForHeapStart() { return { m_heapStart }; }
+
+	ULONG STDMETHODCALLTYPE AddRef() { return ++m_refCount; }
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		ULONG refCount = --m_refCount;
+		if (refCount == 0) delete this;
+		return refCount;
+	}
+
+public:
+	D3D12_DESCRIPTOR_HEAP_DESC m_desc;
+	SIZE_T m_heapStart;
+
+private:
+	std::atomic<ULONG> m_refCount = 1;
+};
+
+//the device calls of SHRHeapSlotAllocator, heaps are spaced so a handle alone tells its heap & slot
+class SHRNullDevice : public ID3D12Device
+{
+public:
+	HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID, void** ppvHeap)
+	{
+		if (!pDescriptorHeapDesc || !ppvHeap || pDescriptorHeapDesc->NumDescriptors == 0) return E_INVALIDARG;
+
+		SIZE_T heapStart = static_cast<SIZE_T>(m_createdHeapCount.fetch_add(1) + 1) << SHR_NULL_DEVICE_HEAP_SPACING_LOG2;
+		*ppvHeap = static_cast<ID3D12DescriptorHeap*>(new (std::nothrow) SHRNullDescriptorHeap(*pDescriptorHeapDesc, heapStart));
+		return *ppvHeap ? S_OK : E_OUTOFMEMORY;
+	}
+
+	UINT STDMETHODCALLTYPE GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE) { return SHR_NULL_DEVICE_INCREMENT_SIZE; }
+
+	//lives on the stack of the test, never released through COM
+	ULONG STDMETHODCALLTYPE AddRef() { return 1; }
+	ULONG STDMETHODCALLTYPE Release() { return 1; }
+
+	//heap & slot a handle was handed out for
+	static uint64_t GetHeapOrdinal(D3D12_CPU_DESCRIPTOR_HANDLE handle) { return (handle.ptr >> SHR_NULL_DEVICE_HEAP_SPACING_LOG2) - 1; }
+	static uint64_t GetSlotIndex(D3D12_CPU_DESCRIPTOR_HANDLE handle) { return (handle.ptr & ((1ULL << SHR_NULL_DEVICE_HEAP_SPACING_LOG2) - 1)) / SHR_NULL_DEVICE_INCREMENT_SIZE; }
+
+public:
+	std::atomic<uint32_t> m_createdHeapCount = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+//stand in for the descriptor heap part of d3d12.h, see windows.h in this directory. the members keep their d3d12.h
+//names & order but only the calls SHRHeapSlotAllocator makes are declared
+
+#include <windows.h>
+
+enum D3D12_DESCRIPTOR_HEAP_TYPE
+{
+	D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV = 0,
+	D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+	D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+	D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
+	D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES
+};
+
+enum D3D12_DESCRIPTOR_HEAP_FLAGS
+{
+	D3D12_DESCRIPTOR_HEAP_FLAG_NONE = 0,
+	D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE = 0x1
+};
+
+struct D3D12_DESCRIPTOR_HEAP_DESC
+{
+	D3D12_DESCRIPTOR_HEAP_TYPE Type;
+	UINT NumDescriptors;
+	D3D12_DESCRIPTOR_HEAP_FLAGS Flags;
+	UINT NodeMask;
+};
+
+struct D3D12_CPU_DESCRIPTOR_HANDLE
+{
+	SIZE_T ptr;
+};
+
+struct ID3D12DescriptorHeap : public IUnknown
+{
+	virtual D3D12_DESCRIPTOR_HEAP_DESC STDMETHODCALLTYPE GetDesc() = 0;
+	virtual D3D12_CPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetCPUDescriptorHandleForHeapStart() = 0;
+};
+
+struct ID3D12Device : public IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, void** ppvHeap) = 0;
+	virtual UINT STDMETHODCALLTYPE GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) = 0;
+};
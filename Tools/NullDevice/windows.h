@@ -0,0 +1,51 @@
+#pragma once
+
+//stand in for the Windows SDK headers, just enough for the descriptor slot allocator to build against SHRNullDevice
+//on Linux. only the Linux tests & benchmarks put this directory on the include path, never the renderer
+
+#include <cstdint>
+#include <cstddef>
+
+typedef int32_t HRESULT;
+typedef int32_t INT;
+typedef uint32_t UINT;
+typedef uint64_t UINT64;
+typedef uint32_t ULONG;
+typedef size_t SIZE_T;
+
+#define S_OK ((HRESULT)0)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_NOINTERFACE ((HRESULT)0x80004002L)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define STDMETHODCALLTYPE
+
+struct GUID
+{
+	uint32_t data1;
+	uint16_t data2;
+	uint16_t data3;
+	uint8_t data4[8];
+};
+typedef const GUID& REFIID;
+
+//interface ids are not checked by the null device, every interface shares one
+inline REFIID SHRNullInterfaceId()
+{
+	static const GUID id = {};
+	return id;
+}
+
+#define IID_PPV_ARGS(ppType) SHRNullInterfaceId(), reinterpret_cast<void**>(ppType)
+
+struct IUnknown
+{
+	virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+	virtual ULONG STDMETHODCALLTYPE Release() = 0;
+
+protected:
+	virtual ~IUnknown() = default;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+//stand in for Microsoft::WRL::ComPtr, see windows.h in this directory
+
+#include <utility>
+
+#include <windows.h>
+
+namespace Microsoft
+{
+namespace WRL
+{
+
+template <typename T>
+class ComPtr
+{
+public:
+	ComPtr() = default;
+	ComPtr(T* pObject) : m_pObject(pObject) { if (m_pObject) m_pObject->AddRef(); }
+	ComPtr(const ComPtr& other) : ComPtr(other.m_pObject) {}
+	ComPtr(ComPtr&& other) noexcept : m_pObject(other.m_pObject) { other.m_pObject = nullptr; }
+	~ComPtr() { Reset(); }
+
+	ComPtr& operator=(ComPtr other) noexcept
+	{
+		std::swap(m_pObject, other.m_pObject);
+		return *this;
+	}
+
+	T* Get() const { return m_pObject; }
+	T* operator->() const { return m_pObject; }
+	explicit operator bool() const { return m_pObject != nullptr; }
+
+	//releases the current object, the pointer is then written by the callee
+	T** operator&()
+	{
+		Reset();
+		return &m_pObject;
+	}
+
+	void Attach(T* pObject)
+	{
+		Reset();
+		m_pObject = pObject;
+	}
+
+	T* Detach()
+	{
+		T* pObject = m_pObject;
+		m_pObject = nullptr;
+		return pObject;
+	}
+
+	void Reset()
+	{
+		if (m_pObject) m_pObject->Release();
+		m_pObject = nullptr;
+	}
+
+private:
+	T* m_pObject = nullptr;
+};
+
+}
+}
@@ -0,0 +1,109 @@
+#include "SHRLegacyBuddyAllocationManager.h"
+
+SHRLegacyBuddyAllocationManager::SHRLegacyBuddyAllocationManager(SHRHeapProvider* pProvider, uint64_t heapSize, uint64_t blockSize, uint64_t alignment)
+{
+	m_pProvider = pProvider;
+	m_heapSize = heapSize;
+	m_blockSize = blockSize;
+
+	uint64_t blockNum = m_heapSize / m_blockSize;
+	m_blockStates.assign(2 * blockNum - 1, 1);
+
+	m_heapIndex = m_pProvider->CreateHeap(m_heapSize, alignment);
+}
+
+std::pair<int32_t, uint32_t> SHRLegacyBuddyAllocationManager::CanAllocate(uint64_t size)
+{
+	if (m_heapSize < size) return { -1,0 };
+
+	int layer = 0;
+	while ((m_heapSize >> layer) >= size && (m_heapSize >> layer) >= m_blockSize)
+	{
+		layer++;
+	}
+	layer -= 1;
+
+	uint32_t baseOffset = (1 << layer) - 1;
+	for (uint32_t offset = 0; offset < (1ULL << layer); offset++)
+	{
+		if (m_blockStates[offset + baseOffset])
+		{
+			return { layer, offset };
+		}
+	}
+	return { -1,0 };
+}
+
+void SHRLegacyBuddyAllocationManager::AllocateBlock(uint32_t layer, uint32_t offset)
+{
+	uint32_t baseOffset = (1 << layer) - 1;
+	uint32_t realOffset = offset + baseOffset;
+
+	uint32_t parentOffset = realOffset;
+	while (parentOffset > 0)
+	{
+		m_blockStates[parentOffset] = 0;
+		parentOffset = (parentOffset - 1) >> 1;
+	}
+	m_blockStates[parentOffset] = 0;
+
+	uint32_t rangeBegin = realOffset * 2 + 1;
+	uint32_t rangeEnd = realOffset * 2 + 2;
+	while (rangeEnd < m_blockStates.size())
+	{
+		for (uint32_t it = 0; rangeBegin + it <= rangeEnd; it++)
+		{
+			m_blockStates[rangeBegin + it] = 0;
+		}
+		rangeBegin = rangeBegin * 2 + 1;
+		rangeEnd = rangeEnd * 2 + 2;
+	}
+
+	m_pProvider->OnAllocate(m_heapIndex, (m_heapSize >> layer) * offset, m_heapSize >> layer);
+}
+
+void SHRLegacyBuddyAllocationManager::DeallocateBlock(uint64_t layer, uint64_t offset)
+{
+	uint32_t baseOffset = (1 << layer) - 1;
+	uint32_t realOffset = static_cast<uint32_t>(offset) + baseOffset;
+
+	m_blockStates[realOffset] = 1;
+
+	//the root is never merged back, as in the original. freeing the root itself read past the tree there
+	uint32_t parentOffset = realOffset ? (realOffset - 1) >> 1 : 0;
+	while (parentOffset)
+	{
+		if (m_blockStates[parentOffset * 2 + 1] && m_blockStates[parentOffset * 2 + 2])
+		{
+			m_blockStates[parentOffset] = 1;
+		}
+		parentOffset = (parentOffset - 1) >> 1;
+	}
+
+	uint32_t rangeBegin = realOffset * 2 + 1;
+	uint32_t rangeEnd = realOffset * 2 + 2;
+	while (rangeEnd < m_blockStates.size())
+	{
+		for (uint32_t it = 0; rangeBegin + it <= rangeEnd; it++)
+		{
+			m_blockStates[rangeBegin + it] = 1;
+		}
+		rangeBegin = rangeBegin * 2 + 1;
+		rangeEnd = rangeEnd * 2 + 2;
+	}
+
+	m_pProvider->OnFree(m_heapIndex, (m_heapSize >> layer) * offset, m_heapSize >> layer);
+}
+
+uint64_t SHRLegacyBuddyAllocationManager::GetLargestFreeBlock() const
+{
+	for (uint64_t layer = 0; (m_heapSize >> layer) >= m_blockSize; layer++)
+	{
+		uint64_t baseOffset = (1ULL << layer) - 1;
+		for (uint64_t offset = 0; offset < (1ULL << layer); offset++)
+		{
+			if (m_blockStates[baseOffset + offset]) return m_heapSize >> layer;
+		}
+	}
+	return 0;
+}
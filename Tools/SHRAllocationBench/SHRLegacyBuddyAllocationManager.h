@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "SHRHeapProvider.h"
+
+//the tree walk SHRBuddyAllocator used before the per layer free lists (4b82890), kept only as the baseline of shr_alloc_bench.
+//the search scans every node of the target layer, allocate & free rewrite every descendant layer by layer
+class SHRLegacyBuddyAllocationManager
+{
+public:
+	SHRLegacyBuddyAllocationManager(SHRHeapProvider* pProvider, uint64_t heapSize, uint64_t blockSize, uint64_t alignment);
+	~SHRLegacyBuddyAllocationManager() = default;
+
+	std::pair<int32_t, uint32_t> CanAllocate(uint64_t size);					//return {layer, offset}
+	void AllocateBlock(uint32_t layer, uint32_t offset);
+	void DeallocateBlock(uint64_t layer, uint64_t offset);
+
+	//scans the layers top down, only for the untimed fragmentation samples
+	uint64_t GetLargestFreeBlock() const;
+
+public:
+	//valid == 1 means the node and everything below it is free
+	std::vector<uint32_t> m_blockStates;
+
+	uint64_t m_heapSize = 0;
+	uint64_t m_blockSize = 0;
+	uint32_t m_heapIndex = 0;
+
+private:
+	SHRHeapProvider* m_pProvider = nullptr;
+};
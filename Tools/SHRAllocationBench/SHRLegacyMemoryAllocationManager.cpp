@@ -0,0 +1,82 @@
+#include <iterator>
+
+#include "SHRLegacyMemoryAllocationManager.h"
+
+SHRLegacyMemoryAllocationManager::SHRLegacyMemoryAllocationManager(SHRHeapProvider* pProvider, size_t totalSize, size_t alignment)
+{
+	AddNewFreeBlock(0, totalSize);
+
+	m_freeSize = totalSize;
+	m_pProvider = pProvider;
+	m_heapIndex = m_pProvider->CreateHeap(totalSize, alignment);
+}
+
+size_t SHRLegacyMemoryAllocationManager::Allocate(size_t size)
+{
+	if (!CanAllocate(size)) return SIZE_MAX;
+
+	//enough free bytes can still be split over blocks that are all too small, the original dereferenced end() there
+	SHRFreeBlockBySizeMap::iterator itBySize = m_freeBlocksBySize.lower_bound(size);
+	if (itBySize == m_freeBlocksBySize.end()) return SIZE_MAX;
+	SHRFreeBlocksByOffsetMap::iterator itByOffset = itBySize->second;
+
+	size_t newOffset = itByOffset->first;
+	size_t newSize = itByOffset->second.size - size;
+
+	m_freeBlocksByOffset.erase(itByOffset);
+	m_freeBlocksBySize.erase(itBySize);
+	//the original put the remainder back at the block's own offset, so it overlapped the allocation
+	if (newSize > 0)
+	{
+		AddNewFreeBlock(newOffset + size, newSize);
+	}
+	m_freeSize -= size;
+	m_pProvider->OnAllocate(m_heapIndex, newOffset, size);
+	return newOffset;
+}
+
+void SHRLegacyMemoryAllocationManager::Free(size_t offset, size_t size)
+{
+	//the original took the neighbours as itNext-- and so swapped them, no block was ever merged. the baseline merges
+	//as intended, it is meant to time the two trees and not a leak of free blocks
+	auto itNextByOffset = m_freeBlocksByOffset.upper_bound(offset);
+	auto itPrevByOffset = itNextByOffset == m_freeBlocksByOffset.begin() ? m_freeBlocksByOffset.end() : std::prev(itNextByOffset);
+
+	size_t newOffset, newSize;
+	if (itPrevByOffset != m_freeBlocksByOffset.end() && itPrevByOffset->first + itPrevByOffset->second.size == offset)
+	{
+		newOffset = itPrevByOffset->first;
+		newSize = itPrevByOffset->second.size + size;
+		m_freeBlocksBySize.erase(itPrevByOffset->second.bySizeIt);
+		m_freeBlocksByOffset.erase(itPrevByOffset);
+		if (itNextByOffset != m_freeBlocksByOffset.end() && offset + size == itNextByOffset->first)
+		{
+			newSize += itNextByOffset->second.size;
+			m_freeBlocksBySize.erase(itNextByOffset->second.bySizeIt);
+			m_freeBlocksByOffset.erase(itNextByOffset);
+		}
+	}
+	else if (itNextByOffset != m_freeBlocksByOffset.end() && offset + size == itNextByOffset->first)
+	{
+		newOffset = offset;
+		newSize = size + itNextByOffset->second.size;
+		m_freeBlocksBySize.erase(itNextByOffset->second.bySizeIt);
+		m_freeBlocksByOffset.erase(itNextByOffset);
+	}
+	else
+	{
+		newOffset = offset;
+		newSize = size;
+	}
+
+	AddNewFreeBlock(newOffset, newSize);
+	m_freeSize += size;
+	m_pProvider->OnFree(m_heapIndex, offset, size);
+}
+
+void SHRLegacyMemoryAllocationManager::AddNewFreeBlock(size_t offset, size_t size)
+{
+	auto itByOffset = m_freeBlocksByOffset.emplace(offset, size);
+	auto itBySize = m_freeBlocksBySize.emplace(size, itByOffset.first);
+	itByOffset.first->second.bySizeIt = itBySize;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <map>
+#include <cstddef>
+#include <cstdint>
+
+#include "SHRHeapProvider.h"
+
+//the free block allocator SHRMemoryAllocationManager was before the pooled nodes & size classes (694658a), kept only as the
+//baseline of shr_alloc_bench. free blocks sit in a std::map by offset and a std::multimap by size, best fit, no alignment
+class SHRLegacyMemoryAllocationManager
+{
+public:
+	struct FreeBlockInfo;
+
+	using SHRFreeBlocksByOffsetMap = std::map<size_t, FreeBlockInfo>;
+	using SHRFreeBlockBySizeMap = std::multimap<size_t, SHRFreeBlocksByOffsetMap::iterator>;
+
+	struct FreeBlockInfo
+	{
+		size_t size;
+		SHRFreeBlockBySizeMap::iterator bySizeIt;
+
+		FreeBlockInfo(size_t s) : size(s) {};
+	};
+
+public:
+	SHRLegacyMemoryAllocationManager(SHRHeapProvider* pProvider, size_t totalSize, size_t alignment);
+	~SHRLegacyMemoryAllocationManager() = default;
+
+	size_t Allocate(size_t size);				//SIZE_MAX on failure
+	void Free(size_t offset, size_t size);
+
+	bool CanAllocate(size_t requiredSize) const { return m_freeSize >= requiredSize; }
+
+	//the last entry by size, only for the untimed fragmentation samples
+	size_t GetLargestFreeBlock() const { return m_freeBlocksBySize.empty() ? 0 : m_freeBlocksBySize.rbegin()->first; }
+
+private:
+	void AddNewFreeBlock(size_t offset, size_t size);
+
+public:
+	size_t m_freeSize;
+	SHRFreeBlocksByOffsetMap m_freeBlocksByOffset;
+	SHRFreeBlockBySizeMap m_freeBlocksBySize;
+
+	uint32_t m_heapIndex = 0;
+
+private:
+	SHRHeapProvider* m_pProvider = nullptr;
+};
@@ -0,0 +1,646 @@
+//headless benchmark of the allocation managers on SHRNullHeapProvider. every manager serves the same allocate/free stream,
+//synthesized here or loaded from a trace written by SHRAllocationTraceRecorder, and reports ops/s, peak heap bytes & fragmentation.
+//the legacy rows are the implementations the managers replaced, kept in this directory as baselines.
+//built by the root CMakeLists.txt, or from the repository root e.g.
+//	g++ -std=c++17 -O2 -I. Tools/SHRAllocationBench/*.cpp SHRAllocationTrace.cpp SHRHeapProvider.cpp SHRMemoryBudget.cpp
+//		SHRBuddyAllocationManager.cpp SHRSegregatedAllocationManager.cpp SHRMemoryAllocationManager.cpp -o shr_alloc_bench
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+
+#include "SHRAllocationTrace.h"
+#include "SHRHeapProvider.h"
+#include "SHRBuddyAllocationManager.h"
+#include "SHRSegregatedAllocationManager.h"
+#include "SHRMemoryAllocationManager.h"
+#include "SHRLegacyBuddyAllocationManager.h"
+#include "SHRLegacyMemoryAllocationManager.h"
+
+//D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT and D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+#define SHR_BENCH_PLACEMENT_ALIGNMENT 65536
+#define SHR_BENCH_SUBALLOCATION_ALIGNMENT 256
+#define SHR_BENCH_FRAGMENTATION_INTERVAL 256		//ops between two fragmentation samples
+
+//raw D3D12_HEAP_TYPE values written to a synthesized trace
+#define SHR_BENCH_HEAP_TYPE_DEFAULT 1
+#define SHR_BENCH_HEAP_TYPE_UPLOAD 2
+
+struct BenchConfig
+{
+	uint64_t eventCount = 200000;
+	uint32_t seed = 1;
+	uint32_t repeatCount = 5;
+	uint64_t buddyHeapSize = 8192 * 1024;
+	uint64_t segregatedHeapSize = 16384 * 1024;
+	uint64_t freeListHeapSize = 32768 * 1024;
+};
+
+//one request of the stream, ids are remapped to dense slots so no runner pays for a hash lookup
+struct BenchOp
+{
+	uint32_t slot;
+	uint32_t free;
+	uint64_t size;
+	uint64_t alignment;
+};
+
+struct BenchResult
+{
+	double seconds = 0.0;
+	uint64_t failedCount = 0;
+	uint64_t peakLiveBytes = 0;
+	uint64_t peakCommittedBytes = 0;
+	uint64_t heapCount = 0;
+	double meanFragmentation = 0.0;
+	double peakFragmentation = 0.0;
+	bool leaked = false;
+};
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//the same placement the systems do, one manager per heap or one growing manager, each runner owns its provider
+class BenchRunner
+{
+public:
+	virtual ~BenchRunner() = default;
+
+	virtual bool Allocate(uint32_t slot, uint64_t size, uint64_t alignment) = 0;
+	virtual void Free(uint32_t slot) = 0;
+	virtual uint64_t GetLargestFreeBlock() const = 0;
+
+public:
+	SHRNullHeapProvider m_provider;
+};
+
+class BuddyRunner : public BenchRunner
+{
+public:
+	struct Handle
+	{
+		SHRBuddyAllocationManager* pManager;
+		uint32_t layer;
+		uint32_t offset;
+	};
+
+public:
+	BuddyRunner(const BenchConfig& config, uint32_t slotCount) : m_heapSize(config.buddyHeapSize), m_handles(slotCount) {}
+
+	bool Allocate(uint32_t slot, uint64_t size, uint64_t alignment)
+	{
+		if (size > m_heapSize || alignment > SHR_BENCH_PLACEMENT_ALIGNMENT) return false;
+
+		for (auto& pManager : m_managers)
+		{
+			if (pManager->GetLargestFreeBlock() < size) continue;
+			if (AllocateFrom(*pManager, slot, size)) return true;
+		}
+
+		m_managers.push_back(std::make_unique<SHRBuddyAllocationManager>(&m_provider, m_heapSize, SHR_BENCH_PLACEMENT_ALIGNMENT, SHR_BENCH_PLACEMENT_ALIGNMENT));
+		return AllocateFrom(*m_managers.back(), slot, size);
+	}
+
+	void Free(uint32_t slot)
+	{
+		Handle& handle = m_handles[slot];
+		handle.pManager->DeallocateBlock(handle.layer, handle.offset);
+	}
+
+	uint64_t GetLargestFreeBlock() const
+	{
+		uint64_t largest = 0;
+		for (auto& pManager : m_managers) largest = std::max(largest, pManager->GetLargestFreeBlock());
+		return largest;
+	}
+
+private:
+	bool AllocateFrom(SHRBuddyAllocationManager& manager, uint32_t slot, uint64_t size)
+	{
+		auto [layer, offset] = manager.CanAllocate(size);
+		if (layer == -1) return false;
+
+		manager.AllocateBlock(layer, offset, nullptr);
+		m_handles[slot] = { &manager, static_cast<uint32_t>(layer), offset };
+		return true;
+	}
+
+public:
+	uint64_t m_heapSize;
+	std::vector<std::unique_ptr<SHRBuddyAllocationManager>> m_managers;
+	std::vector<Handle> m_handles;
+};
+
+//same placement over the tree walk, which has no largest free block to skip a heap by
+class LegacyBuddyRunner : public BenchRunner
+{
+public:
+	struct Handle
+	{
+		SHRLegacyBuddyAllocationManager* pManager;
+		uint32_t layer;
+		uint32_t offset;
+	};
+
+public:
+	LegacyBuddyRunner(const BenchConfig& config, uint32_t slotCount) : m_heapSize(config.buddyHeapSize), m_handles(slotCount) {}
+
+	bool Allocate(uint32_t slot, uint64_t size, uint64_t alignment)
+	{
+		if (size > m_heapSize || alignment > SHR_BENCH_PLACEMENT_ALIGNMENT) return false;
+
+		for (auto& pManager : m_managers)
+		{
+			if (AllocateFrom(*pManager, slot, size)) return true;
+		}
+
+		m_managers.push_back(std::make_unique<SHRLegacyBuddyAllocationManager>(&m_provider, m_heapSize, SHR_BENCH_PLACEMENT_ALIGNMENT, SHR_BENCH_PLACEMENT_ALIGNMENT));
+		return AllocateFrom(*m_managers.back(), slot, size);
+	}
+
+	void Free(uint32_t slot)
+	{
+		Handle& handle = m_handles[slot];
+		handle.pManager->DeallocateBlock(handle.layer, handle.offset);
+	}
+
+	uint64_t GetLargestFreeBlock() const
+	{
+		uint64_t largest = 0;
+		for (auto& pManager : m_managers) largest = std::max(largest, pManager->GetLargestFreeBlock());
+		return largest;
+	}
+
+private:
+	bool AllocateFrom(SHRLegacyBuddyAllocationManager& manager, uint32_t slot, uint64_t size)
+	{
+		auto [layer, offset] = manager.CanAllocate(size);
+		if (layer == -1) return false;
+
+		manager.AllocateBlock(layer, offset);
+		m_handles[slot] = { &manager, static_cast<uint32_t>(layer), offset };
+		return true;
+	}
+
+public:
+	uint64_t m_heapSize;
+	std::vector<std::unique_ptr<SHRLegacyBuddyAllocationManager>> m_managers;
+	std::vector<Handle> m_handles;
+};
+
+class SegregatedRunner : public BenchRunner
+{
+public:
+	SegregatedRunner(const BenchConfig& config, uint32_t slotCount) :
+		m_manager(&m_provider, SHR_BENCH_PLACEMENT_ALIGNMENT, config.segregatedHeapSize, SHR_BENCH_PLACEMENT_ALIGNMENT),
+		m_blocks(slotCount)
+	{
+	}
+
+	bool Allocate(uint32_t slot, uint64_t size, uint64_t alignment)
+	{
+		if (alignment > SHR_BENCH_PLACEMENT_ALIGNMENT) return false;
+
+		uint64_t allocSize = AlignUp(size, SHR_BENCH_PLACEMENT_ALIGNMENT);
+		auto [heap, block] = m_manager.CanAllocate(allocSize);
+		if (heap == -1) return false;
+
+		m_manager.AllocateBlock(block, allocSize, nullptr);
+		m_blocks[slot] = block;
+		return true;
+	}
+
+	void Free(uint32_t slot) { m_manager.DeallocateBlock(m_blocks[slot]); }
+	uint64_t GetLargestFreeBlock() const { return m_manager.GetLargestFreeBlock(); }
+
+public:
+	SHRSegregatedAllocationManager m_manager;
+	std::vector<uint32_t> m_blocks;
+};
+
+class FreeListRunner : public BenchRunner
+{
+public:
+	struct Handle
+	{
+		SHRMemoryAllocationManager* pManager;
+		SHRMemoryAllocationManager::Allocation allocation;
+	};
+
+public:
+	FreeListRunner(const BenchConfig& config, uint32_t slotCount) : m_heapSize(config.freeListHeapSize), m_handles(slotCount) {}
+
+	bool Allocate(uint32_t slot, uint64_t size, uint64_t alignment)
+	{
+		alignment = std::max<uint64_t>(alignment, SHR_BENCH_SUBALLOCATION_ALIGNMENT);
+		uint64_t allocSize = AlignUp(size, SHR_BENCH_SUBALLOCATION_ALIGNMENT);
+		if (allocSize > m_heapSize) return false;
+
+		for (auto& pManager : m_managers)
+		{
+			if (AllocateFrom(*pManager, slot, allocSize, alignment)) return true;
+		}
+
+		m_managers.push_back(std::make_unique<SHRMemoryAllocationManager>(&m_provider, m_heapSize, SHR_BENCH_PLACEMENT_ALIGNMENT));
+		return AllocateFrom(*m_managers.back(), slot, allocSize, alignment);
+	}
+
+	void Free(uint32_t slot)
+	{
+		Handle& handle = m_handles[slot];
+		handle.pManager->Free(handle.allocation);
+	}
+
+	uint64_t GetLargestFreeBlock() const
+	{
+		uint64_t largest = 0;
+		for (auto& pManager : m_managers) largest = std::max<uint64_t>(largest, pManager->GetLargestFreeBlock());
+		return largest;
+	}
+
+private:
+	bool AllocateFrom(SHRMemoryAllocationManager& manager, uint32_t slot, uint64_t size, uint64_t alignment)
+	{
+		if (!manager.CanAllocate(size)) return false;
+
+		SHRMemoryAllocationManager::Allocation allocation = manager.Allocate(size, alignment);
+		if (allocation.offset == SHR_MEMORY_INVALID_OFFSET) return false;
+
+		m_handles[slot] = { &manager, allocation };
+		return true;
+	}
+
+public:
+	uint64_t m_heapSize;
+	std::vector<std::unique_ptr<SHRMemoryAllocationManager>> m_managers;
+	std::vector<Handle> m_handles;
+};
+
+//same placement over the two std::map trees. they have no alignment, a larger one is padded and the whole block is freed
+class LegacyFreeListRunner : public BenchRunner
+{
+public:
+	struct Handle
+	{
+		SHRLegacyMemoryAllocationManager* pManager;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+public:
+	LegacyFreeListRunner(const BenchConfig& config, uint32_t slotCount) : m_heapSize(config.freeListHeapSize), m_handles(slotCount) {}
+
+	bool Allocate(uint32_t slot, uint64_t size, uint64_t alignment)
+	{
+		//every size is a multiple of the sub allocation alignment, so offsets keep it without padding
+		alignment = std::max<uint64_t>(alignment, SHR_BENCH_SUBALLOCATION_ALIGNMENT);
+		uint64_t allocSize = AlignUp(size, SHR_BENCH_SUBALLOCATION_ALIGNMENT) + alignment - SHR_BENCH_SUBALLOCATION_ALIGNMENT;
+		if (allocSize > m_heapSize) return false;
+
+		for (auto& pManager : m_managers)
+		{
+			if (AllocateFrom(*pManager, slot, allocSize)) return true;
+		}
+
+		m_managers.push_back(std::make_unique<SHRLegacyMemoryAllocationManager>(&m_provider, m_heapSize, SHR_BENCH_PLACEMENT_ALIGNMENT));
+		return AllocateFrom(*m_managers.back(), slot, allocSize);
+	}
+
+	void Free(uint32_t slot)
+	{
+		Handle& handle = m_handles[slot];
+		handle.pManager->Free(handle.offset, handle.size);
+	}
+
+	uint64_t GetLargestFreeBlock() const
+	{
+		uint64_t largest = 0;
+		for (auto& pManager : m_managers) largest = std::max<uint64_t>(largest, pManager->GetLargestFreeBlock());
+		return largest;
+	}
+
+private:
+	bool AllocateFrom(SHRLegacyMemoryAllocationManager& manager, uint32_t slot, uint64_t size)
+	{
+		if (!manager.CanAllocate(size)) return false;
+
+		size_t offset = manager.Allocate(size);
+		if (offset == SIZE_MAX) return false;
+
+		m_handles[slot] = { &manager, offset, size };
+		return true;
+	}
+
+public:
+	uint64_t m_heapSize;
+	std::vector<std::unique_ptr<SHRLegacyMemoryAllocationManager>> m_managers;
+	std::vector<Handle> m_handles;
+};
+
+//frames of mostly transient buffers with a tail of long lived textures, ids count up from 1 like the recorder's
+static void SynthesizeTrace(const BenchConfig& config, std::vector<SHRAllocationTraceEvent>& events)
+{
+	std::mt19937_64 random(config.seed);
+	auto uniform = [&random](uint64_t low, uint64_t high) { return low + random() % (high - low + 1); };
+
+	//frame the block retires at, by id
+	std::vector<std::pair<uint32_t, uint64_t>> pendingFrees;
+	uint64_t nextId = 1;
+
+	for (uint32_t frame = 0; events.size() < config.eventCount; frame++)
+	{
+		auto retired = std::partition(pendingFrees.begin(), pendingFrees.end(), [frame](const std::pair<uint32_t, uint64_t>& pending) { return pending.first > frame; });
+		for (auto it = retired; it != pendingFrees.end(); it++)
+		{
+			SHRAllocationTraceEvent event = {};
+			event.type = static_cast<uint8_t>(SHRAllocationTraceEventType::Free);
+			event.frame = frame;
+			event.id = it->second;
+			events.push_back(event);
+		}
+		pendingFrees.erase(retired, pendingFrees.end());
+
+		uint64_t allocationCount = uniform(16, 96);
+		for (uint64_t i = 0; i < allocationCount; i++)
+		{
+			SHRAllocationTraceEvent event = {};
+			event.type = static_cast<uint8_t>(SHRAllocationTraceEventType::Allocate);
+			event.frame = frame;
+			event.id = nextId++;
+			event.served = 1;
+
+			uint64_t kind = uniform(0, 99);
+			if (kind < 70)
+			{
+				event.system = static_cast<uint8_t>(SHRAllocationTraceSystem::FreeList);
+				event.heapType = SHR_BENCH_HEAP_TYPE_UPLOAD;
+				event.size = uniform(256, 64 * 1024 - 1);
+				event.alignment = SHR_BENCH_SUBALLOCATION_ALIGNMENT;
+			}
+			else if (kind < 95)
+			{
+				event.system = static_cast<uint8_t>(SHRAllocationTraceSystem::Buddy);
+				event.heapType = SHR_BENCH_HEAP_TYPE_DEFAULT;
+				event.size = uniform(64 * 1024, 1024 * 1024);
+				event.alignment = SHR_BENCH_PLACEMENT_ALIGNMENT;
+			}
+			else
+			{
+				event.system = static_cast<uint8_t>(SHRAllocationTraceSystem::Segregated);
+				event.heapType = SHR_BENCH_HEAP_TYPE_DEFAULT;
+				event.size = uniform(1024 * 1024, 4 * 1024 * 1024);
+				event.alignment = SHR_BENCH_PLACEMENT_ALIGNMENT;
+			}
+			events.push_back(event);
+
+			//most blocks retire a few frames later with their fence, the rest stay for a while
+			uint32_t lifetime = uniform(0, 99) < 85 ? static_cast<uint32_t>(uniform(1, 3)) : static_cast<uint32_t>(uniform(60, 600));
+			pendingFrees.emplace_back(frame + lifetime, event.id);
+		}
+	}
+}
+
+//dense slots for the ids, requests the recording run refused and frees of blocks allocated before the trace are dropped
+static void BuildOps(const std::vector<SHRAllocationTraceEvent>& events, std::vector<BenchOp>& ops, uint32_t& slotCount)
+{
+	std::unordered_map<uint64_t, uint32_t> slots;
+	std::vector<uint32_t> unusedSlots;
+	slotCount = 0;
+
+	for (const SHRAllocationTraceEvent& event : events)
+	{
+		if (event.type == static_cast<uint8_t>(SHRAllocationTraceEventType::Free))
+		{
+			auto it = slots.find(event.id);
+			if (it == slots.end()) continue;
+
+			ops.push_back({ it->second, 1, 0, 0 });
+			unusedSlots.push_back(it->second);
+			slots.erase(it);
+			continue;
+		}
+
+		if (!event.served) continue;
+
+		uint32_t slot = slotCount;
+		if (unusedSlots.empty()) slotCount++;
+		else
+		{
+			slot = unusedSlots.back();
+			unusedSlots.pop_back();
+		}
+		slots[event.id] = slot;
+		ops.push_back({ slot, 0, event.size, event.alignment });
+	}
+}
+
+static void WriteTrace(const std::string& path, const std::vector<SHRAllocationTraceEvent>& events)
+{
+	SHRAllocationTraceRecorder recorder;
+	if (!recorder.Begin(path))
+	{
+		printf("can not write %s\n", path.c_str());
+		return;
+	}
+
+	//the recorder hands out its own ids
+	std::unordered_map<uint64_t, uint64_t> recordedIds;
+	for (const SHRAllocationTraceEvent& event : events)
+	{
+		recorder.m_frame = event.frame;
+		if (event.type == static_cast<uint8_t>(SHRAllocationTraceEventType::Free))
+		{
+			recorder.RecordFree(recordedIds[event.id]);
+			continue;
+		}
+
+		recordedIds[event.id] = recorder.RecordAllocate(static_cast<SHRAllocationTraceSystem>(event.system), event.heapType, event.dimension,
+			event.size, event.alignment, event.heapFlags, event.resourceFlags, event.initState, event.served != 0);
+	}
+	recorder.End();
+}
+
+template<typename Runner>
+static BenchResult Run(const BenchConfig& config, const std::vector<BenchOp>& ops, uint32_t slotCount)
+{
+	BenchResult result;
+	std::vector<uint8_t> live(slotCount);
+
+	//best of the timed runs, the fragmentation samples are taken on a run of their own so they are not timed
+	for (uint32_t repeat = 0; repeat <= config.repeatCount; repeat++)
+	{
+		bool sampled = repeat == config.repeatCount;
+		std::unique_ptr<Runner> pRunner = std::make_unique<Runner>(config, slotCount);
+		std::fill(live.begin(), live.end(), 0);
+
+		uint64_t failedCount = 0;
+		uint64_t sampleCount = 0;
+		double fragmentationSum = 0.0;
+		double peakFragmentation = 0.0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < ops.size(); i++)
+		{
+			const BenchOp& op = ops[i];
+			if (op.free)
+			{
+				if (live[op.slot]) pRunner->Free(op.slot);
+				live[op.slot] = 0;
+			}
+			else if (pRunner->Allocate(op.slot, op.size, op.alignment)) live[op.slot] = 1;
+			else failedCount++;
+
+			if (sampled && i % SHR_BENCH_FRAGMENTATION_INTERVAL == 0)
+			{
+				//0 when all free bytes are one block, close to 1 when they are scattered
+				const SHRNullHeapProvider& provider = pRunner->m_provider;
+				uint64_t freeBytes = provider.m_committedBytes - provider.m_liveBytes;
+				double fragmentation = freeBytes ? 1.0 - double(pRunner->GetLargestFreeBlock()) / double(freeBytes) : 0.0;
+				fragmentationSum += fragmentation;
+				peakFragmentation = std::max(peakFragmentation, fragmentation);
+				sampleCount++;
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (!sampled)
+		{
+			if (repeat == 0 || seconds < result.seconds) result.seconds = seconds;
+			continue;
+		}
+
+		result.failedCount = failedCount;
+		result.peakLiveBytes = pRunner->m_provider.m_peakLiveBytes;
+		result.peakCommittedBytes = pRunner->m_provider.m_peakCommittedBytes;
+		result.heapCount = pRunner->m_provider.m_heaps.size();
+		result.meanFragmentation = sampleCount ? fragmentationSum / sampleCount : 0.0;
+		result.peakFragmentation = peakFragmentation;
+		if (config.repeatCount == 0) result.seconds = seconds;
+
+		//everything still live goes back, a manager that loses track of a block shows up here
+		for (uint32_t slot = 0; slot < slotCount; slot++)
+		{
+			if (live[slot]) pRunner->Free(slot);
+		}
+		result.leaked = pRunner->m_provider.m_liveBytes != 0;
+	}
+	return result;
+}
+
+static void PrintResult(const char* name, const BenchResult& result, size_t opCount)
+{
+	printf("%-12s %12.0f %8.1f %8llu %14llu %14llu %6llu %9.1f%% %9.1f%%%s\n", name,
+		result.seconds > 0.0 ? opCount / result.seconds : 0.0, opCount ? result.seconds * 1e9 / opCount : 0.0,
+		(unsigned long long)result.failedCount, (unsigned long long)result.peakLiveBytes, (unsigned long long)result.peakCommittedBytes,
+		(unsigned long long)result.heapCount, result.meanFragmentation * 100.0, result.peakFragmentation * 100.0, result.leaked ? "  LEAKED" : "");
+}
+
+//accepts plain numbers or a K/M/G suffix
+static bool ParseSize(const char* text, uint64_t& value)
+{
+	char* pEnd = nullptr;
+	unsigned long long number = strtoull(text, &pEnd, 10);
+	if (pEnd == text) return false;
+
+	switch (*pEnd)
+	{
+	case 'k': case 'K': number <<= 10; pEnd++; break;
+	case 'm': case 'M': number <<= 20; pEnd++; break;
+	case 'g': case 'G': number <<= 30; pEnd++; break;
+	}
+	if (*pEnd != '\0') return false;
+
+	value = number;
+	return true;
+}
+
+static void PrintUsage()
+{
+	printf("usage: shr_alloc_bench [options]\n"
+		"  --trace <file>                  replay a recorded trace instead of a synthesized one\n"
+		"  --write-trace <file>            write the synthesized trace for shr_alloc_replay\n"
+		"  --events <n>                    synthesized events, default 200000\n"
+		"  --seed <n>                      default 1\n"
+		"  --repeat <n>                    timed runs, the best one is reported, default 5\n"
+		"  --buddy-heap-size <size>        default 8M\n"
+		"  --segregated-heap-size <size>   default 16M\n"
+		"  --freelist-heap-size <size>     default 32M\n");
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	std::string tracePath;
+	std::string writePath;
+	for (int i = 1; i < argc; i++)
+	{
+		uint64_t value = 0;
+		bool hasArgument = i + 1 < argc;
+		bool valid = hasArgument && ParseSize(argv[i + 1], value);
+		if (hasArgument && strcmp(argv[i], "--trace") == 0) tracePath = argv[i + 1];
+		else if (hasArgument && strcmp(argv[i], "--write-trace") == 0) writePath = argv[i + 1];
+		else if (valid && value && strcmp(argv[i], "--events") == 0) config.eventCount = value;
+		else if (valid && strcmp(argv[i], "--seed") == 0) config.seed = static_cast<uint32_t>(value);
+		else if (valid && strcmp(argv[i], "--repeat") == 0) config.repeatCount = static_cast<uint32_t>(value);
+		else if (valid && value && strcmp(argv[i], "--buddy-heap-size") == 0) config.buddyHeapSize = value;
+		else if (valid && value && strcmp(argv[i], "--segregated-heap-size") == 0) config.segregatedHeapSize = value;
+		else if (valid && value && strcmp(argv[i], "--freelist-heap-size") == 0) config.freeListHeapSize = value;
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+		i++;
+	}
+
+	//the buddy manager splits the heap down to whole blocks
+	if ((config.buddyHeapSize & (config.buddyHeapSize - 1)) != 0 || config.buddyHeapSize < SHR_BENCH_PLACEMENT_ALIGNMENT)
+	{
+		printf("the buddy heap size must be a power of two of at least 64K\n");
+		return 1;
+	}
+
+	std::vector<SHRAllocationTraceEvent> events;
+	if (tracePath.empty()) SynthesizeTrace(config, events);
+	else if (!SHRLoadAllocationTrace(tracePath, events))
+	{
+		printf("%s is not an allocation trace of version %d\n", tracePath.c_str(), SHR_ALLOCATION_TRACE_VERSION);
+		return 1;
+	}
+
+	if (!writePath.empty()) WriteTrace(writePath, events);
+
+	std::vector<BenchOp> ops;
+	uint32_t slotCount = 0;
+	BuildOps(events, ops, slotCount);
+
+	printf("%zu ops over %u slots, %s\n\n", ops.size(), slotCount, tracePath.empty() ? "synthesized" : tracePath.c_str());
+	printf("%-12s %12s %8s %8s %14s %14s %6s %10s %10s\n", "manager", "ops/s", "ns/op", "failed", "peakLive", "peakHeap", "heaps", "meanFrag", "peakFrag");
+
+	BenchResult results[] =
+	{
+		Run<BuddyRunner>(config, ops, slotCount),
+		Run<LegacyBuddyRunner>(config, ops, slotCount),
+		Run<SegregatedRunner>(config, ops, slotCount),
+		Run<FreeListRunner>(config, ops, slotCount),
+		Run<LegacyFreeListRunner>(config, ops, slotCount),
+	};
+	const char* names[] = { "buddy", "buddy-tree", "segregated", "freelist", "freelist-map" };
+
+	bool leaked = false;
+	for (size_t i = 0; i < sizeof(results) / sizeof(results[0]); i++)
+	{
+		PrintResult(names[i], results[i], ops.size());
+		leaked |= results[i].leaked;
+	}
+
+	return leaked ? 1 : 0;
+}
@@ -0,0 +1,498 @@
+//replays a trace written by SHRAllocationTraceRecorder through the allocation managers on SHRNullHeapProvider,
+//so heap sizes and layer counts can be tuned off a GPU box. built by the root CMakeLists.txt, or from the repository root e.g.
+//	g++ -std=c++17 -O2 -I. Tools/SHRAllocationReplay/main.cpp SHRAllocationTrace.cpp SHRHeapProvider.cpp SHRMemoryBudget.cpp
+//		SHRBuddyAllocationManager.cpp SHRSegregatedAllocationManager.cpp SHRMemoryAllocationManager.cpp -o shr_alloc_replay
+//the segregated layer counts are compile time, add -DSHR_SEGREGATED_SL_INDEX_COUNT_LOG2=n to compare them
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+
+#include "SHRAllocationTrace.h"
+#include "SHRHeapProvider.h"
+#include "SHRBuddyAllocationManager.h"
+#include "SHRSegregatedAllocationManager.h"
+#include "SHRMemoryAllocationManager.h"
+
+//D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT and D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+#define SHR_REPLAY_PLACEMENT_ALIGNMENT 65536
+#define SHR_REPLAY_SUBALLOCATION_ALIGNMENT 256
+#define SHR_REPLAY_SYSTEM_COUNT 4
+
+//defaults are the ones SHRResourceAllocator.h builds with
+struct ReplayConfig
+{
+	uint64_t buddyHeapSize = 8192 * 1024;
+	uint64_t buddyBlockSize = SHR_REPLAY_PLACEMENT_ALIGNMENT / 2;
+	uint64_t buddyBlockCount = 8;
+	uint64_t segregatedHeapSize = 16384 * 1024;
+	uint64_t freeListHeapSize = 32768 * 1024;
+	uint32_t idleFrameLimit = 300;
+};
+
+//one allocator of a system with the keys the real system validates against, only the manager of its system is set
+struct ReplayAllocator
+{
+	uint32_t heapType;
+	uint32_t heapFlags;
+	uint32_t resourceFlags;
+	uint32_t initState;
+	uint64_t alignment;
+	uint64_t blockSize;
+
+	std::unique_ptr<SHRBuddyAllocationManager> pBuddy;
+	std::unique_ptr<SHRSegregatedAllocationManager> pSegregated;
+	std::unique_ptr<SHRMemoryAllocationManager> pFreeList;
+
+	uint64_t liveCount = 0;
+	uint32_t idleFrameCount = 0;
+};
+
+struct LiveBlock
+{
+	uint32_t system;
+	ReplayAllocator* pAllocator;	//nullptr for a dedicated block, offset is then its heap
+	uint64_t layer;
+	uint64_t offset;
+	SHRMemoryAllocationManager::Allocation allocation;
+	uint64_t size;
+};
+
+struct SystemReport
+{
+	uint64_t requestCount = 0;
+	uint64_t failedCount = 0;
+	uint64_t skippedCount = 0;		//requests the recording run could not serve either
+	uint64_t requestedBytes = 0;
+	uint64_t peakRequestedBytes = 0;
+};
+
+static const char* g_systemNames[SHR_REPLAY_SYSTEM_COUNT] = { "buddy", "segregated", "freelist", "dedicated" };
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+class SHRAllocationReplayer
+{
+public:
+	SHRAllocationReplayer(const ReplayConfig& config) : m_config(config) {}
+
+	void Replay(const std::vector<SHRAllocationTraceEvent>& events);
+	void Print(double seconds, uint64_t eventCount);
+
+private:
+	bool Allocate(const SHRAllocationTraceEvent& event);
+	void Free(uint64_t id);
+	void AdvanceFrames(uint32_t frameCount);
+
+	ReplayAllocator* FindBestFitBuddy(const SHRAllocationTraceEvent& event, bool overAligned);
+	bool AllocateBuddy(ReplayAllocator& allocator, const SHRAllocationTraceEvent& event, LiveBlock& block);
+	bool AllocateSegregated(ReplayAllocator& allocator, const SHRAllocationTraceEvent& event, LiveBlock& block);
+	bool AllocateFreeList(ReplayAllocator& allocator, const SHRAllocationTraceEvent& event, LiveBlock& block);
+	bool AllocateDedicated(const SHRAllocationTraceEvent& event, LiveBlock& block);
+	ReplayAllocator& CreateAllocator(const SHRAllocationTraceEvent& event);
+
+	void ReleaseAllocator(uint32_t system, ReplayAllocator& allocator);
+
+public:
+	ReplayConfig m_config;
+	SHRNullHeapProvider m_providers[SHR_REPLAY_SYSTEM_COUNT];
+	std::vector<std::unique_ptr<ReplayAllocator>> m_allocators[SHR_REPLAY_SYSTEM_COUNT];
+	SystemReport m_reports[SHR_REPLAY_SYSTEM_COUNT];
+
+	std::unordered_map<uint64_t, LiveBlock> m_liveBlocks;
+	uint32_t m_frame = 0;
+};
+
+void SHRAllocationReplayer::Replay(const std::vector<SHRAllocationTraceEvent>& events)
+{
+	for (const SHRAllocationTraceEvent& event : events)
+	{
+		if (event.frame > m_frame) AdvanceFrames(event.frame - m_frame);
+
+		if (event.type == static_cast<uint8_t>(SHRAllocationTraceEventType::Free))
+		{
+			Free(event.id);
+			continue;
+		}
+
+		if (event.system >= SHR_REPLAY_SYSTEM_COUNT) continue;
+		SystemReport& report = m_reports[event.system];
+		report.requestCount++;
+
+		//nothing frees a request the recording run refused, serving it here would leak it
+		if (!event.served)
+		{
+			report.skippedCount++;
+			continue;
+		}
+
+		if (!Allocate(event)) report.failedCount++;
+	}
+}
+
+bool SHRAllocationReplayer::Allocate(const SHRAllocationTraceEvent& event)
+{
+	uint32_t system = event.system;
+	LiveBlock block = { system, nullptr, 0, 0, { SHR_MEMORY_INVALID_OFFSET, 0, -1 }, event.size };
+
+	//same order as the systems: the best fit buddy allocator of the class or the first other allocator that takes it, else a new one
+	bool result = false;
+	if (static_cast<SHRAllocationTraceSystem>(system) == SHRAllocationTraceSystem::Dedicated)
+	{
+		result = AllocateDedicated(event, block);
+	}
+	else if (static_cast<SHRAllocationTraceSystem>(system) == SHRAllocationTraceSystem::Buddy)
+	{
+		ReplayAllocator* pBestFit = FindBestFitBuddy(event, false);
+		if (!pBestFit) pBestFit = FindBestFitBuddy(event, true);
+		if (pBestFit) result = AllocateBuddy(*pBestFit, event, block);
+	}
+	else for (auto& pAllocator : m_allocators[system])
+	{
+		ReplayAllocator& allocator = *pAllocator;
+		if (allocator.heapType != event.heapType || allocator.heapFlags != event.heapFlags) continue;
+
+		switch (static_cast<SHRAllocationTraceSystem>(system))
+		{
+		case SHRAllocationTraceSystem::Buddy: result = AllocateBuddy(allocator, event, block); break;
+		case SHRAllocationTraceSystem::Segregated: result = AllocateSegregated(allocator, event, block); break;
+		case SHRAllocationTraceSystem::FreeList: result = AllocateFreeList(allocator, event, block); break;
+		default: break;
+		}
+		if (result) break;
+	}
+
+	if (!result && static_cast<SHRAllocationTraceSystem>(system) != SHRAllocationTraceSystem::Dedicated)
+	{
+		ReplayAllocator& allocator = CreateAllocator(event);
+		switch (static_cast<SHRAllocationTraceSystem>(system))
+		{
+		case SHRAllocationTraceSystem::Buddy: result = AllocateBuddy(allocator, event, block); break;
+		case SHRAllocationTraceSystem::Segregated: result = AllocateSegregated(allocator, event, block); break;
+		case SHRAllocationTraceSystem::FreeList: result = AllocateFreeList(allocator, event, block); break;
+		default: break;
+		}
+	}
+
+	if (!result) return false;
+
+	if (block.pAllocator) block.pAllocator->liveCount++;
+	m_liveBlocks[event.id] = block;
+
+	SystemReport& report = m_reports[system];
+	report.requestedBytes += event.size;
+	report.peakRequestedBytes = std::max(report.peakRequestedBytes, report.requestedBytes);
+	return true;
+}
+
+//SHRBuddySystem::FindBestFitAllocator over the allocators of the request's class, or of the over-aligned classes
+ReplayAllocator* SHRAllocationReplayer::FindBestFitBuddy(const SHRAllocationTraceEvent& event, bool overAligned)
+{
+	uint64_t alignment = event.alignment <= SHR_REPLAY_PLACEMENT_ALIGNMENT ? SHR_REPLAY_PLACEMENT_ALIGNMENT : event.alignment;
+
+	ReplayAllocator* pBestFit = nullptr;
+	uint64_t bestFreeBlock = 0;
+	for (auto& pAllocator : m_allocators[static_cast<uint32_t>(SHRAllocationTraceSystem::Buddy)])
+	{
+		ReplayAllocator& allocator = *pAllocator;
+		if (allocator.heapType != event.heapType || allocator.heapFlags != event.heapFlags) continue;
+		if (overAligned ? allocator.alignment <= alignment : allocator.alignment != alignment) continue;
+
+		uint64_t allocSize = event.alignment != 0 && allocator.blockSize % event.alignment != 0 ? event.size + event.alignment : event.size;
+		uint64_t largestFreeBlock = allocator.pBuddy->GetLargestFreeBlock();
+		if (largestFreeBlock < allocSize) continue;
+
+		if (!pBestFit || largestFreeBlock < bestFreeBlock)
+		{
+			pBestFit = &allocator;
+			bestFreeBlock = largestFreeBlock;
+		}
+		if (largestFreeBlock < allocSize * 2 || largestFreeBlock == allocator.blockSize) break;
+	}
+	return pBestFit;
+}
+
+bool SHRAllocationReplayer::AllocateBuddy(ReplayAllocator& allocator, const SHRAllocationTraceEvent& event, LiveBlock& block)
+{
+	if (event.alignment > allocator.alignment) return false;
+
+	uint64_t allocSize = event.alignment != 0 && allocator.blockSize % event.alignment != 0 ? event.size + event.alignment : event.size;
+	auto [layer, offset] = allocator.pBuddy->CanAllocate(allocSize);
+	if (layer == -1) return false;
+
+	allocator.pBuddy->AllocateBlock(layer, offset, nullptr);
+	block.pAllocator = &allocator;
+	block.layer = layer;
+	block.offset = offset;
+	return true;
+}
+
+bool SHRAllocationReplayer::AllocateSegregated(ReplayAllocator& allocator, const SHRAllocationTraceEvent& event, LiveBlock& block)
+{
+	if (event.alignment > allocator.alignment) return false;
+
+	uint64_t allocSize = event.size;
+	if (event.alignment != 0 && allocator.blockSize % event.alignment != 0) allocSize += event.alignment;
+	allocSize = AlignUp(allocSize, allocator.blockSize);
+
+	auto [heap, node] = allocator.pSegregated->CanAllocate(allocSize);
+	if (heap == -1) return false;
+
+	allocator.pSegregated->AllocateBlock(node, allocSize, nullptr);
+	block.pAllocator = &allocator;
+	block.offset = node;
+	return true;
+}
+
+bool SHRAllocationReplayer::AllocateFreeList(ReplayAllocator& allocator, const SHRAllocationTraceEvent& event, LiveBlock& block)
+{
+	if (allocator.resourceFlags != event.resourceFlags || allocator.initState != event.initState) return false;
+
+	uint64_t allocSize = AlignUp(event.size, SHR_REPLAY_SUBALLOCATION_ALIGNMENT);
+	if (!allocator.pFreeList->CanAllocate(allocSize)) return false;
+
+	SHRMemoryAllocationManager::Allocation allocation = allocator.pFreeList->Allocate(allocSize, SHR_REPLAY_SUBALLOCATION_ALIGNMENT);
+	if (allocation.offset == SHR_MEMORY_INVALID_OFFSET) return false;
+
+	block.pAllocator = &allocator;
+	block.allocation = allocation;
+	return true;
+}
+
+//a committed resource, or a heap of its own, either way a heap of the request's size that goes away with it
+bool SHRAllocationReplayer::AllocateDedicated(const SHRAllocationTraceEvent& event, LiveBlock& block)
+{
+	SHRNullHeapProvider& provider = m_providers[static_cast<uint32_t>(SHRAllocationTraceSystem::Dedicated)];
+	uint64_t alignment = event.alignment <= SHR_REPLAY_PLACEMENT_ALIGNMENT ? SHR_REPLAY_PLACEMENT_ALIGNMENT : event.alignment;
+
+	uint32_t heapIndex = provider.CreateHeap(AlignUp(event.size, alignment), alignment);
+	provider.OnAllocate(heapIndex, 0, event.size);
+	block.offset = heapIndex;
+	return true;
+}
+
+ReplayAllocator& SHRAllocationReplayer::CreateAllocator(const SHRAllocationTraceEvent& event)
+{
+	uint32_t system = event.system;
+	SHRHeapProvider* pProvider = &m_providers[system];
+	bool isDefault = event.alignment <= SHR_REPLAY_PLACEMENT_ALIGNMENT;
+
+	std::unique_ptr<ReplayAllocator> pAllocator = std::make_unique<ReplayAllocator>();
+	pAllocator->heapType = event.heapType;
+	pAllocator->heapFlags = event.heapFlags;
+	pAllocator->resourceFlags = event.resourceFlags;
+	pAllocator->initState = event.initState;
+	pAllocator->alignment = isDefault ? SHR_REPLAY_PLACEMENT_ALIGNMENT : event.alignment;
+
+	switch (static_cast<SHRAllocationTraceSystem>(system))
+	{
+	case SHRAllocationTraceSystem::Buddy:
+	{
+		pAllocator->blockSize = std::max(std::max(m_config.buddyBlockSize, event.alignment), pAllocator->alignment);
+		uint64_t heapSize = isDefault ? m_config.buddyHeapSize : pAllocator->blockSize * m_config.buddyBlockCount;
+		if (heapSize <= pAllocator->blockSize) heapSize = pAllocator->blockSize * m_config.buddyBlockCount;
+		pAllocator->pBuddy = std::make_unique<SHRBuddyAllocationManager>(pProvider, heapSize, pAllocator->blockSize, pAllocator->alignment);
+	}
+	break;
+	case SHRAllocationTraceSystem::Segregated:
+	{
+		pAllocator->blockSize = pAllocator->alignment;
+		pAllocator->pSegregated = std::make_unique<SHRSegregatedAllocationManager>(pProvider, pAllocator->blockSize, m_config.segregatedHeapSize, pAllocator->alignment);
+	}
+	break;
+	case SHRAllocationTraceSystem::FreeList:
+	{
+		pAllocator->alignment = SHR_REPLAY_PLACEMENT_ALIGNMENT;
+		pAllocator->blockSize = SHR_REPLAY_SUBALLOCATION_ALIGNMENT;
+		uint64_t heapSize = std::max(m_config.freeListHeapSize, AlignUp(event.size, SHR_REPLAY_SUBALLOCATION_ALIGNMENT));
+		heapSize = AlignUp(heapSize, pAllocator->alignment);
+		pAllocator->pFreeList = std::make_unique<SHRMemoryAllocationManager>(pProvider, heapSize, pAllocator->alignment);
+	}
+	break;
+	default: break;		//dedicated blocks have no allocator
+	}
+
+	m_allocators[system].push_back(std::move(pAllocator));
+	return *m_allocators[system].back();
+}
+
+void SHRAllocationReplayer::Free(uint64_t id)
+{
+	auto it = m_liveBlocks.find(id);
+	if (it == m_liveBlocks.end()) return;	//allocated before the trace began, or failed in this replay
+
+	LiveBlock& block = it->second;
+	if (!block.pAllocator)
+	{
+		SHRNullHeapProvider& provider = m_providers[block.system];
+		uint32_t heapIndex = static_cast<uint32_t>(block.offset);
+		provider.OnFree(heapIndex, 0, block.size);
+		provider.ReleaseHeap(heapIndex);
+	}
+	else
+	{
+		ReplayAllocator& allocator = *block.pAllocator;
+		switch (static_cast<SHRAllocationTraceSystem>(block.system))
+		{
+		case SHRAllocationTraceSystem::Buddy: allocator.pBuddy->DeallocateBlock(block.layer, block.offset); break;
+		case SHRAllocationTraceSystem::Segregated: allocator.pSegregated->DeallocateBlock(static_cast<uint32_t>(block.offset)); break;
+		case SHRAllocationTraceSystem::FreeList: allocator.pFreeList->Free(block.allocation); break;
+		default: break;
+		}
+		allocator.liveCount--;
+	}
+	m_reports[block.system].requestedBytes -= block.size;
+
+	m_liveBlocks.erase(it);
+}
+
+//the per frame cleanup of the systems, frees in the trace already happen at the frame their fence retired
+void SHRAllocationReplayer::AdvanceFrames(uint32_t frameCount)
+{
+	//past the idle limit further empty frames change nothing
+	frameCount = std::min(frameCount, m_config.idleFrameLimit + 1);
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		for (uint32_t system = 0; system < SHR_REPLAY_SYSTEM_COUNT; system++)
+		{
+			std::vector<std::unique_ptr<ReplayAllocator>>& allocators = m_allocators[system];
+			if (system == static_cast<uint32_t>(SHRAllocationTraceSystem::Segregated))
+			{
+				for (auto& pAllocator : allocators) pAllocator->pSegregated->TrimHeaps(m_config.idleFrameLimit);
+				continue;
+			}
+
+			for (auto& pAllocator : allocators)
+			{
+				pAllocator->idleFrameCount = pAllocator->liveCount == 0 ? pAllocator->idleFrameCount + 1 : 0;
+				if (pAllocator->idleFrameCount >= m_config.idleFrameLimit) ReleaseAllocator(system, *pAllocator);
+			}
+			allocators.erase(std::remove_if(allocators.begin(), allocators.end(), [this](const std::unique_ptr<ReplayAllocator>& pAllocator)
+				{
+					return pAllocator->idleFrameCount >= m_config.idleFrameLimit;
+				}), allocators.end());
+		}
+	}
+	m_frame += frameCount;
+}
+
+void SHRAllocationReplayer::ReleaseAllocator(uint32_t system, ReplayAllocator& allocator)
+{
+	if (allocator.pBuddy) m_providers[system].ReleaseHeap(allocator.pBuddy->m_heapIndex);
+	if (allocator.pFreeList) m_providers[system].ReleaseHeap(allocator.pFreeList->m_heapIndex);
+}
+
+void SHRAllocationReplayer::Print(double seconds, uint64_t eventCount)
+{
+	printf("%-11s %10s %8s %8s %14s %14s %14s %9s %9s %7s\n", "system", "requests", "failed", "skipped",
+		"peakRequested", "peakPlaced", "peakCommitted", "internal", "overhead", "created");
+
+	for (uint32_t system = 0; system < SHR_REPLAY_SYSTEM_COUNT; system++)
+	{
+		const SystemReport& report = m_reports[system];
+		const SHRNullHeapProvider& provider = m_providers[system];
+		if (report.requestCount == 0) continue;
+
+		//internal: rounding of blocks over requested bytes, overhead: committed heap bytes over requested bytes, created: heaps over the whole run
+		double internal = report.peakRequestedBytes ? double(provider.m_peakLiveBytes) / double(report.peakRequestedBytes) - 1.0 : 0.0;
+		double overhead = report.peakRequestedBytes ? double(provider.m_peakCommittedBytes) / double(report.peakRequestedBytes) - 1.0 : 0.0;
+
+		printf("%-11s %10llu %8llu %8llu %14llu %14llu %14llu %8.1f%% %8.1f%% %7zu\n", g_systemNames[system],
+			(unsigned long long)report.requestCount, (unsigned long long)report.failedCount, (unsigned long long)report.skippedCount,
+			(unsigned long long)report.peakRequestedBytes, (unsigned long long)provider.m_peakLiveBytes, (unsigned long long)provider.m_peakCommittedBytes,
+			internal * 100.0, overhead * 100.0, provider.m_heaps.size());
+	}
+
+	printf("\n%llu events, %u frames in %.3f ms, %.0f events/s, %.1f ns/event\n", (unsigned long long)eventCount, m_frame,
+		seconds * 1000.0, seconds > 0.0 ? eventCount / seconds : 0.0, eventCount ? seconds * 1e9 / eventCount : 0.0);
+}
+
+//accepts plain bytes or a K/M/G suffix
+static bool ParseSize(const char* text, uint64_t& value)
+{
+	char* pEnd = nullptr;
+	unsigned long long number = strtoull(text, &pEnd, 10);
+	if (pEnd == text) return false;
+
+	switch (*pEnd)
+	{
+	case 'k': case 'K': number <<= 10; pEnd++; break;
+	case 'm': case 'M': number <<= 20; pEnd++; break;
+	case 'g': case 'G': number <<= 30; pEnd++; break;
+	}
+	if (*pEnd != '\0' || number == 0) return false;
+
+	value = number;
+	return true;
+}
+
+static void PrintUsage()
+{
+	printf("usage: shr_alloc_replay <trace> [options]\n"
+		"  --buddy-heap-size <size>        default 8M\n"
+		"  --buddy-block-size <size>       default 32K\n"
+		"  --buddy-block-count <n>         heap blocks of an over aligned buddy heap, default 8\n"
+		"  --segregated-heap-size <size>   default 16M\n"
+		"  --freelist-heap-size <size>     default 32M\n"
+		"  --idle-frames <n>               frames a drained heap is kept, default 300\n"
+		"segregated layers: fl %d, sl %d (rebuild with -DSHR_SEGREGATED_SL_INDEX_COUNT_LOG2=n to change)\n",
+		SHR_SEGREGATED_FL_INDEX_COUNT, SHR_SEGREGATED_SL_INDEX_COUNT);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	ReplayConfig config;
+	for (int i = 2; i < argc; i++)
+	{
+		uint64_t value = 0;
+		bool valid = i + 1 < argc && ParseSize(argv[i + 1], value);
+		if (valid && strcmp(argv[i], "--buddy-heap-size") == 0) config.buddyHeapSize = value;
+		else if (valid && strcmp(argv[i], "--buddy-block-size") == 0) config.buddyBlockSize = value;
+		else if (valid && strcmp(argv[i], "--buddy-block-count") == 0) config.buddyBlockCount = value;
+		else if (valid && strcmp(argv[i], "--segregated-heap-size") == 0) config.segregatedHeapSize = value;
+		else if (valid && strcmp(argv[i], "--freelist-heap-size") == 0) config.freeListHeapSize = value;
+		else if (valid && strcmp(argv[i], "--idle-frames") == 0) config.idleFrameLimit = static_cast<uint32_t>(value);
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+		i++;
+	}
+
+	//the buddy manager splits the heap down to whole blocks
+	if ((config.buddyHeapSize & (config.buddyHeapSize - 1)) != 0 || (config.buddyBlockSize & (config.buddyBlockSize - 1)) != 0)
+	{
+		printf("buddy heap & block sizes must be powers of two\n");
+		return 1;
+	}
+
+	std::vector<SHRAllocationTraceEvent> events;
+	if (!SHRLoadAllocationTrace(argv[1], events))
+	{
+		printf("%s is not an allocation trace of version %d\n", argv[1], SHR_ALLOCATION_TRACE_VERSION);
+		return 1;
+	}
+
+	SHRAllocationReplayer replayer(config);
+
+	auto start = std::chrono::steady_clock::now();
+	replayer.Replay(events);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	replayer.Print(seconds, events.size());
+	return 0;
+}
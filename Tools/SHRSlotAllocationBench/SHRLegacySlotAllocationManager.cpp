@@ -0,0 +1,40 @@
+#include "SHRLegacySlotAllocationManager.h"
+
+SHRLegacySlotAllocationManager::SHRLegacySlotAllocationManager(uint32_t slotCount)
+{
+	m_freeList.push_back({ 0, slotCount });
+}
+
+uint32_t SHRLegacySlotAllocationManager::AllocateSlot()
+{
+	if (m_freeList.empty()) return SHR_SLOT_INVALID_INDEX;
+
+	FreeRange& range = m_freeList.front();
+	uint32_t index = range.begin;
+
+	range.begin++;
+	if (range.begin == range.end)
+	{
+		m_freeList.erase(m_freeList.begin());
+	}
+
+	return index;
+}
+
+void SHRLegacySlotAllocationManager::DeallocateSlot(uint32_t index)
+{
+	for (auto& range : m_freeList)
+	{
+		if (index == range.end)
+		{
+			range.end++;
+			return;
+		}
+		else if (index + 1 == range.begin)
+		{
+			range.begin--;
+			return;
+		}
+	}
+	m_freeList.push_back({ index, index + 1 });
+}
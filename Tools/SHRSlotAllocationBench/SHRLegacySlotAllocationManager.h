@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "SHRSlotAllocationManager.h"
+
+//the free range list SHRHeapSlotAllocator kept per heap before the slot bitmap (123fd2e), on slot indices instead of
+//handles and kept only as the baseline of shr_slot_bench. a freed slot next to no range is appended as a range of its own,
+//ranges are never merged with each other
+class SHRLegacySlotAllocationManager
+{
+public:
+	struct FreeRange
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+public:
+	SHRLegacySlotAllocationManager(uint32_t slotCount);
+	~SHRLegacySlotAllocationManager() = default;
+
+	uint32_t AllocateSlot();							//return SHR_SLOT_INVALID_INDEX when the heap is full
+	void DeallocateSlot(uint32_t index);
+
+	bool HasFreeSlot() const { return !m_freeList.empty(); }
+
+public:
+	std::vector<FreeRange> m_freeList;
+};
@@ -0,0 +1,298 @@
+//headless benchmark of the descriptor slot allocation on Linux. the manager section compares SHRSlotAllocationManager with the
+//free range list it replaced on one thread, the contention section runs SHRHeapSlotAllocator on SHRNullDevice from Tools/NullDevice,
+//so both measure the bookkeeping & locking only. built by the root CMakeLists.txt
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <random>
+#include <algorithm>
+
+#include "SHRNullDevice.h"
+#include "SHRHeapSlotAllocator.h"
+#include "SHRSlotAllocationManager.h"
+#include "SHRBitUtils.h"
+#include "SHRLegacySlotAllocationManager.h"
+
+struct BenchConfig
+{
+	uint64_t opCount = 2000000;			//per thread
+	uint32_t maxThreadCount = 8;
+	uint32_t batchSize = 48;			//slots held before they are freed again, about one material's views
+	uint32_t repeatCount = 3;
+	uint32_t liveSlotCount = 3000;		//held by the manager section while it churns, about three heaps
+};
+
+//one step of the manager section: a new slot, or the free of the live slot at position
+struct SlotOp
+{
+	uint32_t free;
+	uint32_t position;
+};
+
+struct SlotHandle
+{
+	uint32_t heap;
+	uint32_t index;
+};
+
+//heaps picked through a bitmap of the ones with a free slot, as SHRHeapSlotAllocator does now
+class SlotPool
+{
+public:
+	SlotHandle Allocate()
+	{
+		for (size_t i = 0; i < m_availableHeapBits.size(); i++)
+		{
+			if (m_availableHeapBits[i] == 0) continue;
+
+			uint32_t heap = static_cast<uint32_t>(i * 64 + SHRFindFirstSet(m_availableHeapBits[i]));
+			uint32_t index = m_heaps[heap].AllocateSlot();
+			UpdateAvailability(heap);
+			return { heap, index };
+		}
+
+		m_heaps.emplace_back(SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
+		if (m_availableHeapBits.size() * 64 < m_heaps.size()) m_availableHeapBits.push_back(0);
+
+		uint32_t heap = static_cast<uint32_t>(m_heaps.size() - 1);
+		uint32_t index = m_heaps[heap].AllocateSlot();
+		UpdateAvailability(heap);
+		return { heap, index };
+	}
+
+	void Free(const SlotHandle& handle)
+	{
+		m_heaps[handle.heap].DeallocateSlot(handle.index);
+		UpdateAvailability(handle.heap);
+	}
+
+private:
+	void UpdateAvailability(uint32_t heap)
+	{
+		uint64_t heapMask = 1ULL << (heap & 63);
+		if (m_heaps[heap].m_freeCount) m_availableHeapBits[heap >> 6] |= heapMask;
+		else m_availableHeapBits[heap >> 6] &= ~heapMask;
+	}
+
+public:
+	std::vector<SHRSlotAllocationManager> m_heaps;
+	std::vector<uint64_t> m_availableHeapBits;
+};
+
+//the first heap with a non empty free list, as SHRHeapSlotAllocator did before the slot bitmap
+class LegacySlotPool
+{
+public:
+	SlotHandle Allocate()
+	{
+		for (size_t i = 0; i < m_heaps.size(); i++)
+		{
+			if (m_heaps[i].HasFreeSlot()) return { static_cast<uint32_t>(i), m_heaps[i].AllocateSlot() };
+		}
+
+		m_heaps.emplace_back(SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
+		return { static_cast<uint32_t>(m_heaps.size() - 1), m_heaps.back().AllocateSlot() };
+	}
+
+	void Free(const SlotHandle& handle) { m_heaps[handle.heap].DeallocateSlot(handle.index); }
+
+public:
+	std::vector<SHRLegacySlotAllocationManager> m_heaps;
+};
+
+//fill up to the live count, then free a random live slot & allocate a new one, so the free slots end up scattered
+static void BuildSlotOps(const BenchConfig& config, std::vector<SlotOp>& ops)
+{
+	std::mt19937 random(1);
+	uint32_t liveCount = 0;
+	while (ops.size() < config.opCount)
+	{
+		if (liveCount < config.liveSlotCount)
+		{
+			ops.push_back({ 0, 0 });
+			liveCount++;
+			continue;
+		}
+
+		ops.push_back({ 1, static_cast<uint32_t>(random() % liveCount) });
+		ops.push_back({ 0, 0 });
+	}
+}
+
+//best of repeatCount runs, live slots are swap removed so a position always names a live slot
+template<typename Pool>
+static double RunSlotOps(const BenchConfig& config, const std::vector<SlotOp>& ops, size_t& heapCount, uint64_t& checksum)
+{
+	double bestSeconds = 0.0;
+	std::vector<SlotHandle> live;
+	live.reserve(config.liveSlotCount + 1);
+
+	for (uint32_t repeat = 0; repeat < config.repeatCount; repeat++)
+	{
+		Pool pool;
+		live.clear();
+		checksum = 0;
+
+		auto startTime = std::chrono::steady_clock::now();
+		for (const SlotOp& op : ops)
+		{
+			if (!op.free)
+			{
+				live.push_back(pool.Allocate());
+				checksum += live.back().heap * SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE + live.back().index;
+				continue;
+			}
+
+			pool.Free(live[op.position]);
+			live[op.position] = live.back();
+			live.pop_back();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		if (repeat == 0 || seconds < bestSeconds) bestSeconds = seconds;
+		heapCount = pool.m_heaps.size();
+	}
+	return bestSeconds;
+}
+
+static void PrintManagers(const BenchConfig& config)
+{
+	std::vector<SlotOp> ops;
+	BuildSlotOps(config, ops);
+
+	printf("managers: %zu ops, %u live slots, heaps of %d\n\n", ops.size(), config.liveSlotCount, SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
+	printf("%-12s %14s %12s %6s %18s\n", "manager", "ops/s", "ns/op", "heaps", "checksum");
+
+	const char* names[] = { "bitmap", "range-list" };
+	for (int i = 0; i < 2; i++)
+	{
+		size_t heapCount = 0;
+		uint64_t checksum = 0;
+		double seconds = i == 0 ? RunSlotOps<SlotPool>(config, ops, heapCount, checksum) : RunSlotOps<LegacySlotPool>(config, ops, heapCount, checksum);
+
+		//the checksum sums the slots handed out, it differs when the two pick other free slots
+		printf("%-12s %14.0f %12.1f %6zu %18llu\n", names[i], seconds > 0.0 ? ops.size() / seconds : 0.0,
+			ops.empty() ? 0.0 : seconds * 1e9 / ops.size(), heapCount, (unsigned long long)checksum);
+	}
+	printf("\n");
+}
+
+//magazine: AllocateSlot/DeallocateSlot, locked: AllocateRange/DeallocateRange of one slot, which takes the allocator lock every time
+enum class ContentionMode
+{
+	Magazine,
+	Locked
+};
+
+//best of repeatCount runs, seconds until the last thread finished
+static double RunContention(const BenchConfig& config, ContentionMode mode, uint32_t threadCount, uint32_t& heapCount)
+{
+	double bestSeconds = 0.0;
+	for (uint32_t repeat = 0; repeat < config.repeatCount; repeat++)
+	{
+		SHRNullDevice device;
+		SHRHeapSlotAllocator allocator(&device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
+		std::atomic<uint32_t> readyCount = 0;
+		std::atomic<bool> start = false;
+
+		std::vector<std::thread> threads;
+		for (uint32_t thread = 0; thread < threadCount; thread++)
+		{
+			threads.emplace_back([&]()
+				{
+					std::vector<SHRHeapSlotAllocator::HeapSlot> slots(config.batchSize);
+					readyCount++;
+					while (!start) std::this_thread::yield();
+
+					for (uint64_t op = 0; op < config.opCount; op += 2 * config.batchSize)
+					{
+						for (auto& slot : slots) slot = mode == ContentionMode::Magazine ? allocator.AllocateSlot() : allocator.AllocateRange(1);
+						for (auto& slot : slots)
+						{
+							if (mode == ContentionMode::Magazine) allocator.DeallocateSlot(slot);
+							else allocator.DeallocateRange(slot, 1);
+						}
+					}
+				});
+		}
+
+		while (readyCount != threadCount) std::this_thread::yield();
+		auto startTime = std::chrono::steady_clock::now();
+		start = true;
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		if (repeat == 0 || seconds < bestSeconds) bestSeconds = seconds;
+		heapCount = device.m_createdHeapCount;
+	}
+	return bestSeconds;
+}
+
+static void PrintContention(const BenchConfig& config)
+{
+	printf("contention: %llu ops per thread, batches of %u slots, heaps of %d\n\n", (unsigned long long)config.opCount, config.batchSize, SHR_DEFAULT_DESCRIPTOR_HEAP_SIZE);
+	printf("%-9s %7s %14s %12s %6s\n", "mode", "threads", "total ops/s", "ns/op", "heaps");
+
+	const char* modeNames[] = { "magazine", "locked" };
+	for (ContentionMode mode : { ContentionMode::Magazine, ContentionMode::Locked })
+	{
+		for (uint32_t threadCount = 1; threadCount <= config.maxThreadCount; threadCount *= 2)
+		{
+			uint32_t heapCount = 0;
+			double seconds = RunContention(config, mode, threadCount, heapCount);
+
+			//ops actually issued, the batches round the count up
+			uint64_t batchOps = 2ULL * config.batchSize;
+			uint64_t threadOps = (config.opCount + batchOps - 1) / batchOps * batchOps;
+			double totalOps = double(threadOps) * threadCount;
+
+			//ns/op is wall time per op of one thread, flat when the threads do not contend
+			printf("%-9s %7u %14.0f %12.1f %6u\n", modeNames[static_cast<int>(mode)], threadCount,
+				seconds > 0.0 ? totalOps / seconds : 0.0, threadOps ? seconds * 1e9 / threadOps : 0.0, heapCount);
+		}
+	}
+}
+
+static void PrintUsage()
+{
+	printf("usage: shr_slot_bench [options]\n"
+		"  --ops <n>        ops of the manager section & per thread, default 2000000\n"
+		"  --threads <n>    highest thread count, doubled from 1, default 8\n"
+		"  --batch <n>      slots held at once per thread, default 48\n"
+		"  --repeat <n>     runs per row, the best one is reported, default 3\n"
+		"  --live <n>       slots held by the manager section, default 3000\n");
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	for (int i = 1; i < argc; i++)
+	{
+		char* pEnd = nullptr;
+		unsigned long long value = i + 1 < argc ? strtoull(argv[i + 1], &pEnd, 10) : 0;
+		bool valid = pEnd && pEnd != argv[i + 1] && *pEnd == '\0' && value != 0;
+		if (valid && strcmp(argv[i], "--ops") == 0) config.opCount = value;
+		else if (valid && strcmp(argv[i], "--threads") == 0) config.maxThreadCount = static_cast<uint32_t>(value);
+		else if (valid && strcmp(argv[i], "--batch") == 0) config.batchSize = static_cast<uint32_t>(value);
+		else if (valid && strcmp(argv[i], "--repeat") == 0) config.repeatCount = static_cast<uint32_t>(value);
+		else if (valid && strcmp(argv[i], "--live") == 0) config.liveSlotCount = static_cast<uint32_t>(value);
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+		i++;
+	}
+
+	PrintManagers(config);
+	PrintContention(config);
+	return 0;
+}